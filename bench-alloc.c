@@ -0,0 +1,42 @@
+/*
+ * Allocation Counter for Benchmarks
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stddef.h>
+
+/*
+ * Interposes allocator of glibc for the whole process including shared
+ * libraries, nl-canned reports the count at exit
+ */
+extern void *__libc_malloc  (size_t size);
+extern void *__libc_calloc  (size_t count, size_t size);
+extern void *__libc_realloc (void *p, size_t size);
+
+unsigned long bench_allocs;
+
+static void count (void)
+{
+	__atomic_fetch_add (&bench_allocs, 1, __ATOMIC_RELAXED);
+}
+
+void *malloc (size_t size)
+{
+	count ();
+	return __libc_malloc (size);
+}
+
+void *calloc (size_t n, size_t size)
+{
+	count ();
+	return __libc_calloc (n, size);
+}
+
+void *realloc (void *p, size_t size)
+{
+	count ();
+	return __libc_realloc (p, size);
+}
@@ -0,0 +1,492 @@
+/*
+ * Callidus End-to-End Benchmark
+ *
+ * Runs in a private network namespace: installs routes via loopback,
+ * creates conntrack entries to them, starts conntrack-nat-callidus and
+ * withdraws routes in bursts measuring time from the first delete request
+ * of a burst to the moment all entries of withdrawn routes are gone.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <linux/rtnetlink.h>
+
+#include "nfct-core.h"
+#include "nl-core.h"
+
+#define CT_COUNT  "/proc/sys/net/netfilter/nf_conntrack_count"
+
+static unsigned routes = 1000, entries = 100000, burst = 1, bursts = 100;
+static unsigned interval = 100, timeout = 10, seed = 1;
+static int shuffle;
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void pause_for (double t)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = t;
+	ts.tv_nsec = (t - ts.tv_sec) * 1e9;
+
+	while (nanosleep (&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+/*
+ * Route i is /24 network starting from 1.0.0.0 via loopback, host order
+ */
+static uint32_t route_prefix (unsigned i)
+{
+	return 0x01000000 + (i << 8);
+}
+
+static int link_up (struct nl_sock *s, int index)
+{
+	struct ifinfomsg ifi = {
+		.ifi_family	= AF_UNSPEC,
+		.ifi_index	= index,
+		.ifi_flags	= IFF_UP,
+		.ifi_change	= IFF_UP,
+	};
+	struct nl_msg *m;
+
+	if ((m = nlmsg_alloc_simple (RTM_NEWLINK, 0)) == NULL)
+		return -NLE_NOMEM;
+
+	if (nlmsg_append (m, &ifi, sizeof (ifi), NLMSG_ALIGNTO) < 0) {
+		nlmsg_free (m);
+		return -NLE_NOMEM;
+	}
+
+	return nl_send_sync (s, m);
+}
+
+static int route_change (struct nl_sock *s, int type, int oif, unsigned i)
+{
+	struct rtmsg rtm = {
+		.rtm_family	= AF_INET,
+		.rtm_dst_len	= 24,
+		.rtm_table	= RT_TABLE_MAIN,
+		.rtm_protocol	= RTPROT_STATIC,
+		.rtm_scope	= RT_SCOPE_LINK,
+		.rtm_type	= RTN_UNICAST,
+	};
+	const uint32_t dst = htonl (route_prefix (i));
+	const int flags = type == RTM_NEWROUTE ? NLM_F_CREATE | NLM_F_EXCL : 0;
+	struct nl_msg *m;
+
+	if ((m = nlmsg_alloc_simple (type, flags)) == NULL)
+		return -NLE_NOMEM;
+
+	if (nlmsg_append (m, &rtm, sizeof (rtm), NLMSG_ALIGNTO) < 0 ||
+	    nla_put (m, RTA_DST, sizeof (dst), &dst) < 0 ||
+	    nla_put_u32 (m, RTA_OIF, oif) < 0) {
+		nlmsg_free (m);
+		return -NLE_NOMEM;
+	}
+
+	return nl_send_sync (s, m);
+}
+
+/*
+ * Entry j: TCP from 10.0.0.0/8 to host of route j % routes
+ */
+static int ct_create (struct nfct_handle *h, unsigned j)
+{
+	const uint32_t src = htonl (0x0a000000 + j);
+	const uint32_t dst = htonl (route_prefix (j % routes) + 1 +
+				    j / routes % 254);
+	const uint16_t sport = htons (1024 + j % 60000), dport = htons (80);
+	struct nf_conntrack *ct;
+	int ok;
+
+	if ((ct = nfct_new ()) == NULL)
+		return 0;
+
+	nfct_set_attr_u8  (ct, ATTR_L3PROTO, AF_INET);
+	nfct_set_attr_u32 (ct, ATTR_IPV4_SRC, src);
+	nfct_set_attr_u32 (ct, ATTR_IPV4_DST, dst);
+	nfct_set_attr_u32 (ct, ATTR_REPL_IPV4_SRC, dst);
+	nfct_set_attr_u32 (ct, ATTR_REPL_IPV4_DST, src);
+
+	nfct_set_attr_u8  (ct, ATTR_L4PROTO, IPPROTO_TCP);
+	nfct_set_attr_u16 (ct, ATTR_PORT_SRC, sport);
+	nfct_set_attr_u16 (ct, ATTR_PORT_DST, dport);
+	nfct_set_attr_u16 (ct, ATTR_REPL_PORT_SRC, dport);
+	nfct_set_attr_u16 (ct, ATTR_REPL_PORT_DST, sport);
+
+	nfct_set_attr_u8  (ct, ATTR_TCP_STATE, TCP_CONNTRACK_ESTABLISHED);
+	/* kernel refuses to create unconfirmed entry with EBUSY */
+	nfct_set_attr_u32 (ct, ATTR_STATUS,
+			   IPS_CONFIRMED | IPS_SEEN_REPLY | IPS_ASSURED);
+	nfct_set_attr_u32 (ct, ATTR_TIMEOUT, 3600);
+
+	ok = nfct_query (h, NFCT_Q_CREATE, ct) == 0;
+	nfct_destroy (ct);
+	return ok;
+}
+
+static long ct_count (int fd)
+{
+	char buf[32];
+	ssize_t len;
+
+	if ((len = pread (fd, buf, sizeof (buf) - 1, 0)) <= 0)
+		return -1;
+
+	buf[len] = '\0';
+	return atol (buf);
+}
+
+/*
+ * Returns CPU time of process in seconds, or -1 on error
+ */
+static double cpu_time (pid_t pid)
+{
+	char path[32], buf[512], *p;
+	unsigned long utime, stime;
+	ssize_t len;
+	int fd;
+
+	snprintf (path, sizeof (path), "/proc/%ld/stat", (long) pid);
+
+	if ((fd = open (path, O_RDONLY)) == -1)
+		return -1;
+
+	len = read (fd, buf, sizeof (buf) - 1);
+	close (fd);
+
+	if (len <= 0)
+		return -1;
+
+	buf[len] = '\0';
+
+	/* skip pid and command, then state and 10 fields before utime */
+	if ((p = strrchr (buf, ')')) == NULL ||
+	    sscanf (p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+			   "%lu %lu", &utime, &stime) != 2)
+		return -1;
+
+	return (double) (utime + stime) / sysconf (_SC_CLK_TCK);
+}
+
+/*
+ * Waits for process to finish its initial dump: CPU time does not change
+ * for a while
+ */
+static int wait_idle (pid_t pid)
+{
+	double last = -1, t;
+	int still = 0;
+
+	while (still < 4) {
+		pause_for (0.05);
+
+		if (waitpid (pid, NULL, WNOHANG) != 0 ||
+		    (t = cpu_time (pid)) < 0)
+			return 0;
+
+		still = t == last ? still + 1 : 0;
+		last  = t;
+	}
+
+	return 1;
+}
+
+static pid_t start (char *argv[])
+{
+	pid_t pid;
+
+	if ((pid = fork ()) != 0)
+		return pid;
+
+	execv (argv[0], argv);
+	perror (argv[0]);
+	_exit (127);
+}
+
+static int cmp (const void *a, const void *b)
+{
+	const double x = *(const double *) a, y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double percentile (const double *v, size_t n, double q)
+{
+	return v[(size_t) (q * (n - 1) + 0.5)];
+}
+
+static int setup (unsigned *count)
+{
+	struct nl_sock *s;
+	struct nfct_handle *h;
+	unsigned i;
+	int oif, ret;
+	double t;
+
+	if ((s = nl_socket_alloc ()) == NULL)
+		return 0;
+
+	if ((ret = nl_connect (s, NETLINK_ROUTE)) < 0 ||
+	    (oif = if_nametoindex ("lo")) == 0 ||
+	    (ret = link_up (s, oif)) < 0)
+		goto no_route;
+
+	t = now ();
+
+	for (i = 0; i < routes; ++i)
+		if ((ret = route_change (s, RTM_NEWROUTE, oif, i)) < 0)
+			goto no_route;
+
+	printf ("routes:   %u installed in %.3fs\n", routes, now () - t);
+	nl_socket_free (s);
+
+	if ((h = nfct_open (CONNTRACK, 0)) == NULL) {
+		perror ("callidus-bench: conntrack");
+		return 0;
+	}
+
+	t = now ();
+
+	for (i = 0; i < entries; ++i) {
+		if (!ct_create (h, i)) {
+			perror ("callidus-bench: conntrack create");
+			nfct_close (h);
+			return 0;
+		}
+
+		++count[i % routes];
+	}
+
+	printf ("entries:  %u created in %.3fs\n", entries, now () - t);
+	nfct_close (h);
+	return 1;
+no_route:
+	fprintf (stderr, "callidus-bench: route: %s\n", nl_geterror (ret));
+	nl_socket_free (s);
+	return 0;
+}
+
+static unsigned *make_order (void)
+{
+	unsigned *order, i, j, x;
+
+	if ((order = malloc (routes * sizeof (order[0]))) == NULL)
+		return NULL;
+
+	for (i = 0; i < routes; ++i)
+		order[i] = i;
+
+	srandom (seed);
+
+	for (i = routes; shuffle && i > 1; --i) {
+		j = random () % i;
+		x = order[i - 1], order[i - 1] = order[j], order[j] = x;
+	}
+
+	return order;
+}
+
+/*
+ * Withdraws bursts of routes, stores latency of each in lat, returns
+ * number of bursts done or -1 on error
+ */
+static int withdraw (const unsigned *count, double *lat, unsigned *missed)
+{
+	const unsigned *order;
+	struct nl_sock *s;
+	unsigned b, i, k, n = 0;
+	long expect, left;
+	int oif, ret, fd;
+	double t0;
+
+	if ((fd = open (CT_COUNT, O_RDONLY)) == -1 ||
+	    (expect = ct_count (fd)) < 0) {
+		perror ("callidus-bench: " CT_COUNT);
+		return -1;
+	}
+
+	if (expect < entries) {
+		fprintf (stderr, "callidus-bench: only %ld of %u entries "
+				 "present, check nf_conntrack_max\n",
+			 expect, entries);
+		close (fd);
+		return -1;
+	}
+
+	if ((order = make_order ()) == NULL ||
+	    (s = nl_socket_alloc ()) == NULL)
+		return -1;
+
+	if ((ret = nl_connect (s, NETLINK_ROUTE)) < 0 ||
+	    (oif = if_nametoindex ("lo")) == 0)
+		goto no_route;
+
+	for (b = 0, k = 0; b < bursts && k < routes; ++b, ++n) {
+		t0 = now ();
+
+		for (i = 0; i < burst && k < routes; ++i, ++k) {
+			ret = route_change (s, RTM_DELROUTE, oif, order[k]);
+			if (ret < 0)
+				goto no_route;
+
+			expect -= count[order[k]];
+		}
+
+		while ((left = ct_count (fd)) > expect &&
+		       now () - t0 < timeout)
+			pause_for (50e-6);
+
+		lat[b] = now () - t0;
+
+		if (left > expect) {
+			++*missed;
+			expect = left;
+		}
+
+		pause_for (interval / 1e3);
+	}
+
+	nl_socket_free (s);
+	free ((void *) order);
+	close (fd);
+	return n;
+no_route:
+	fprintf (stderr, "callidus-bench: route: %s\n", nl_geterror (ret));
+	nl_socket_free (s);
+	free ((void *) order);
+	close (fd);
+	return -1;
+}
+
+static void report (const double *lat, size_t n, unsigned missed)
+{
+	double v[n];
+
+	memcpy (v, lat, sizeof (v));
+	qsort (v, n, sizeof (v[0]), cmp);
+
+	printf ("bursts:   %zu of %u routes, %u missed (timeout %us)\n",
+		n, burst, missed, timeout);
+	printf ("latency:  min %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f ms\n",
+		v[0] * 1e3, percentile (v, n, 0.5) * 1e3,
+		percentile (v, n, 0.9) * 1e3, percentile (v, n, 0.99) * 1e3,
+		v[n - 1] * 1e3);
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n\tcallidus-bench [-n routes] [-m entries] "
+			 "[-b burst] [-c bursts]\n\t\t[-i interval-ms] "
+			 "[-t timeout] [-R] [-s seed] [-p callidus]\n"
+			 "\t\t[-- callidus-options]\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	const char *path = "./conntrack-nat-callidus";
+	unsigned *count, missed = 0;
+	double *lat, cpu;
+	struct rusage ru;
+	char **args;
+	pid_t pid;
+	int c, n, i;
+
+	while ((c = getopt (argc, argv, "n:m:b:c:i:t:Rs:p:")) != -1)
+		switch (c) {
+		case 'n':  routes   = strtoul (optarg, NULL, 0); break;
+		case 'm':  entries  = strtoul (optarg, NULL, 0); break;
+		case 'b':  burst    = strtoul (optarg, NULL, 0); break;
+		case 'c':  bursts   = strtoul (optarg, NULL, 0); break;
+		case 'i':  interval = strtoul (optarg, NULL, 0); break;
+		case 't':  timeout  = strtoul (optarg, NULL, 0); break;
+		case 'R':  shuffle  = 1;                         break;
+		case 's':  seed     = strtoul (optarg, NULL, 0); break;
+		case 'p':  path     = optarg;                    break;
+		default:
+			return usage ();
+		}
+
+	if (routes == 0 || routes > 1 << 24 || entries > 1 << 24 ||
+	    burst == 0 || bursts == 0)
+		return usage ();
+
+	count = calloc (routes, sizeof (count[0]));
+	lat   = calloc (bursts, sizeof (lat[0]));
+	args  = calloc (argc - optind + 3, sizeof (args[0]));
+
+	if (count == NULL || lat == NULL || args == NULL) {
+		perror ("callidus-bench");
+		return 1;
+	}
+
+	args[0] = (char *) path;
+	args[1] = "-f";
+
+	for (i = optind; i < argc; ++i)
+		args[i - optind + 2] = argv[i];
+
+	if (unshare (CLONE_NEWNET) != 0) {
+		perror ("callidus-bench: cannot create network namespace");
+		return 1;
+	}
+
+	if (!setup (count))
+		return 1;
+
+	if ((pid = start (args)) == -1) {
+		perror ("callidus-bench: fork");
+		return 1;
+	}
+
+	if (!wait_idle (pid)) {
+		fprintf (stderr, "callidus-bench: %s failed to start\n", path);
+		return 1;
+	}
+
+	cpu = cpu_time (pid);
+	printf ("callidus: ready, cpu %.3fs\n", cpu);
+
+	n = withdraw (count, lat, &missed);
+
+	cpu = cpu_time (pid) - cpu;
+
+	kill (pid, SIGTERM);
+	wait4 (pid, NULL, 0, &ru);
+
+	if (n <= 0)
+		return 1;
+
+	report (lat, n, missed);
+	printf ("cpu:      %.3fs during bursts, %.3fs user %.3fs sys total\n",
+		cpu, ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6,
+		ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6);
+	return missed > 0;
+}
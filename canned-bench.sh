@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# Runs tools on synthetic canned netlink streams, see nl-canned.h
+#
+# Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+
+set -e
+
+ROUTES=${ROUTES:-1000000}
+CONNTRACK=${CONNTRACK:-2000000}
+DIR=${DIR:-/tmp/canned-bench}
+BIN=$(dirname "$0")
+
+mkdir -p "$DIR"
+
+gen () {
+	[ -s "$DIR/$1" ] || "$BIN/nl-gen" $2 > "$DIR/$1"
+}
+
+gen links		"links 1000"
+gen addrs		"addrs 1000"
+gen routes		"routes $ROUTES 100"
+gen routes6		"routes6 $ROUTES 100"
+gen conntrack		"conntrack $CONNTRACK"
+gen conntrack6		"conntrack6 $CONNTRACK"
+gen conntrack-small	"conntrack 10000"
+
+cat "$DIR/links" "$DIR/addrs" "$DIR/routes" > "$DIR/monitor"
+
+run () {
+	printf "%-32s" "$1:"
+	shift
+	env "$@" 2>&1 >/dev/null | grep '^canned:' | cut -d' ' -f2-
+}
+
+run "route-show IPv4" NL_CANNED="$DIR/routes" "$BIN/route-show-bench"
+run "route-show IPv6" NL_CANNED="$DIR/routes6" "$BIN/route-show-bench" -6
+run "route-monitor" NL_CANNED="$DIR/monitor" "$BIN/route-monitor-bench"
+run "udhcpc-monitor" NL_CANNED="$DIR/links" "$BIN/udhcpc-monitor-bench"
+run "conntrack-flush IPv4" NFCT_CANNED="$DIR/conntrack" \
+	"$BIN/conntrack-flush-bench" -D 198.18.0.0/24
+run "conntrack-flush IPv6" NFCT_CANNED="$DIR/conntrack6" \
+	"$BIN/conntrack-flush-bench" -D 2001:db8:ffff::/120
+run "conntrack-nat-callidus" NL_CANNED="$DIR/routes" \
+	NFCT_CANNED="$DIR/conntrack-small" "$BIN/conntrack-nat-callidus-bench"
@@ -1,45 +1,120 @@
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include "nfct-flush-net.h"
+#include "nfct-flush-svc.h"
 
-static int in_addr_aton (const char *from, struct in_net *net)
+static void progress (const struct nfct_flush_stat *s, void *cookie)
 {
-	unsigned a, b, c, d, m;
-	int n;
+	unsigned i;
 
-	n = sscanf (from, "%u.%u.%u.%u/%u", &a, &b, &c, &d, &m);
+	fprintf (stderr, "\rscanned %lu/%lu, deleted %lu/%lu, rate %u/s",
+		 s->scanned, s->total, s->deleted, s->matched, s->rate);
 
-	if (n < 4 || a > 255 || b > 255 || c > 255 || d > 255 ||
-	    (n == 5 && m > 32) || n > 5) {
-		errno = EINVAL;
-		return 0;
-	}
+	if (s->eta >= 0 && !s->done)
+		fprintf (stderr, ", eta %.0fs  ", s->eta);
+
+	if (!s->done)
+		return;
 
-	net->address.s_addr = a | b << 8 | c << 16 | d << 24;
-	net->mask.s_addr = (n < 5) ?
-		0xffffffffL :
-		htonl (0xffffffffL << (32 - m));
+	fprintf (stderr, ", %.1fs\n", s->elapsed);
 
-	return n == 5 ? 2 : 1;
+	for (i = 0; i < s->workers; ++i)
+		fprintf (stderr, "worker %u: deleted %lu in %.1fs, %.0f/s\n",
+			 i, s->worker[i].deleted, s->worker[i].busy,
+			 s->worker[i].busy > 0 ?
+			 s->worker[i].deleted / s->worker[i].busy : 0);
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n"
+			 "\tconntrack-flush [-R] [-s] [-r rate] [-b burst] [-a] "
+			 "[-w workers] [-x seconds] [-D] [-v]\n"
+			 "\t\t<addr/mask>...\n"
+			 "\n"
+			 "\t-R  match reply tuple instead of original one\n"
+			 "\t-s  match source address instead of destination\n"
+			 "\t-r  delete at most <rate> entries per second\n"
+			 "\t-b  allow bursts of <burst> entries\n"
+			 "\t-a  back off while delete round-trip time grows\n"
+			 "\t-w  delete with <workers> parallel threads\n"
+			 "\t-x  do not delete, expire entries within <seconds>\n"
+			 "\t-D  flush directly, do not use conntrack-flushd\n"
+			 "\t-v  show progress\n");
+	return 1;
+}
+
+/*
+ * Passes request to conntrack-flushd if it is running, returns -1 with
+ * errno set to ENOENT or ECONNREFUSED otherwise
+ */
+static int flush_remote (const struct nfct_net *set, size_t count,
+			 const struct nfct_flush_opts *o)
+{
+	struct nfct_flush_svc_reply reply;
+
+	if (nfct_flush_remote (NULL, set, count, o, &reply) != 0)
+		return -1;
+
+	if (o->progress != NULL)
+		fprintf (stderr, "deleted %llu/%llu\n",
+			 (unsigned long long) reply.deleted,
+			 (unsigned long long) reply.matched);
+
+	return 0;
 }
 
 int main (int argc, char *argv[])
 {
-	struct in_net net;
+	struct nfct_net *set;
+	struct nfct_flush_opts opts = {};
+	int flags = 0, direct = 0, c, i, count, ret;
 
-	if (argc != 2) {
-		fprintf (stderr, "Usage:\n"
-				 "\tconntrack-flush <dest-addr/mask>\n");
-		return 1;
-	}
+	while ((c = getopt (argc, argv, "Rsr:b:aw:x:Dv")) != -1)
+		switch (c) {
+		case 'R':  flags |= NFCT_NET_REPLY;                    break;
+		case 's':  flags |= NFCT_NET_SRC;                      break;
+		case 'r':  opts.rate     = strtoul (optarg, NULL, 0); break;
+		case 'b':  opts.burst    = strtoul (optarg, NULL, 0); break;
+		case 'a':  opts.adaptive = 1;                          break;
+		case 'w':  opts.workers  = strtoul (optarg, NULL, 0); break;
+		case 'x':  opts.expire   = strtoul (optarg, NULL, 0); break;
+		case 'D':  direct        = 1;                          break;
+		case 'v':  opts.progress = progress;                   break;
+		default:
+			return usage ();
+		}
+
+	if ((count = argc - optind) < 1)
+		return usage ();
 
-	if (in_addr_aton (argv[1], &net) < 1) {
-		fprintf (stderr, "Wrong address/network format\n");
+	if ((set = calloc (count, sizeof (set[0]))) == NULL) {
+		perror ("conntrack-flush");
 		return 1;
 	}
 
-	if (nfct_flush_net (&net) != 0) {
+	for (i = 0; i < count; ++i)
+		if (!nfct_net_parse (set + i, argv[optind + i], flags)) {
+			fprintf (stderr, "Wrong address/network format: %s\n",
+				 argv[optind + i]);
+			return 1;
+		}
+
+	/* service protocol has no soft flush request */
+	if (opts.expire > 0)
+		direct = 1;
+
+	ret = direct || count > NFCT_FLUSH_SVC_MAX ? -1 :
+	      flush_remote (set, count, &opts);
+
+	if (ret != 0 && (direct || count > NFCT_FLUSH_SVC_MAX ||
+			 errno == ENOENT || errno == ECONNREFUSED))
+		ret = nfct_flush_net_ex (set, count, &opts);
+
+	if (ret != 0) {
 		perror ("netlink");
 		return 1;
 	}
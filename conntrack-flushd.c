@@ -0,0 +1,308 @@
+/*
+ * Conntrack Flush Service
+ *
+ * Resident daemon accepting flush requests over Unix socket. Requests that
+ * arrive while a flush is running are queued and served together with a
+ * single conntrack table dump.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "nfct-flush-svc.h"
+
+#define CLIENTS_MAX  64
+#define WORKERS_MAX  16		/* delete handles are kept for good */
+
+struct client {
+	int fd, pending;
+	struct nfct_flush_opts opts;
+	struct nfct_net *set;
+	size_t count;
+};
+
+static struct nfct_flush *flusher;
+static struct pollfd fds[CLIENTS_MAX + 1];
+static struct client clients[CLIENTS_MAX];
+static size_t nclients;
+
+static void client_drop (size_t i)
+{
+	close (clients[i].fd);
+	free (clients[i].set);
+
+	clients[i] = clients[--nclients];
+}
+
+static void client_send (struct client *o, int error,
+			 const struct nfct_flush_req *req)
+{
+	struct nfct_flush_svc_reply reply = { .error = error };
+
+	if (req != NULL) {
+		reply.matched = req->matched;
+		reply.deleted = req->deleted;
+	}
+
+	(void) send (o->fd, &reply, sizeof (reply), MSG_NOSIGNAL);
+}
+
+static void client_reply (struct client *o, int error,
+			  const struct nfct_flush_req *req)
+{
+	client_send (o, error, req);
+
+	o->pending = 0;
+	free (o->set);
+	o->set = NULL;
+}
+
+/*
+ * Prefix of unknown family or longer than its family allows would fail
+ * the whole merged flush, it is rejected per client
+ */
+static int net_valid (const struct nfct_net *o)
+{
+	static const unsigned char zero[12];
+
+	switch (o->family) {
+	case AF_INET:
+		return memcmp (o->mask.in6.s6_addr + 4, zero,
+			       sizeof (zero)) == 0;
+	case AF_INET6:
+		return 1;
+	}
+
+	return 0;
+}
+
+static int client_read (struct client *o)
+{
+	static char buf[sizeof (struct nfct_flush_svc_req) +
+			NFCT_FLUSH_SVC_MAX * sizeof (struct nfct_net)];
+	struct nfct_flush_svc_req *req = (void *) buf;
+	ssize_t len;
+	size_t size, i;
+
+	if ((len = recv (o->fd, buf, sizeof (buf), MSG_DONTWAIT)) <= 0)
+		return len < 0 && (errno == EAGAIN || errno == EINTR);
+
+	/* one request at a time: the pending one is kept */
+	if (o->pending) {
+		client_send (o, EBUSY, NULL);
+		return 1;
+	}
+
+	if (len < sizeof (*req) ||
+	    req->version != NFCT_FLUSH_SVC_VERSION ||
+	    req->count == 0 || req->count > NFCT_FLUSH_SVC_MAX ||
+	    len != sizeof (*req) + req->count * sizeof (req->set[0])) {
+		client_reply (o, EPROTO, NULL);
+		return 1;
+	}
+
+	for (i = 0; i < req->count; ++i)
+		if (!net_valid (req->set + i)) {
+			client_reply (o, EINVAL, NULL);
+			return 1;
+		}
+
+	size = req->count * sizeof (req->set[0]);
+
+	if ((o->set = malloc (size)) == NULL) {
+		client_reply (o, ENOMEM, NULL);
+		return 1;
+	}
+
+	memcpy (o->set, req->set, size);
+
+	memset (&o->opts, 0, sizeof (o->opts));
+	o->opts.rate     = req->rate;
+	o->opts.burst    = req->burst;
+	o->opts.adaptive = req->adaptive;
+	o->opts.workers  = req->workers < WORKERS_MAX ? req->workers :
+							WORKERS_MAX;
+
+	o->count   = req->count;
+	o->pending = 1;
+	return 1;
+}
+
+static int same_opts (const struct nfct_flush_opts *a,
+		      const struct nfct_flush_opts *b)
+{
+	return a->rate == b->rate && a->burst == b->burst &&
+	       a->adaptive == b->adaptive && a->workers == b->workers;
+}
+
+/*
+ * Serves the oldest pending request together with all pending ones having
+ * the same options
+ */
+static void serve (void)
+{
+	struct nfct_flush_req req[NFCT_FLUSH_REQ_MAX];
+	struct client *who[NFCT_FLUSH_REQ_MAX], *first = NULL;
+	size_t i, n;
+	int error;
+
+	for (i = 0, n = 0; i < nclients && n < NFCT_FLUSH_REQ_MAX; ++i) {
+		if (!clients[i].pending)
+			continue;
+
+		if (first == NULL)
+			first = clients + i;
+		else if (!same_opts (&first->opts, &clients[i].opts))
+			continue;
+
+		req[n].set   = clients[i].set;
+		req[n].count = clients[i].count;
+		who[n++]     = clients + i;
+	}
+
+	if (n == 0)
+		return;
+
+	error = nfct_flush_run (flusher, req, n, &first->opts) != 0 ?
+		errno : 0;
+
+	if (error != 0)
+		syslog (LOG_ERR, "flush: %s", strerror (error));
+
+	for (i = 0; i < n; ++i)
+		client_reply (who[i], error, req + i);
+}
+
+static int has_pending (void)
+{
+	size_t i;
+
+	for (i = 0; i < nclients; ++i)
+		if (clients[i].pending)
+			return 1;
+
+	return 0;
+}
+
+static int listen_at (const char *path)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	int s;
+
+	if (snprintf (sa.sun_path, sizeof (sa.sun_path), "%s", path) >=
+	    sizeof (sa.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	if ((s = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) == -1)
+		return -1;
+
+	(void) unlink (path);
+
+	if (bind (s, (void *) &sa, sizeof (sa)) != 0 ||
+	    chmod (path, 0600) != 0 || listen (s, CLIENTS_MAX) != 0) {
+		close (s);
+		return -1;
+	}
+
+	return s;
+}
+
+static void run (int s)
+{
+	size_t i;
+	int fd;
+
+	for (;;) {
+		fds[0].fd     = s;
+		fds[0].events = nclients < CLIENTS_MAX ? POLLIN : 0;
+
+		for (i = 0; i < nclients; ++i) {
+			fds[i + 1].fd     = clients[i].fd;
+			fds[i + 1].events = POLLIN;
+		}
+
+		if (poll (fds, nclients + 1, has_pending () ? 0 : -1) < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return;
+		}
+
+		/* walk backwards: dropping client moves the last one */
+		for (i = nclients; i-- > 0;)
+			if (fds[i + 1].revents != 0 &&
+			    !client_read (clients + i))
+				client_drop (i);
+
+		if ((fds[0].revents & POLLIN) != 0 &&
+		    (fd = accept (s, NULL, NULL)) != -1) {
+			memset (clients + nclients, 0, sizeof (clients[0]));
+			clients[nclients++].fd = fd;
+		}
+
+		serve ();
+	}
+}
+
+static int make_pidfile (const char *path)
+{
+	FILE *to;
+
+	if ((to = fopen (path, "w")) == NULL)
+		return 0;
+
+	return (fprintf (to, "%ld", (long) getpid ()) > 0) &
+	       (fclose (to) == 0);
+}
+
+#define PIDFILE  "/var/run/conntrack-flushd.pid"
+
+int main (int argc, char *argv[])
+{
+	const char *path = argc > 1 ? argv[1] : NFCT_FLUSH_SVC_PATH;
+	int s;
+
+	signal (SIGPIPE, SIG_IGN);
+
+	if ((s = listen_at (path)) == -1) {
+		perror ("conntrack-flushd: cannot listen");
+		return 1;
+	}
+
+	if ((flusher = nfct_flush_alloc (0)) == NULL) {
+		perror ("conntrack-flushd: cannot open conntrack");
+		return 1;
+	}
+
+	if (daemon (0, 0) != 0) {
+		perror ("conntrack-flushd: cannot daemonize");
+		return 1;
+	}
+
+	make_pidfile (PIDFILE);
+
+	openlog ("conntrack-flushd", 0, LOG_DAEMON);
+
+	run (s);
+
+	syslog (LOG_ERR, "poll: %m");
+	unlink (path);
+	unlink (PIDFILE);
+	return 1;
+}
@@ -4,70 +4,383 @@
  * This daemon clears conntrack entries for a destination address in case of
  * route for this destination adress is deleted.
  *
+ * Routes of the selected table (main by default) are mirrored in process,
+ * thus only the part of deleted prefix that became unreachable or changed
+ * egress is flushed. Deletions in other tables flush the whole prefix.
+ *
+ * Deletions that cannot affect NAT state (local table, blackhole churn,
+ * protocols not routed through NAT) are skipped by rule file given, see
+ * rt-filter.h.
+ *
  * (c) 2016 Alexei A. Smekalkine <ikle@ikle.ru>
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <syslog.h>
+#include <time.h>
 #include <unistd.h>
 
-#include <netlink/netlink.h>
-#include <netlink/msg.h>
-
+#include "fib-mirror.h"
+#include "metrics.h"
 #include "nfct-flush-net.h"
+#include "nl-core.h"
 #include "nl-monitor.h"
+#include "rt-attr.h"
+#include "rt-filter.h"
+
+#ifdef NL_CANNED
+#include "nl-canned.h"
+#endif
+
+enum {
+	M_NEWROUTE, M_DELROUTE, M_FILTERED, M_OVERRUNS, M_FLUSHES,
+	M_SCANNED, M_MATCHED, M_DELETED, M_FLUSHING, M_FLUSH_TIME, M_DUMP_TIME,
+	M_RETRIES, M_SKIPPED,
+};
+
+static const struct metric metrics[] = {
+	{ "callidus_events_total", "type=\"newroute\"",
+	  "Route events received", METRIC_COUNTER },
+	{ "callidus_events_total", "type=\"delroute\"",
+	  "Route events received", METRIC_COUNTER },
+	{ "callidus_events_filtered_total", NULL,
+	  "Route events ignored as cloned or of other family", METRIC_COUNTER },
+	{ "callidus_netlink_overruns_total", NULL,
+	  "Netlink receive buffer overruns, events lost", METRIC_COUNTER,
+	  &nl_monitor_overruns },
+	{ "callidus_flushes_total", NULL,
+	  "Conntrack flushes done", METRIC_COUNTER },
+	{ "callidus_flush_entries_total", "result=\"scanned\"",
+	  "Conntrack entries processed by flushes", METRIC_COUNTER },
+	{ "callidus_flush_entries_total", "result=\"matched\"",
+	  "Conntrack entries processed by flushes", METRIC_COUNTER },
+	{ "callidus_flush_entries_total", "result=\"deleted\"",
+	  "Conntrack entries processed by flushes", METRIC_COUNTER },
+	{ "callidus_flush_in_progress", NULL,
+	  "Whether conntrack flush is running now", METRIC_GAUGE },
+	{ "callidus_flush_duration_seconds", NULL,
+	  "Conntrack flush duration", METRIC_HISTOGRAM },
+	{ "callidus_dump_duration_seconds", NULL,
+	  "Route table dump duration", METRIC_HISTOGRAM },
+	{ "callidus_flush_dump_retries_total", NULL,
+	  "Conntrack dumps repeated as interrupted or overrun", METRIC_COUNTER },
+	{ "callidus_events_skipped_total", NULL,
+	  "Route deletions skipped by filter rules", METRIC_COUNTER },
+};
+
+static struct nfct_flush *flusher;
+static struct nfct_flush_opts opts;
+static int verbose;
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report (const struct nfct_flush_stat *s, void *cookie)
+{
+	unsigned i;
+
+	if (!s->done)
+		return;
+
+	metric_add (M_FLUSHES, 1);
+	metric_add (M_SCANNED, s->scanned);
+	metric_add (M_MATCHED, s->matched);
+	metric_add (M_DELETED, s->deleted);
+	metric_add (M_RETRIES, s->retries);
+	metric_observe (M_FLUSH_TIME, s->elapsed);
+
+	if (!verbose)
+		return;
+
+	syslog (LOG_INFO, "flushed %lu of %lu entries matched, "
+			  "%lu scanned in %.3fs",
+		s->deleted, s->matched, s->scanned, s->elapsed);
+
+	for (i = 0; i < s->workers; ++i)
+		syslog (LOG_INFO, "worker %u: deleted %lu in %.3fs",
+			i, s->worker[i].deleted, s->worker[i].busy);
+}
+
+struct route {
+	unsigned char family, len;
+	unsigned table;
+	const void *dst;
+	struct fib_nh nh;
+};
+
+static uint32_t hash (const void *data, size_t size)
+{
+	const unsigned char *p;
+	uint32_t h = 2166136261u;
+
+	for (p = data; size > 0; --size, ++p)
+		h = (h ^ *p) * 16777619;
+
+	return h;
+}
+
+static void route_init (struct route *o, struct rtmsg *rtm, struct rtattr **tb)
+{
+	static const unsigned char any[16];
+	struct rtattr *gw = tb[RTA_GATEWAY], *mp = tb[RTA_MULTIPATH];
+	size_t size;
+
+	memset (o, 0, sizeof (*o));
+
+	o->family  = rtm->rtm_family;
+	o->len     = rtm->rtm_dst_len;
+	o->table   = rt_u32 (tb[RTA_TABLE], rtm->rtm_table);
+	o->dst     = rt_data (tb[RTA_DST]);
+	o->nh.type = rtm->rtm_type;
+
+	o->nh.metric = rt_u32 (tb[RTA_PRIORITY], 0);
+	o->nh.oif    = rt_u32 (tb[RTA_OIF], 0);
+
+	if (gw != NULL) {
+		size = RTA_PAYLOAD (gw);
+		memcpy (o->nh.via, RTA_DATA (gw),
+			size < sizeof (o->nh.via) ? size : sizeof (o->nh.via));
+	}
+
+	if (mp != NULL)
+		o->nh.multipath = hash (RTA_DATA (mp), RTA_PAYLOAD (mp));
+
+	if (o->dst == NULL)
+		o->dst = any, o->len = 0;
+}
+
+/*
+ * Deleted route ranges to flush, whole prefix is flushed if there are too
+ * many of them
+ */
+#define RANGES_MAX  4096
+
+static struct rt_filter *filter;
+static struct fib *fib;
+static unsigned fib_table = RT_TABLE_MAIN;
+
+static struct nfct_net ranges[RANGES_MAX];
+static size_t ranges_count;
+
+static int add_range (int family, const void *prefix, unsigned len, void *ctx)
+{
+	if (ranges_count >= RANGES_MAX)
+		return -1;
+
+	return nfct_net_set (ranges + ranges_count++, family, prefix, len, 0) ?
+	       0 : -1;
+}
+
+static void flush (size_t count)
+{
+	struct nfct_flush_req req = { .set = ranges, .count = count };
+
+	/* route deleted is still covered, nothing lost it */
+	if (count == 0)
+		return;
+
+	metric_set (M_FLUSHING, 1);
+	(void) nfct_flush_run (flusher, &req, 1, &opts);
+	metric_set (M_FLUSHING, 0);
+}
 
 static int cb(struct nl_msg *m, void *ctx)
 {
 	struct nlmsghdr *h = nlmsg_hdr (m);
+	struct rtattr *tb[RTA_MAX + 1];
 	struct rtmsg *rtm;
-	struct rtattr *rta;
-	int len;
-	struct in_addr *address;
-
-	struct in_net net;
+	struct route r;
+	int skip;
 
-	if (h->nlmsg_type != RTM_DELROUTE)
+	if (h->nlmsg_type != RTM_NEWROUTE && h->nlmsg_type != RTM_DELROUTE)
 		return 0;
 
+	metric_add (h->nlmsg_type == RTM_NEWROUTE ? M_NEWROUTE : M_DELROUTE, 1);
+
 	rtm = NLMSG_DATA (h);
 
-	if (rtm->rtm_family != AF_INET)
+	if ((rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6) ||
+	    (rtm->rtm_flags & RTM_F_CLONED) != 0) {
+		metric_add (M_FILTERED, 1);
 		return 0;
+	}
 
-	for (
-		address = NULL, rta = RTM_RTA (rtm), len = RTM_PAYLOAD (h);
-		RTA_OK (rta, len);
-		rta = RTA_NEXT (rta, len)
-	)
-		if (rta->rta_type == RTA_DST)
-			address = RTA_DATA(rta);
-
-	if (address != NULL) {
-		net.address = *address;
-		net.mask.s_addr = htonl (0xffffffffL << (32 - rtm->rtm_dst_len));
+	if (!rt_index_route (tb, h))
+		return 0;
+
+	route_init (&r, rtm, tb);
+
+	skip = h->nlmsg_type == RTM_DELROUTE && filter != NULL &&
+	       !rt_filter_pass (filter, rtm, tb);
+
+	if (skip)
+		metric_add (M_SKIPPED, 1);
+
+	if (fib != NULL && r.table == fib_table) {
+		if (h->nlmsg_type == RTM_NEWROUTE) {
+			if (!fib_add (fib, r.family, r.dst, r.len, &r.nh))
+				syslog (LOG_ERR, "fib-mirror: %m");
+
+			return 0;
+		}
+
+		ranges_count = 0;
+
+		/* mirror is kept up to date even if flush is skipped */
+		if (fib_del (fib, r.family, r.dst, r.len, &r.nh,
+			     add_range, NULL) >= 0) {
+			if (!skip)
+				flush (ranges_count);
+
+			return 0;
+		}
+	}
+
+	if (h->nlmsg_type != RTM_DELROUTE || skip ||
+	    !nfct_net_set (ranges, r.family, r.dst, r.len, 0))
+		return 0;
+
+	flush (1);
+	return 0;
+}
+
+/*
+ * Routes of mirror gone while events were lost are flushed as deleted,
+ * in chunks of ranges
+ */
+static int sweep_range (int family, const void *prefix, unsigned len,
+			void *ctx)
+{
+	if (ranges_count == RANGES_MAX) {
+		flush (ranges_count);
+		ranges_count = 0;
 	}
-	else {
-		net.address.s_addr = 0;
-		net.mask.s_addr    = 0;
+
+	return add_range (family, prefix, len, ctx);
+}
+
+/*
+ * FIB mirror is filled after subscription to route changes, changes made
+ * while dumping are applied after dump then. The same is done after
+ * overrun: deletions lost are recovered from mirror, ones in other tables
+ * cannot be.
+ */
+static int resync (void *cookie)
+{
+	static int synced;
+	double start = now ();
+	int ret;
+
+	if (synced)
+		syslog (LOG_WARNING, "nl-monitor: route events lost");
+
+	synced = 1;
+
+	if (fib == NULL)
+		return 0;
+
+	fib_mark (fib);
+
+	if ((ret = nl_execute (cb, NETLINK_ROUTE, RTM_GETROUTE)) < 0) {
+		syslog (LOG_ERR, "nl-execute: %s", nl_geterror (ret));
+		return ret;
 	}
 
-	(void) nfct_flush_net (&net);
+	metric_observe (M_DUMP_TIME, now () - start);
 
+	ranges_count = 0;
+
+	if (fib_sweep (fib, sweep_range, NULL) < 0)
+		syslog (LOG_ERR, "fib-mirror: %m");
+
+	flush (ranges_count);
 	return 0;
 }
 
-int main (void)
+int main (int argc, char *argv[])
 {
-	if (daemon (0, 0) != 0) {
-		perror("conntrack-nat-callidus, daemon");
+	static const int groups[] = {
+		RTNLGRP_IPV4_ROUTE, RTNLGRP_IPV6_ROUTE, 0
+	};
+	const char *sock = NULL, *textfile = NULL, *rules = NULL;
+	unsigned rcvbuf = 0, line;
+	int c, ret, foreground = 0;
+
+	while ((c = getopt (argc, argv, "r:b:aw:B:t:F:vfS:P:")) != -1)
+		switch (c) {
+		case 't':  fib_table     = strtoul (optarg, NULL, 0); break;
+		case 'F':  rules         = optarg;                     break;
+		case 'r':  opts.rate     = strtoul (optarg, NULL, 0); break;
+		case 'b':  opts.burst    = strtoul (optarg, NULL, 0); break;
+		case 'a':  opts.adaptive = 1;                          break;
+		case 'w':  opts.workers  = strtoul (optarg, NULL, 0); break;
+		case 'B':  rcvbuf        = strtoul (optarg, NULL, 0); break;
+		case 'v':  verbose       = 1;                          break;
+		case 'f':  foreground    = 1;                          break;
+		case 'S':  sock          = optarg;                     break;
+		case 'P':  textfile      = optarg;                     break;
+		default:
+			fprintf (stderr, "Usage:\n\tconntrack-nat-callidus "
+					 "[-r rate] [-b burst] [-a] [-w workers] "
+					 "[-B rcvbuf]\n\t\t[-t table] [-F rules] [-v] [-f] "
+					 "[-S metrics-socket]\n\t\t"
+					 "[-P metrics-textfile]\n");
+			return 1;
+		}
+
+	if (rules != NULL && (filter = rt_filter_load (rules, &line)) == NULL) {
+		if (line > 0)
+			fprintf (stderr, "conntrack-nat-callidus: %s:%u: "
+					 "wrong rule\n", rules, line);
+		else
+			perror ("conntrack-nat-callidus: cannot load rules");
+
 		return 1;
 	}
 
-	nl_monitor (cb, NETLINK_ROUTE, RTNLGRP_IPV4_ROUTE, 0);
+	if (verbose || sock != NULL || textfile != NULL)
+		opts.progress = report;
+
+#ifdef NL_CANNED
+	/* canned stream is a benchmark run, stay in foreground then */
+	if (nl_canned ("NL_CANNED") != NULL)
+		foreground = 1;
+#endif
+
+	if (!foreground && daemon (0, 0) != 0) {
+		perror("conntrack-nat-callidus, daemon");
+		return 1;
+	}
 
 	openlog ("conntrack-nat-callidus", 0, LOG_DAEMON);
-	syslog (LOG_ERR, "nl-monitor: %m");
+
+	if ((sock != NULL || textfile != NULL) &&
+	    (!metrics_init (metrics, sizeof (metrics) / sizeof (metrics[0])) ||
+	     !metrics_start (sock, textfile, 15))) {
+		syslog (LOG_ERR, "metrics: %m");
+		return 1;
+	}
+
+	if ((flusher = nfct_flush_alloc (rcvbuf)) == NULL) {
+		syslog (LOG_ERR, "conntrack: %m");
+		return 1;
+	}
+
+	if (fib_table != 0 && (fib = fib_alloc ()) == NULL) {
+		syslog (LOG_ERR, "fib-mirror: %m");
+		return 1;
+	}
+
+	ret = nl_monitor_sync (cb, NETLINK_ROUTE, groups, resync, NULL);
+
+	syslog (LOG_ERR, "nl-monitor: %s", nl_geterror (ret));
 	closelog ();
 
 	return 1;
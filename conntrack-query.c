@@ -0,0 +1,297 @@
+/*
+ * Conntrack Snapshot Query
+ *
+ * Filters entries of conntrack snapshot written by conntrack-stat and
+ * counts them, optionally grouped by a field or address prefix.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "ct-snap.h"
+
+enum group_by {
+	BY_NONE, BY_ZONE, BY_PROTO, BY_PORT, BY_STATE, BY_MARK, BY_PREFIX,
+};
+
+struct group {
+	union nfct_addr key;
+	unsigned char family;
+	unsigned long count;
+};
+
+struct ctx {
+	enum group_by by;
+	int tuple, family;
+	union nfct_addr mask;
+	unsigned len;
+
+	struct group *group;
+	size_t size, count;	/* size is power of two */
+};
+
+static uint32_t key_hash (const union nfct_addr *a)
+{
+	uint64_t h = (a->w[0] ^ a->w[1] * 0x9e3779b97f4a7c15) *
+		     0xbf58476d1ce4e5b9;
+
+	return h >> 32;
+}
+
+static int grow (struct ctx *c)
+{
+	const size_t size = c->size > 0 ? c->size * 2 : 1024;
+	struct group *g, *o;
+	size_t i, j;
+
+	if ((g = calloc (size, sizeof (g[0]))) == NULL)
+		return 0;
+
+	for (i = 0; i < c->size; ++i) {
+		if ((o = c->group + i)->count == 0)
+			continue;
+
+		for (j = key_hash (&o->key); g[j % size].count != 0; ++j) {}
+
+		g[j % size] = *o;
+	}
+
+	free (c->group);
+	c->group = g;
+	c->size  = size;
+	return 1;
+}
+
+static void count (struct ctx *c, const union nfct_addr *key, int family)
+{
+	struct group *g;
+	size_t i;
+
+	if (c->count * 2 >= c->size && !grow (c)) {
+		perror ("conntrack-query");
+		exit (1);
+	}
+
+	for (i = key_hash (key);; ++i) {
+		g = c->group + (i & (c->size - 1));
+
+		if (g->count == 0) {
+			g->key    = *key;
+			g->family = family;
+			++c->count;
+			break;
+		}
+
+		if (g->family == family && g->key.w[0] == key->w[0] &&
+		    g->key.w[1] == key->w[1])
+			break;
+	}
+
+	++g->count;
+}
+
+static void cb (const struct ct_snap_block *b, unsigned i, void *cookie)
+{
+	struct ctx *c = cookie;
+	union nfct_addr key = {};
+
+	switch (c->by) {
+	case BY_NONE:	return;
+	case BY_ZONE:	key.w[0] = b->zone[i];			break;
+	case BY_PROTO:	key.w[0] = b->proto[i];			break;
+	case BY_PORT:	key.w[0] = b->port[c->tuple][i];	break;
+	case BY_STATE:	key.w[0] = b->state[i];			break;
+	case BY_MARK:	key.w[0] = b->mark[i];			break;
+	case BY_PREFIX:
+		if (b->family[i] != c->family)
+			return;
+
+		key.w[0] = b->addr[c->tuple][i][0] & c->mask.w[0];
+		key.w[1] = b->addr[c->tuple][i][1] & c->mask.w[1];
+		count (c, &key, b->family[i]);
+		return;
+	}
+
+	count (c, &key, 0);
+}
+
+static int group_cmp (const void *a, const void *b)
+{
+	const struct group *p = a, *q = b;
+
+	return p->count < q->count ? 1 : p->count > q->count ? -1 : 0;
+}
+
+static void show (struct ctx *c, unsigned top)
+{
+	static const char *name[] = {
+		NULL, "zone", "proto", "port", "state", "mark", "prefix",
+	};
+	char buf[INET6_ADDRSTRLEN];
+	size_t i, n;
+
+	for (i = 0, n = 0; i < c->size; ++i)
+		if (c->group[i].count != 0)
+			c->group[n++] = c->group[i];
+
+	qsort (c->group, n, sizeof (c->group[0]), group_cmp);
+
+	for (i = 0; i < n && i < top; ++i) {
+		printf ("%s ", name[c->by]);
+
+		if (c->by == BY_PREFIX)
+			printf ("%s/%u", inet_ntop (c->family, &c->group[i].key,
+						    buf, sizeof (buf)), c->len);
+		else if (c->by == BY_MARK)
+			printf ("0x%llx",
+				(unsigned long long) c->group[i].key.w[0]);
+		else
+			printf ("%llu",
+				(unsigned long long) c->group[i].key.w[0]);
+
+		printf (" %lu\n", c->group[i].count);
+	}
+}
+
+static int parse_group (struct ctx *c, const char *from)
+{
+	static const char *name[] = {
+		"zone", "proto", "port", "state", "mark",
+	};
+	struct nfct_net net;
+	unsigned i;
+	char *end;
+
+	for (i = 0; i < sizeof (name) / sizeof (name[0]); ++i)
+		if (strcmp (from, name[i]) == 0) {
+			c->by = BY_ZONE + i;
+			return 1;
+		}
+
+	if ((from[0] != '4' && from[0] != '6') || from[1] != ':')
+		return 0;
+
+	c->by     = BY_PREFIX;
+	c->family = from[0] == '4' ? AF_INET : AF_INET6;
+	c->len    = strtoul (from + 2, &end, 10);
+
+	if (from[2] == '\0' || *end != '\0' ||
+	    !nfct_net_set (&net, c->family, NULL, c->len, 0))
+		return 0;
+
+	c->mask = net.mask;
+	return 1;
+}
+
+static int parse_proto (const char *from)
+{
+	struct protoent *p;
+	char *end;
+	long v = strtol (from, &end, 0);
+
+	if (*from != '\0' && *end == '\0')
+		return v >= 0 && v < 256 ? v : -1;
+
+	return (p = getprotobyname (from)) != NULL ? p->p_proto : -1;
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n"
+			 "\tconntrack-query [-R] [-s] [-t proto] [-p port] "
+			 "[-z zone] [-g group]\n"
+			 "\t\t[-k count] snapshot [addr/mask]...\n"
+			 "\n"
+			 "\t-R  use reply tuple instead of original one\n"
+			 "\t-s  use source address and port instead of "
+			 "destination ones\n"
+			 "\t-t  count entries of protocol only\n"
+			 "\t-p  count entries with port only\n"
+			 "\t-z  count entries of zone only\n"
+			 "\t-g  group entries by zone, proto, port, state, "
+			 "mark, or prefix of\n"
+			 "\t    length given as 4:len or 6:len\n"
+			 "\t-k  show <count> largest groups, 20 by default\n"
+			 "\n"
+			 "With prefixes given only entries inside any of them "
+			 "are counted\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	struct ct_snap_query q = { .proto = -1, .zone = -1, .port = -1 };
+	struct ctx c = {};
+	struct ct_snap_map m;
+	struct nfct_net *set = NULL;
+	unsigned top = 20, i;
+	int flags = 0, ch;
+	long n;
+
+	while ((ch = getopt (argc, argv, "Rst:p:z:g:k:")) != -1)
+		switch (ch) {
+		case 'R':  flags |= NFCT_NET_REPLY;			break;
+		case 's':  flags |= NFCT_NET_SRC;			break;
+		case 't':
+			if ((q.proto = parse_proto (optarg)) < 0)
+				return usage ();
+
+			break;
+		case 'p':  q.port = strtoul (optarg, NULL, 0) & 0xffff;	break;
+		case 'z':  q.zone = strtoul (optarg, NULL, 0) & 0xffff;	break;
+		case 'g':
+			if (!parse_group (&c, optarg))
+				return usage ();
+
+			break;
+		case 'k':  top = strtoul (optarg, NULL, 0);		break;
+		default:
+			return usage ();
+		}
+
+	if (optind == argc)
+		return usage ();
+
+	if (!ct_snap_map (&m, argv[optind++]))
+		goto error;
+
+	if ((q.count = argc - optind) > 0 &&
+	    (set = calloc (q.count, sizeof (set[0]))) == NULL)
+		goto error;
+
+	for (i = 0; i < q.count; ++i)
+		if (!nfct_net_parse (set + i, argv[optind + i], flags)) {
+			fprintf (stderr, "Wrong address/network format: %s\n",
+				 argv[optind + i]);
+			return 1;
+		}
+
+	q.set        = set;
+	q.port_tuple = flags;
+	c.tuple      = flags;
+
+	if ((n = ct_snap_scan (&m, &q, c.by != BY_NONE ? cb : NULL,
+			       &c)) < 0)
+		goto error;
+
+	show (&c, top);
+	printf ("matched %ld of %llu\n", n,
+		(unsigned long long) m.head->count);
+
+	ct_snap_unmap (&m);
+	free (c.group);
+	free (set);
+	return 0;
+error:
+	perror ("conntrack-query");
+	return 1;
+}
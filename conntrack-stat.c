@@ -0,0 +1,230 @@
+/*
+ * Conntrack Table Statistics
+ *
+ * Aggregates conntrack table with single dump in fixed memory and shows
+ * how many entries given prefixes would flush. Optionally writes binary
+ * snapshot of the table for conntrack-query.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <netinet/in.h>
+
+#include "ct-snap.h"
+#include "ct-stat.h"
+#include "nfct-core.h"
+#include "nfct-flush-net.h"
+
+#define SKETCH_SIZE  4096
+
+struct ctx {
+	struct ct_stat *stat;
+	enum nf_conntrack_attr attr[2];
+	struct ct_snap *snap;
+};
+
+static const enum nf_conntrack_attr net_attr[4][2] = {
+	{ ATTR_ORIG_IPV4_DST, ATTR_ORIG_IPV6_DST },
+	{ ATTR_REPL_IPV4_DST, ATTR_REPL_IPV6_DST },
+	{ ATTR_ORIG_IPV4_SRC, ATTR_ORIG_IPV6_SRC },
+	{ ATTR_REPL_IPV4_SRC, ATTR_REPL_IPV6_SRC },
+};
+
+static const enum nf_conntrack_attr port_attr[4] = {
+	ATTR_ORIG_PORT_DST, ATTR_REPL_PORT_DST,
+	ATTR_ORIG_PORT_SRC, ATTR_REPL_PORT_SRC,
+};
+
+static void snap (struct ctx *c, const struct nf_conntrack *ct,
+		  const struct ct_entry *e)
+{
+	struct ct_snap_entry s;
+	const void *a;
+	unsigned k;
+
+	memset (&s, 0, sizeof (s));
+
+	s.family  = e->family;
+	s.proto   = e->proto;
+	s.state   = e->state;
+	s.zone    = e->zone;
+	s.mark    = nfct_get_attr_u32 (ct, ATTR_MARK);
+	s.status  = nfct_get_attr_u32 (ct, ATTR_STATUS);
+	s.timeout = nfct_get_attr_u32 (ct, ATTR_TIMEOUT);
+
+	for (k = 0; k < 4; ++k) {
+		s.port[k] = ntohs (nfct_get_attr_u16 (ct, port_attr[k]));
+
+		if ((e->family == AF_INET || e->family == AF_INET6) &&
+		    (a = nfct_get_attr (ct, net_attr[k][e->family == AF_INET6]))
+		    != NULL)
+			memcpy (s.addr + k, a, e->family == AF_INET ? 4 : 16);
+	}
+
+	(void) ct_snap_add (c->snap, &s);  /* error is reported by close */
+}
+
+static void inspect (const struct nf_conntrack *ct, void *cookie)
+{
+	struct ctx *c = cookie;
+	struct ct_entry e;
+	const void *a;
+
+	e.family = nfct_get_attr_u8 (ct, ATTR_L3PROTO);
+	e.proto  = nfct_get_attr_u8 (ct, ATTR_L4PROTO);
+	e.state  = e.proto == IPPROTO_TCP ?
+		   nfct_get_attr_u8 (ct, ATTR_TCP_STATE) : CT_STATE_NONE;
+	e.zone   = nfct_get_attr_u16 (ct, ATTR_ZONE);
+
+	memset (&e.addr, 0, sizeof (e.addr));
+
+	if ((e.family == AF_INET || e.family == AF_INET6) &&
+	    (a = nfct_get_attr (ct, c->attr[e.family == AF_INET6])) != NULL)
+		memcpy (&e.addr, a, e.family == AF_INET ? 4 : 16);
+
+	ct_stat_add (c->stat, &e);
+
+	if (c->snap != NULL)
+		snap (c, ct, &e);
+}
+
+static void progress (const struct nfct_flush_stat *s, void *cookie)
+{
+	fprintf (stderr, "\rscanned %lu/%lu", s->scanned, s->total);
+
+	if (s->eta >= 0 && !s->done)
+		fprintf (stderr, ", eta %.0fs  ", s->eta);
+
+	if (s->done)
+		fprintf (stderr, ", %.1fs, %.0f entries/s\n", s->elapsed,
+			 s->elapsed > 0 ? s->scanned / s->elapsed : 0);
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n"
+			 "\tconntrack-stat [-R] [-s] [-k count] "
+			 "[-l prefix-length] [-w snapshot] [-v]\n"
+			 "\t\t[addr/mask]...\n"
+			 "\n"
+			 "\t-R  use reply tuple instead of original one\n"
+			 "\t-s  use source address instead of destination\n"
+			 "\t-k  show <count> top prefixes of each length, "
+			 "20 by default\n"
+			 "\t-l  track top prefixes of length, up to 8 times, "
+			 "32, 24, 128 and 64\n"
+			 "\t    by default, IPv4 ones are given as 4:len, "
+			 "IPv6 ones as 6:len\n"
+			 "\t-w  write binary snapshot of the table into file\n"
+			 "\t-v  show progress\n"
+			 "\n"
+			 "Entries matched by prefixes given are counted, not "
+			 "deleted\n");
+	return 1;
+}
+
+static int parse_len (const char *from, int *family, unsigned *len)
+{
+	char *end;
+
+	if ((from[0] != '4' && from[0] != '6') || from[1] != ':')
+		return 0;
+
+	*family = from[0] == '4' ? AF_INET : AF_INET6;
+	*len    = strtoul (from + 2, &end, 10);
+
+	return from[2] != '\0' && *end == '\0';
+}
+
+int main (int argc, char *argv[])
+{
+	static const char *defaults[] = { "4:32", "4:24", "6:128", "6:64" };
+	const char *lens[8];
+	struct ctx c = {};
+	struct nfct_flush_opts opts = {};
+	struct nfct_flush_req req = {};
+	struct nfct_net *set = NULL;
+	const char *path = NULL;
+	unsigned k = 20, nlens = 0, len, i;
+	int flags = 0, verbose = 0, family, ch, count;
+
+	while ((ch = getopt (argc, argv, "Rsk:l:w:v")) != -1)
+		switch (ch) {
+		case 'R':  flags |= NFCT_NET_REPLY;			break;
+		case 's':  flags |= NFCT_NET_SRC;			break;
+		case 'k':  k = strtoul (optarg, NULL, 0);		break;
+		case 'l':
+			if (nlens == 8)
+				return usage ();
+
+			lens[nlens++] = optarg;
+			break;
+		case 'w':  path = optarg;				break;
+		case 'v':  verbose = 1;					break;
+		default:
+			return usage ();
+		}
+
+	if (nlens == 0)
+		for (; nlens < 4; ++nlens)
+			lens[nlens] = defaults[nlens];
+
+	if ((count = argc - optind) > 0 &&
+	    (set = calloc (count, sizeof (set[0]))) == NULL)
+		goto error;
+
+	for (i = 0; i < count; ++i)
+		if (!nfct_net_parse (set + i, argv[optind + i], flags)) {
+			fprintf (stderr, "Wrong address/network format: %s\n",
+				 argv[optind + i]);
+			return 1;
+		}
+
+	c.stat = ct_stat_alloc (k > SKETCH_SIZE ? k : SKETCH_SIZE);
+	if (c.stat == NULL)
+		goto error;
+
+	for (i = 0; i < nlens; ++i)
+		if (!parse_len (lens[i], &family, &len) ||
+		    !ct_stat_track (c.stat, family, len))
+			return usage ();
+
+	if (path != NULL && (c.snap = ct_snap_create (path)) == NULL)
+		goto error;
+
+	c.attr[0] = net_attr[flags][0];
+	c.attr[1] = net_attr[flags][1];
+
+	opts.progress = verbose ? progress : NULL;
+	opts.cookie   = &c;
+	opts.inspect  = inspect;
+	opts.dry_run  = 1;
+
+	req.set   = set;
+	req.count = count;
+
+	if (nfct_flush_multi (&req, 1, &opts) != 0)
+		goto error;
+
+	if (c.snap != NULL && !ct_snap_close (c.snap))
+		goto error;
+
+	ct_stat_show (c.stat, k, stdout);
+
+	if (count > 0)
+		printf ("would flush %lu\n", req.matched);
+
+	ct_stat_free (c.stat);
+	free (set);
+	return 0;
+error:
+	perror ("conntrack-stat");
+	return 1;
+}
@@ -0,0 +1,133 @@
+/*
+ * Conntrack Table Snapshot Benchmark
+ *
+ * Writes snapshot of synthetic entries and scans it with field and prefix
+ * queries, reports entries per second.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "ct-snap.h"
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t next (uint64_t *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 7;
+	*s ^= *s << 17;
+	return *s;
+}
+
+/*
+ * Quarter of entries go to 16 hot hosts, the rest spread over 16M ones
+ */
+static void make (struct ct_snap_entry *e, uint64_t *s)
+{
+	uint64_t r = next (s);
+	uint32_t a = (r & 3) == 0 ? 0x0a000000 | (r >> 8 & 0xf) :
+				    0x0b000000 | (r >> 8 & 0xffffff);
+
+	memset (e, 0, sizeof (*e));
+
+	e->family  = AF_INET;
+	e->proto   = r >> 40 & 3 ? IPPROTO_TCP : IPPROTO_UDP;
+	e->state   = e->proto == IPPROTO_TCP ? 3 : 0xff;
+	e->zone    = r >> 42 & 3;
+	e->timeout = r >> 44 & 0xfff;
+	e->port[0] = r >> 48 & 1 ? 443 : 1024 + (r >> 50 & 0x3fff);
+	e->port[2] = 1024 + (r >> 32 & 0xffff);
+	e->addr[0].in.s_addr = htonl (a);
+	e->addr[2].in.s_addr = htonl (0xc0a80000 | (r >> 16 & 0xffff));
+}
+
+static void scan (const struct ct_snap_map *m, const char *name,
+		  const struct ct_snap_query *q)
+{
+	double t = now ();
+	long n = ct_snap_scan (m, q, NULL, NULL);
+
+	t = now () - t;
+
+	printf ("%-8s matched %ld in %.3fs, %.1f M entries/s\n", name, n, t,
+		m->head->count / t / 1e6);
+}
+
+int main (int argc, char *argv[])
+{
+	const size_t n = argc > 1 ? strtoul (argv[1], NULL, 0) : 4000000;
+	const char *path = argc > 2 ? argv[2] : "ct-snap-bench.snap";
+	struct ct_snap_query q = { .proto = -1, .zone = -1, .port = -1 };
+	struct nfct_net net = { .family = AF_INET };
+	struct ct_snap_entry e;
+	struct ct_snap_map m;
+	struct ct_snap *o;
+	uint64_t s = 88172645463325252ull;
+	size_t i;
+	double t;
+
+	if ((o = ct_snap_create (path)) == NULL)
+		goto error;
+
+	t = now ();
+
+	for (i = 0; i < n; ++i) {
+		make (&e, &s);
+
+		if (!ct_snap_add (o, &e))
+			goto error;
+	}
+
+	if (!ct_snap_close (o))
+		goto error;
+
+	t = now () - t;
+
+	printf ("write    %zu entries in %.3fs, %.1f M entries/s\n",
+		n, t, n / t / 1e6);
+
+	if (!ct_snap_map (&m, path))
+		goto error;
+
+	scan (&m, "all", &q);
+
+	q.proto = IPPROTO_UDP;
+	q.zone  = 1;
+	scan (&m, "fields", &q);
+
+	q.proto = q.zone = -1;
+	q.port  = 443;
+	scan (&m, "port", &q);
+
+	net.address.in.s_addr = htonl (0x0a000000);
+	net.mask.in.s_addr    = htonl (0xffffff00);
+
+	q.port  = -1;
+	q.set   = &net;
+	q.count = 1;
+	scan (&m, "prefix", &q);
+
+	ct_snap_unmap (&m);
+	unlink (path);
+	return 0;
+error:
+	perror ("ct-snap-bench");
+	return 1;
+}
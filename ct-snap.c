@@ -0,0 +1,395 @@
+/*
+ * Conntrack Table Snapshot
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ct-snap.h"
+#include "net-match.h"
+
+struct ct_snap {
+	char *path, *tmp;
+	int fd, error;		/* the first write error */
+	struct ct_snap_head head;
+	struct ct_snap_block *block;
+};
+
+static int write_all (int fd, const void *data, size_t size, off_t off)
+{
+	const char *p = data;
+	ssize_t len;
+
+	for (; size > 0; p += len, off += len, size -= len)
+		if ((len = pwrite (fd, p, size, off)) <= 0) {
+			if (len < 0 && errno == EINTR) {
+				len = 0;
+				continue;
+			}
+
+			return 0;
+		}
+
+	return 1;
+}
+
+struct ct_snap *ct_snap_create (const char *path)
+{
+	struct ct_snap *o;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((o->block = calloc (1, sizeof (*o->block))) == NULL)
+		goto no_block;
+
+	if ((o->path = strdup (path)) == NULL ||
+	    (o->tmp = malloc (strlen (path) + 5)) == NULL)
+		goto no_path;
+
+	sprintf (o->tmp, "%s.tmp", path);
+
+	if ((o->fd = open (o->tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			   0644)) == -1)
+		goto no_path;
+
+	memcpy (o->head.magic, CT_SNAP_MAGIC, sizeof (o->head.magic));
+	o->head.block = CT_SNAP_BLOCK;
+	o->head.size  = sizeof (*o->block);
+	o->head.time  = time (NULL);
+	return o;
+no_path:
+	free (o->tmp);
+	free (o->path);
+	free (o->block);
+no_block:
+	free (o);
+	return NULL;
+}
+
+static off_t block_offset (size_t index)
+{
+	return sizeof (struct ct_snap_head) +
+	       (off_t) index * sizeof (struct ct_snap_block);
+}
+
+int ct_snap_add (struct ct_snap *o, const struct ct_snap_entry *e)
+{
+	struct ct_snap_block *b = o->block;
+	const unsigned i = o->head.count % CT_SNAP_BLOCK;
+	unsigned k;
+
+	for (k = 0; k < 4; ++k) {
+		b->addr[k][i][0] = e->addr[k].w[0];
+		b->addr[k][i][1] = e->addr[k].w[1];
+		b->port[k][i]    = e->port[k];
+	}
+
+	b->mark[i]    = e->mark;
+	b->status[i]  = e->status;
+	b->timeout[i] = e->timeout;
+	b->zone[i]    = e->zone;
+	b->family[i]  = e->family;
+	b->proto[i]   = e->proto;
+	b->state[i]   = e->state;
+
+	if (++o->head.count % CT_SNAP_BLOCK != 0 || o->error != 0)
+		return o->error == 0;
+
+	if (!write_all (o->fd, b, sizeof (*b),
+			block_offset (o->head.count / CT_SNAP_BLOCK - 1))) {
+		o->error = errno;
+		return 0;
+	}
+
+	return 1;
+}
+
+#define CLEAR(col, from)  \
+	memset ((col) + (from), 0, (CT_SNAP_BLOCK - (from)) * sizeof ((col)[0]))
+
+static void block_clear (struct ct_snap_block *b, unsigned from)
+{
+	unsigned k;
+
+	for (k = 0; k < 4; ++k) {
+		CLEAR (b->addr[k], from);
+		CLEAR (b->port[k], from);
+	}
+
+	CLEAR (b->mark,    from);
+	CLEAR (b->status,  from);
+	CLEAR (b->timeout, from);
+	CLEAR (b->zone,    from);
+	CLEAR (b->family,  from);
+	CLEAR (b->proto,   from);
+	CLEAR (b->state,   from);
+}
+
+#undef CLEAR
+
+int ct_snap_close (struct ct_snap *o)
+{
+	const unsigned tail = o->head.count % CT_SNAP_BLOCK;
+	int ok = o->error == 0;
+
+	if (ok && tail != 0) {
+		block_clear (o->block, tail);
+		ok = write_all (o->fd, o->block, sizeof (*o->block),
+				block_offset (o->head.count / CT_SNAP_BLOCK));
+	}
+
+	ok = ok && write_all (o->fd, &o->head, sizeof (o->head), 0);
+
+	ok = (close (o->fd) == 0) & ok;
+
+	/* readers find snapshot complete or do not find it at all */
+	if (!ok || rename (o->tmp, o->path) != 0) {
+		unlink (o->tmp);
+		ok = 0;
+	}
+
+	if (o->error != 0)
+		errno = o->error;
+
+	free (o->tmp);
+	free (o->path);
+	free (o->block);
+	free (o);
+	return ok;
+}
+
+int ct_snap_map (struct ct_snap_map *o, const char *path)
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	if ((fd = open (path, O_RDONLY | O_CLOEXEC)) == -1)
+		return 0;
+
+	if (fstat (fd, &st) != 0)
+		goto no_map;
+
+	if (st.st_size < sizeof (*o->head)) {
+		errno = EINVAL;
+		goto no_map;
+	}
+
+	p = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		goto no_map;
+
+	close (fd);
+
+	o->head   = p;
+	o->block  = (void *) (o->head + 1);
+	o->size   = st.st_size;
+	o->blocks = (o->head->count + CT_SNAP_BLOCK - 1) / CT_SNAP_BLOCK;
+
+	if (memcmp (o->head->magic, CT_SNAP_MAGIC, sizeof (o->head->magic))
+	    != 0 || o->head->block != CT_SNAP_BLOCK ||
+	    o->head->size != sizeof (*o->block) ||
+	    o->size < block_offset (o->blocks)) {
+		ct_snap_unmap (o);
+		errno = EINVAL;
+		return 0;
+	}
+
+	madvise (p, o->size, MADV_SEQUENTIAL);
+	return 1;
+no_map:
+	close (fd);
+	return 0;
+}
+
+void ct_snap_unmap (struct ct_snap_map *o)
+{
+	munmap ((void *) o->head, o->size);
+	o->head = NULL;
+}
+
+/*
+ * Prefix set split into groups by family and tuple
+ */
+static void groups_fini (struct net_set group[2][4])
+{
+	unsigned f, k;
+
+	for (f = 0; f < 2; ++f)
+		for (k = 0; k < 4; ++k)
+			net_set_fini (&group[f][k]);
+}
+
+static int groups_init (struct net_set group[2][4],
+			const struct nfct_net *set, size_t count)
+{
+	size_t size[2][4] = {}, i;
+	const struct nfct_net *o;
+	unsigned f, k;
+
+	memset (group, 0, sizeof (struct net_set [2][4]));
+
+	for (i = 0, o = set; i < count; ++i, ++o)
+		++size[o->family == AF_INET6][o->flags & 3];
+
+	for (f = 0; f < 2; ++f)
+		for (k = 0; k < 4; ++k)
+			if (!net_set_init (&group[f][k], f ? AF_INET6 : AF_INET,
+					   size[f][k]))
+				goto no_set;
+
+	memset (size, 0, sizeof (size));
+
+	for (i = 0, o = set; i < count; ++i, ++o) {
+		f = o->family == AF_INET6;
+		k = o->flags & 3;
+
+		net_set_put (&group[f][k], size[f][k]++, &o->address, &o->mask);
+	}
+
+	return 1;
+no_set:
+	groups_fini (group);
+	return 0;
+}
+
+/*
+ * Field checks are plain loops over columns, compiler turns them into
+ * vector compares
+ */
+static void select_fields (const struct ct_snap_block *b,
+			   const struct ct_snap_query *q,
+			   uint8_t *keep, unsigned n)
+{
+	const uint16_t *port = b->port[q->port_tuple & 3];
+	unsigned i;
+
+	for (i = 0; i < n; ++i)
+		keep[i] = b->family[i] != 0;
+
+	if (q->proto >= 0)
+		for (i = 0; i < n; ++i)
+			keep[i] &= b->proto[i] == q->proto;
+
+	if (q->zone >= 0)
+		for (i = 0; i < n; ++i)
+			keep[i] &= b->zone[i] == q->zone;
+
+	if (q->port >= 0)
+		for (i = 0; i < n; ++i)
+			keep[i] &= port[i] == q->port;
+}
+
+static uint64_t bits_of (const uint8_t *v, unsigned n, unsigned value)
+{
+	uint64_t bits = 0;
+	unsigned i;
+
+	for (i = 0; i < n; ++i)
+		bits |= (uint64_t) (v[i] == value) << i;
+
+	return bits;
+}
+
+/*
+ * Prefix sets are matched 64 entries at a time: IPv6 column is passed to
+ * matcher as is, IPv4 addresses are gathered first
+ */
+static uint64_t match_chunk (const struct ct_snap_block *b,
+			     struct net_set group[2][4], unsigned from,
+			     unsigned n, uint64_t live)
+{
+	uint64_t fam[2], hit = 0;
+	uint32_t in[NET_BATCH];
+	unsigned f, k, i;
+
+	fam[0] = bits_of (b->family + from, n, AF_INET)  & live;
+	fam[1] = bits_of (b->family + from, n, AF_INET6) & live;
+
+	for (f = 0; f < 2; ++f)
+		for (k = 0; k < 4; ++k) {
+			if (group[f][k].count == 0 || fam[f] == 0)
+				continue;
+
+			if (f == 1) {
+				hit |= net_set_match (&group[f][k],
+						      b->addr[k] + from, n) &
+				       fam[f];
+				continue;
+			}
+
+			for (i = 0; i < n; ++i)
+				memcpy (in + i, b->addr[k][from + i], 4);
+
+			hit |= net_set_match (&group[f][k], in, n) & fam[f];
+		}
+
+	return hit;
+}
+
+static void select_prefix (const struct ct_snap_block *b,
+			   struct net_set group[2][4],
+			   uint8_t *keep, unsigned n)
+{
+	uint64_t live, hit;
+	unsigned j, m, i;
+
+	for (j = 0; j < n; j += m) {
+		m = n - j < NET_BATCH ? n - j : NET_BATCH;
+
+		if ((live = bits_of (keep + j, m, 1)) == 0)
+			continue;
+
+		hit = match_chunk (b, group, j, m, live);
+
+		for (i = 0; i < m; ++i)
+			keep[j + i] = (hit >> i) & 1;
+	}
+}
+
+long ct_snap_scan (const struct ct_snap_map *o, const struct ct_snap_query *q,
+		   ct_snap_cb *cb, void *cookie)
+{
+	struct net_set group[2][4];
+	uint8_t keep[CT_SNAP_BLOCK];
+	const struct ct_snap_block *b;
+	uint64_t left = o->head->count;
+	unsigned n, i;
+	long count = 0;
+
+	if (!groups_init (group, q->set, q->count))
+		return -1;
+
+	for (b = o->block; left > 0; ++b, left -= n) {
+		n = left < CT_SNAP_BLOCK ? left : CT_SNAP_BLOCK;
+
+		select_fields (b, q, keep, n);
+
+		if (q->count > 0)
+			select_prefix (b, group, keep, n);
+
+		for (i = 0; i < n; ++i)
+			if (keep[i]) {
+				++count;
+
+				if (cb != NULL)
+					cb (b, i, cookie);
+			}
+	}
+
+	groups_fini (group);
+	return count;
+}
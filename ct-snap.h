@@ -0,0 +1,91 @@
+/*
+ * Conntrack Table Snapshot
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CT_SNAP_H
+#define CT_SNAP_H  1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nfct-flush-net.h"
+
+/*
+ * Snapshot file is header followed by blocks of CT_SNAP_BLOCK entries
+ * each, the last one padded with zeroes. Block keeps entry fields as
+ * columns, thus a scan reads only columns it needs. Tuple columns are
+ * indexed by NFCT_NET_* flags: original destination, reply destination,
+ * original source, reply source. Addresses are in network byte order,
+ * IPv4 ones in the first four bytes, other fields in host byte order.
+ */
+#define CT_SNAP_MAGIC  "CTSNAP\0\1"
+#define CT_SNAP_BLOCK  4096
+
+struct ct_snap_head {
+	char magic[8];
+	uint32_t block;		/* entries per block			*/
+	uint32_t size;		/* of block				*/
+	uint64_t count;		/* of entries				*/
+	uint64_t time;		/* of capture, seconds since epoch	*/
+	uint64_t reserved[4];
+};
+
+struct ct_snap_block {
+	uint64_t addr[4][CT_SNAP_BLOCK][2];
+	uint32_t mark   [CT_SNAP_BLOCK];
+	uint32_t status [CT_SNAP_BLOCK];
+	uint32_t timeout[CT_SNAP_BLOCK];
+	uint16_t port[4][CT_SNAP_BLOCK];
+	uint16_t zone   [CT_SNAP_BLOCK];
+	uint8_t  family [CT_SNAP_BLOCK];
+	uint8_t  proto  [CT_SNAP_BLOCK];
+	uint8_t  state  [CT_SNAP_BLOCK];
+};
+
+struct ct_snap_entry {
+	unsigned char family, proto, state;
+	uint16_t zone, port[4];
+	uint32_t mark, status, timeout;
+	union nfct_addr addr[4];
+};
+
+/*
+ * Writer fills temporary file next to path given, close puts it in place
+ * and returns zero on failure
+ */
+struct ct_snap *ct_snap_create (const char *path);
+int ct_snap_add   (struct ct_snap *o, const struct ct_snap_entry *e);
+int ct_snap_close (struct ct_snap *o);
+
+struct ct_snap_map {
+	const struct ct_snap_head *head;
+	const struct ct_snap_block *block;
+	size_t blocks, size;
+};
+
+int  ct_snap_map   (struct ct_snap_map *o, const char *path);
+void ct_snap_unmap (struct ct_snap_map *o);
+
+/*
+ * Query matches entries with all fields given (negative ones are not
+ * checked) and address of tuple set by flags of a prefix inside any
+ * prefix of the set, if the set is not empty
+ */
+struct ct_snap_query {
+	const struct nfct_net *set;
+	size_t count;
+	int proto, zone;
+	int port, port_tuple;	/* NFCT_NET_* flags select port column	*/
+};
+
+typedef void ct_snap_cb (const struct ct_snap_block *b, unsigned i,
+			 void *cookie);
+
+long ct_snap_scan (const struct ct_snap_map *o, const struct ct_snap_query *q,
+		   ct_snap_cb *cb, void *cookie);
+
+#endif  /* CT_SNAP_H */
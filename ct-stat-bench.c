@@ -0,0 +1,95 @@
+/*
+ * Conntrack Table Statistics Benchmark
+ *
+ * Feeds synthetic entries with skewed destinations to aggregator and
+ * reports entries per second.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "ct-stat.h"
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t next (uint64_t *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 7;
+	*s ^= *s << 17;
+	return *s;
+}
+
+/*
+ * Quarter of entries go to 16 hot hosts, the rest spread over 16M ones
+ */
+static void make (struct ct_entry *e, size_t n)
+{
+	uint64_t s = 88172645463325252ull, r;
+	uint32_t a;
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		r = next (&s);
+		a = (r & 3) == 0 ? 0x0a000000 | (r >> 8 & 0xf) :
+				   0x0b000000 | (r >> 8 & 0xffffff);
+
+		memset (e + i, 0, sizeof (e[0]));
+
+		e[i].family = AF_INET;
+		e[i].proto  = r >> 40 & 3 ? IPPROTO_TCP : IPPROTO_UDP;
+		e[i].state  = e[i].proto == IPPROTO_TCP ? 3 : CT_STATE_NONE;
+		e[i].addr.in.s_addr = htonl (a);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	const size_t n = argc > 1 ? strtoul (argv[1], NULL, 0) : 4000000;
+	const unsigned k = argc > 2 ? strtoul (argv[2], NULL, 0) : 4096;
+	struct ct_entry *e;
+	struct ct_stat *o;
+	size_t i;
+	double t;
+
+	if ((e = malloc (n * sizeof (e[0]))) == NULL ||
+	    (o = ct_stat_alloc (k)) == NULL ||
+	    !ct_stat_track (o, AF_INET, 32) ||
+	    !ct_stat_track (o, AF_INET, 24) ||
+	    !ct_stat_track (o, AF_INET, 16)) {
+		perror ("ct-stat-bench");
+		return 1;
+	}
+
+	make (e, n);
+
+	t = now ();
+
+	for (i = 0; i < n; ++i)
+		ct_stat_add (o, e + i);
+
+	t = now () - t;
+
+	ct_stat_show (o, 20, stdout);
+	printf ("%zu entries in %.3fs, %.1f M entries/s, %.1f ns/entry\n",
+		n, t, n / t / 1e6, t * 1e9 / n);
+
+	ct_stat_free (o);
+	free (e);
+	return 0;
+}
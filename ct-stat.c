@@ -0,0 +1,356 @@
+/*
+ * Conntrack Table Statistics
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "ct-stat.h"
+
+#define TOP_MAX  8
+
+/*
+ * Space-Saving summary: k counters in min-heap by count, found by key via
+ * chained hash. New key takes over the least counter.
+ */
+struct top_item {
+	union nfct_addr key;
+	uint64_t count, error;
+	uint32_t hash;
+	int next;		/* in hash chain	*/
+	unsigned pos;		/* in heap		*/
+};
+
+struct top {
+	unsigned char family, len;
+	union nfct_addr mask;
+	unsigned k, n, hash_mask;
+	int *bucket;
+	unsigned *heap;
+	struct top_item *item;
+};
+
+struct ct_stat {
+	unsigned k, ntop;
+	struct top top[TOP_MAX];
+
+	uint64_t total, ipv4, ipv6;
+	uint64_t proto[256], state[16], zone[65536];
+};
+
+struct ct_stat *ct_stat_alloc (unsigned size)
+{
+	struct ct_stat *o;
+
+	if (size == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	o->k = size;
+	return o;
+}
+
+static void top_fini (struct top *t)
+{
+	free (t->bucket);
+	free (t->heap);
+	free (t->item);
+}
+
+void ct_stat_free (struct ct_stat *o)
+{
+	unsigned i;
+
+	if (o == NULL)
+		return;
+
+	for (i = 0; i < o->ntop; ++i)
+		top_fini (o->top + i);
+
+	free (o);
+}
+
+int ct_stat_track (struct ct_stat *o, int family, unsigned len)
+{
+	struct top *t = o->top + o->ntop;
+	unsigned char *m = (void *) &t->mask;
+	unsigned size, i;
+
+	if (o->ntop == TOP_MAX ||
+	    (family != AF_INET && family != AF_INET6) ||
+	    len > (family == AF_INET ? 32 : 128)) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	memset (t, 0, sizeof (*t));
+
+	for (i = 0, size = len; size > 0; ++i, size -= size < 8 ? size : 8)
+		m[i] = size < 8 ? 0xff00 >> size : 0xff;
+
+	t->family = family;
+	t->len    = len;
+	t->k      = o->k;
+
+	for (size = 1; size < o->k * 2; size <<= 1) {}
+
+	t->hash_mask = size - 1;
+	t->bucket    = malloc (size * sizeof (t->bucket[0]));
+	t->heap      = malloc (o->k * sizeof (t->heap[0]));
+	t->item      = malloc (o->k * sizeof (t->item[0]));
+
+	if (t->bucket == NULL || t->heap == NULL || t->item == NULL) {
+		top_fini (t);
+		return 0;
+	}
+
+	for (i = 0; i < size; ++i)
+		t->bucket[i] = -1;
+
+	++o->ntop;
+	return 1;
+}
+
+static uint32_t key_hash (const union nfct_addr *a)
+{
+	uint64_t h = (a->w[0] ^ a->w[1] * 0x9e3779b97f4a7c15) *
+		     0xbf58476d1ce4e5b9;
+
+	return h >> 32;
+}
+
+static void heap_swap (struct top *t, unsigned a, unsigned b)
+{
+	const unsigned i = t->heap[a], j = t->heap[b];
+
+	t->heap[a] = j, t->item[j].pos = a;
+	t->heap[b] = i, t->item[i].pos = b;
+}
+
+static uint64_t heap_count (struct top *t, unsigned pos)
+{
+	return t->item[t->heap[pos]].count;
+}
+
+static void heap_up (struct top *t, unsigned pos)
+{
+	unsigned parent;
+
+	for (; pos > 0; pos = parent) {
+		parent = (pos - 1) / 2;
+
+		if (heap_count (t, parent) <= heap_count (t, pos))
+			break;
+
+		heap_swap (t, parent, pos);
+	}
+}
+
+static void heap_down (struct top *t, unsigned pos)
+{
+	unsigned c;
+
+	for (; (c = pos * 2 + 1) < t->n; pos = c) {
+		if (c + 1 < t->n && heap_count (t, c + 1) < heap_count (t, c))
+			++c;
+
+		if (heap_count (t, pos) <= heap_count (t, c))
+			break;
+
+		heap_swap (t, pos, c);
+	}
+}
+
+static void chain_del (struct top *t, unsigned i)
+{
+	int *p;
+
+	for (p = t->bucket + (t->item[i].hash & t->hash_mask); *p != i;
+	     p = &t->item[*p].next) {}
+
+	*p = t->item[i].next;
+}
+
+static void chain_add (struct top *t, unsigned i)
+{
+	int *p = t->bucket + (t->item[i].hash & t->hash_mask);
+
+	t->item[i].next = *p;
+	*p = i;
+}
+
+static void top_add (struct top *t, const union nfct_addr *a)
+{
+	union nfct_addr key;
+	struct top_item *e;
+	uint32_t h;
+	int i;
+
+	key.w[0] = a->w[0] & t->mask.w[0];
+	key.w[1] = a->w[1] & t->mask.w[1];
+	h = key_hash (&key);
+
+	for (i = t->bucket[h & t->hash_mask]; i >= 0; i = e->next) {
+		e = t->item + i;
+
+		if (e->hash == h && e->key.w[0] == key.w[0] &&
+		    e->key.w[1] == key.w[1]) {
+			++e->count;
+			heap_down (t, e->pos);
+			return;
+		}
+	}
+
+	if (t->n < t->k) {
+		i = t->n++;
+		e = t->item + i;
+		e->count = 1;
+		e->error = 0;
+		e->pos   = i;
+		t->heap[i] = i;
+	}
+	else {
+		i = t->heap[0];
+		e = t->item + i;
+		chain_del (t, i);
+		e->error = e->count++;
+	}
+
+	e->key  = key;
+	e->hash = h;
+	chain_add (t, i);
+
+	if (e->count == 1)
+		heap_up (t, e->pos);
+	else
+		heap_down (t, e->pos);
+}
+
+void ct_stat_add (struct ct_stat *o, const struct ct_entry *e)
+{
+	unsigned i;
+
+	++o->total;
+
+	if (e->family == AF_INET)
+		++o->ipv4;
+	else if (e->family == AF_INET6)
+		++o->ipv6;
+
+	++o->proto[e->proto];
+	++o->zone[e->zone];
+
+	if (e->state != CT_STATE_NONE)
+		++o->state[e->state & 15];
+
+	for (i = 0; i < o->ntop; ++i)
+		if (o->top[i].family == e->family)
+			top_add (o->top + i, &e->addr);
+}
+
+static const char *proto_name (unsigned proto)
+{
+	switch (proto) {
+	case IPPROTO_ICMP:	return "icmp";
+	case IPPROTO_TCP:	return "tcp";
+	case IPPROTO_UDP:	return "udp";
+	case IPPROTO_GRE:	return "gre";
+	case IPPROTO_ESP:	return "esp";
+	case IPPROTO_ICMPV6:	return "icmpv6";
+	case IPPROTO_SCTP:	return "sctp";
+	case IPPROTO_UDPLITE:	return "udplite";
+	}
+
+	return NULL;
+}
+
+static const char *state_name[16] = {
+	"none", "syn-sent", "syn-recv", "established", "fin-wait",
+	"close-wait", "last-ack", "time-wait", "close", "syn-sent2",
+};
+
+static int item_cmp (const void *a, const void *b)
+{
+	const struct top_item *p = a, *q = b;
+
+	return p->count < q->count ? 1 : p->count > q->count ? -1 : 0;
+}
+
+static void top_show (struct top *t, unsigned top, FILE *to)
+{
+	struct top_item *list;
+	char buf[INET6_ADDRSTRLEN];
+	unsigned i;
+
+	if ((list = malloc (t->n * sizeof (list[0]))) == NULL)
+		return;
+
+	memcpy (list, t->item, t->n * sizeof (list[0]));
+	qsort (list, t->n, sizeof (list[0]), item_cmp);
+
+	for (i = 0; i < t->n && i < top; ++i) {
+		inet_ntop (t->family, &list[i].key, buf, sizeof (buf));
+		fprintf (to, "prefix %s/%u %llu", buf, t->len,
+			 (unsigned long long) list[i].count);
+
+		if (list[i].error > 0)
+			fprintf (to, " error %llu",
+				 (unsigned long long) list[i].error);
+
+		fprintf (to, "\n");
+	}
+
+	free (list);
+}
+
+void ct_stat_show (struct ct_stat *o, unsigned top, FILE *to)
+{
+	const char *name;
+	unsigned i;
+
+	fprintf (to, "total %llu ipv4 %llu ipv6 %llu\n",
+		 (unsigned long long) o->total, (unsigned long long) o->ipv4,
+		 (unsigned long long) o->ipv6);
+
+	for (i = 0; i < 256; ++i)
+		if (o->proto[i] > 0) {
+			if ((name = proto_name (i)) != NULL)
+				fprintf (to, "proto %s", name);
+			else
+				fprintf (to, "proto %u", i);
+
+			fprintf (to, " %llu\n",
+				 (unsigned long long) o->proto[i]);
+		}
+
+	for (i = 0; i < 16; ++i)
+		if (o->state[i] > 0) {
+			if (state_name[i] != NULL)
+				fprintf (to, "state %s", state_name[i]);
+			else
+				fprintf (to, "state %u", i);
+
+			fprintf (to, " %llu\n",
+				 (unsigned long long) o->state[i]);
+		}
+
+	for (i = 0; i < 65536; ++i)
+		if (o->zone[i] > 0)
+			fprintf (to, "zone %u %llu\n", i,
+				 (unsigned long long) o->zone[i]);
+
+	for (i = 0; i < o->ntop; ++i)
+		top_show (o->top + i, top, to);
+}
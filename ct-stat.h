@@ -0,0 +1,39 @@
+/*
+ * Conntrack Table Statistics
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef CT_STAT_H
+#define CT_STAT_H  1
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "nfct-flush-net.h"
+
+#define CT_STATE_NONE  0xff	/* not a TCP entry */
+
+struct ct_entry {
+	unsigned char family, proto, state;
+	uint16_t zone;
+	union nfct_addr addr;
+};
+
+/*
+ * Aggregates entries in memory fixed at allocation: counters per family,
+ * protocol, TCP state and zone, and the most frequent prefixes of every
+ * length tracked. Top prefixes are found with Space-Saving sketch of size
+ * counters: any prefix holding more than 1/size of entries is there, count
+ * shown is never below the true one and exceeds it at most by error shown.
+ */
+struct ct_stat *ct_stat_alloc (unsigned size);
+void ct_stat_free (struct ct_stat *o);
+
+int  ct_stat_track (struct ct_stat *o, int family, unsigned len);
+void ct_stat_add   (struct ct_stat *o, const struct ct_entry *e);
+void ct_stat_show  (struct ct_stat *o, unsigned top, FILE *to);
+
+#endif  /* CT_STAT_H */
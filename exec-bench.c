@@ -0,0 +1,122 @@
+/*
+ * Process Footprint Benchmark
+ *
+ * Runs command several times with its output discarded and reports wall
+ * time from fork to exit and peak resident set size of the child.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp (const void *a, const void *b)
+{
+	const double x = *(const double *) a, y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Returns wall time of run in seconds and stores peak RSS in KiB and exit
+ * status, or returns -1 if command was killed or not started. Daemons fed
+ * by canned streams exit with failure, so other exit codes are counted.
+ */
+static double run (char *argv[], long *rss, int *code)
+{
+	struct rusage ru;
+	double t = now ();
+	pid_t pid;
+	int status, fd;
+
+	if ((pid = fork ()) == -1)
+		return -1;
+
+	if (pid == 0) {
+		if ((fd = open ("/dev/null", O_WRONLY)) != -1) {
+			dup2 (fd, 1);
+			dup2 (fd, 2);
+		}
+
+		execvp (argv[0], argv);
+		perror (argv[0]);
+		_exit (127);
+	}
+
+	if (wait4 (pid, &status, 0, &ru) != pid ||
+	    !WIFEXITED (status) || WEXITSTATUS (status) == 127)
+		return -1;
+
+	*rss  = ru.ru_maxrss;
+	*code = WEXITSTATUS (status);
+	return now () - t;
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n\texec-bench [-n runs] command [args]\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned runs = 20, i, failed = 0;
+	long rss, max = 0;
+	double *wall;
+	int c, code;
+
+	while ((c = getopt (argc, argv, "+n:")) != -1)
+		switch (c) {
+		case 'n':  runs = strtoul (optarg, NULL, 0); break;
+		default:
+			return usage ();
+		}
+
+	if (optind >= argc || runs == 0)
+		return usage ();
+
+	if ((wall = calloc (runs, sizeof (wall[0]))) == NULL) {
+		perror ("exec-bench");
+		return 1;
+	}
+
+	for (i = 0; i < runs; ++i) {
+		if ((wall[i] = run (argv + optind, &rss, &code)) < 0) {
+			fprintf (stderr, "exec-bench: %s failed\n",
+				 argv[optind]);
+			return 1;
+		}
+
+		max = rss > max ? rss : max;
+		failed += code != 0;
+	}
+
+	qsort (wall, runs, sizeof (wall[0]), cmp);
+
+	printf ("wall p50 %.3f min %.3f ms, max rss %ld KiB",
+		wall[runs / 2] * 1e3, wall[0] * 1e3, max);
+
+	if (failed > 0)
+		printf (", %u of %u runs failed", failed, runs);
+
+	printf ("\n");
+
+	free (wall);
+	return 0;
+}
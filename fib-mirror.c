@@ -0,0 +1,337 @@
+/*
+ * Forwarding Information Base Mirror
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+
+#include "fib-mirror.h"
+
+/*
+ * Plain binary trie: one node per prefix bit, routes of a prefix are kept
+ * sorted by metric, thus the first one is the active one
+ */
+struct fib_route {
+	struct fib_route *next;
+	struct fib_nh nh;
+	unsigned gen;		/* of mark last seen at */
+};
+
+struct fib_node {
+	struct fib_node *child[2];
+	struct fib_route *routes;
+};
+
+struct fib {
+	struct fib_node *root[2];
+	unsigned gen;
+};
+
+static int fib_index (int family)
+{
+	return family == AF_INET ? 0 : family == AF_INET6 ? 1 : -1;
+}
+
+static unsigned fib_bits (int family)
+{
+	return family == AF_INET ? 32 : 128;
+}
+
+static int get_bit (const unsigned char *a, unsigned i)
+{
+	return a[i / 8] >> (7 - i % 8) & 1;
+}
+
+static void set_bit (unsigned char *a, unsigned i, int v)
+{
+	const unsigned char m = 0x80 >> (i % 8);
+
+	a[i / 8] = v ? a[i / 8] | m : a[i / 8] & ~m;
+}
+
+struct fib *fib_alloc (void)
+{
+	return calloc (1, sizeof (struct fib));
+}
+
+static void node_free (struct fib_node *n)
+{
+	struct fib_route *r, *next;
+
+	if (n == NULL)
+		return;
+
+	for (r = n->routes; r != NULL; r = next) {
+		next = r->next;
+		free (r);
+	}
+
+	node_free (n->child[0]);
+	node_free (n->child[1]);
+	free (n);
+}
+
+void fib_free (struct fib *o)
+{
+	if (o == NULL)
+		return;
+
+	node_free (o->root[0]);
+	node_free (o->root[1]);
+	free (o);
+}
+
+int fib_add (struct fib *o, int family, const void *prefix, unsigned len,
+	     const struct fib_nh *nh)
+{
+	const int i = fib_index (family);
+	struct fib_node **p, *n;
+	struct fib_route **pr, *r;
+	unsigned d;
+
+	if (i < 0 || len > fib_bits (family)) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	for (p = &o->root[i], d = 0;; ++d) {
+		if (*p == NULL && (*p = calloc (1, sizeof (**p))) == NULL)
+			return 0;
+
+		n = *p;
+
+		if (d == len)
+			break;
+
+		p = &n->child[get_bit (prefix, d)];
+	}
+
+	for (pr = &n->routes; *pr != NULL; pr = &(*pr)->next)
+		if ((*pr)->nh.metric == nh->metric) {
+			(*pr)->nh  = *nh;
+			(*pr)->gen = o->gen;
+			return 1;
+		}
+
+	if ((r = malloc (sizeof (*r))) == NULL)
+		return 0;
+
+	r->nh  = *nh;
+	r->gen = o->gen;
+
+	for (pr = &n->routes; *pr != NULL; pr = &(*pr)->next)
+		if ((*pr)->nh.metric > nh->metric)
+			break;
+
+	r->next = *pr;
+	*pr = r;
+	return 1;
+}
+
+static int reachable (const struct fib_nh *o)
+{
+	return o != NULL && o->type == RTN_UNICAST;
+}
+
+static int same_egress (const struct fib_nh *a, const struct fib_nh *b)
+{
+	return a->type == b->type && a->oif == b->oif &&
+	       a->multipath == b->multipath &&
+	       memcmp (a->via, b->via, sizeof (a->via)) == 0;
+}
+
+/*
+ * Reports parts of the range at node n not covered by more specific
+ * routes, top is the depth of the range root
+ */
+static int uncovered (struct fib_node *n, int family, unsigned char *a,
+		      unsigned d, unsigned top, fib_range_cb *cb, void *cookie)
+{
+	int count = 0, ret, b;
+
+	if (n != NULL && d > top && n->routes != NULL)
+		return 0;
+
+	if (n == NULL || (n->child[0] == NULL && n->child[1] == NULL))
+		return cb (family, a, d, cookie) < 0 ? -1 : 1;
+
+	for (b = 0; b < 2; ++b) {
+		set_bit (a, d, b);
+
+		ret = uncovered (n->child[b], family, a, d + 1, top, cb, cookie);
+		if (ret < 0)
+			return ret;
+
+		count += ret;
+	}
+
+	set_bit (a, d, 0);
+	return count;
+}
+
+static void prune (struct fib *o, int i, struct fib_node **path,
+		   const unsigned char *prefix, unsigned len)
+{
+	struct fib_node *n;
+
+	for (; (n = path[len])->routes == NULL &&
+	       n->child[0] == NULL && n->child[1] == NULL; --len) {
+		free (n);
+
+		if (len == 0) {
+			o->root[i] = NULL;
+			break;
+		}
+
+		path[len - 1]->child[get_bit (prefix, len - 1)] = NULL;
+	}
+}
+
+int fib_del (struct fib *o, int family, const void *prefix, unsigned len,
+	     const struct fib_nh *nh, fib_range_cb *cb, void *cookie)
+{
+	const int i = fib_index (family);
+	struct fib_node *path[129], *n;
+	struct fib_route **pr, *r;
+	const struct fib_nh *cover = NULL, *next;
+	unsigned char a[16] = {};
+	unsigned d;
+	int count = 0;
+
+	if (i < 0 || len > fib_bits (family)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (d = 0; d < len; ++d)
+		set_bit (a, d, get_bit (prefix, d));
+
+	for (n = o->root[i], d = 0; n != NULL && d < len; ++d) {
+		if (n->routes != NULL)
+			cover = &n->routes->nh;
+
+		path[d] = n;
+		n = n->child[get_bit (prefix, d)];
+	}
+
+	if (n == NULL)  /* unknown prefix: all of it is affected */
+		return cb (family, a, len, cookie) < 0 ? -1 : 1;
+
+	path[len] = n;
+
+	for (pr = &n->routes; (r = *pr) != NULL; pr = &r->next)
+		if (r->nh.metric == nh->metric)
+			break;
+
+	if (r == NULL)  /* unknown route: assume it was the active one */
+		return uncovered (n, family, a, len, len, cb, cookie);
+
+	*pr = r->next;
+
+	if (pr == &n->routes) {
+		next = n->routes != NULL ? &n->routes->nh : cover;
+
+		if (reachable (&r->nh) &&
+		    (!reachable (next) || !same_egress (&r->nh, next)))
+			count = uncovered (n, family, a, len, len, cb, cookie);
+	}
+
+	prune (o, i, path, prefix, len);
+	free (r);
+	return count;
+}
+
+void fib_mark (struct fib *o)
+{
+	++o->gen;
+}
+
+struct stale {
+	unsigned char prefix[16];
+	unsigned char family, len;
+	struct fib_nh nh;
+};
+
+struct stale_list {
+	struct stale *item;
+	size_t count, size;
+};
+
+static int stale_add (struct stale_list *o, int family, const unsigned char *a,
+		      unsigned len, const struct fib_nh *nh)
+{
+	struct stale *p;
+	size_t size;
+
+	if (o->count == o->size) {
+		size = o->size > 0 ? o->size * 2 : 64;
+
+		if ((p = realloc (o->item, size * sizeof (p[0]))) == NULL)
+			return 0;
+
+		o->item = p;
+		o->size = size;
+	}
+
+	p = o->item + o->count++;
+
+	memcpy (p->prefix, a, sizeof (p->prefix));
+	p->family = family;
+	p->len    = len;
+	p->nh     = *nh;
+	return 1;
+}
+
+static int stale_find (struct stale_list *o, const struct fib *fib,
+		       struct fib_node *n, int family, unsigned char *a,
+		       unsigned d)
+{
+	struct fib_route *r;
+	int b, ok = 1;
+
+	for (r = n->routes; r != NULL; r = r->next)
+		if (r->gen != fib->gen && !stale_add (o, family, a, d, &r->nh))
+			return 0;
+
+	for (b = 0; b < 2 && ok; ++b)
+		if (n->child[b] != NULL) {
+			set_bit (a, d, b);
+			ok = stale_find (o, fib, n->child[b], family, a, d + 1);
+			set_bit (a, d, 0);
+		}
+
+	return ok;
+}
+
+int fib_sweep (struct fib *o, fib_range_cb *cb, void *cookie)
+{
+	static const int family[2] = { AF_INET, AF_INET6 };
+	struct stale_list l = {};
+	unsigned char a[16] = {};
+	size_t i;
+	int count = 0, ret = 0, f;
+
+	for (f = 0; f < 2; ++f)
+		if (o->root[f] != NULL &&
+		    !stale_find (&l, o, o->root[f], family[f], a, 0)) {
+			free (l.item);
+			return -1;
+		}
+
+	for (i = 0; i < l.count && ret >= 0; ++i) {
+		ret = fib_del (o, l.item[i].family, l.item[i].prefix,
+			       l.item[i].len, &l.item[i].nh, cb, cookie);
+		count += ret;
+	}
+
+	free (l.item);
+	return ret < 0 ? -1 : count;
+}
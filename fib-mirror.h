@@ -0,0 +1,52 @@
+/*
+ * Forwarding Information Base Mirror
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef FIB_MIRROR_H
+#define FIB_MIRROR_H  1
+
+#include <stdint.h>
+
+/*
+ * Route next hop as seen by forwarding: only unicast routes make the
+ * destination reachable, multipath next hops are compared by hash
+ */
+struct fib_nh {
+	unsigned metric;
+	int oif;
+	unsigned char type;
+	unsigned char via[16];
+	uint32_t multipath;
+};
+
+struct fib *fib_alloc (void);
+void fib_free (struct fib *o);
+
+int fib_add (struct fib *o, int family, const void *prefix, unsigned len,
+	     const struct fib_nh *nh);
+
+/*
+ * Removes route and calls back for every sub-range of the deleted prefix
+ * that either became unreachable or changed egress. Ranges still routed
+ * by more specific prefixes are not reported. Returns number of ranges
+ * reported or -1 on error.
+ */
+typedef int fib_range_cb (int family, const void *prefix, unsigned len,
+			  void *cookie);
+
+int fib_del (struct fib *o, int family, const void *prefix, unsigned len,
+	     const struct fib_nh *nh, fib_range_cb *cb, void *cookie);
+
+/*
+ * Resynchronization: mark starts new generation, routes added since then
+ * (by a dump) are kept by sweep, others are deleted as above. Sweep
+ * returns number of ranges reported or -1 on error.
+ */
+void fib_mark  (struct fib *o);
+int  fib_sweep (struct fib *o, fib_range_cb *cb, void *cookie);
+
+#endif  /* FIB_MIRROR_H */
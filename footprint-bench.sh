@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# Compares startup time, peak RSS and size of tools built with libnl and
+# libnetfilter_conntrack against ones built with own netlink core
+# (NETLINK=raw), fed by tiny canned streams, see nl-canned.h. Benchmark
+# builds of tools are run as only they read canned streams, so canned hook
+# and allocation counter are counted too. Size is of executable alone,
+# shared libraries are not counted.
+#
+# Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+
+set -e
+
+RUNS=${RUNS:-50}
+DIR=${DIR:-/tmp/footprint-bench}
+SRC=$(dirname "$0")
+TOOLS="route-show route-monitor udhcpc-monitor conntrack-flush conntrack-stat"
+TOOLS="$TOOLS conntrack-nat-callidus"
+BENCH=$(for t in $TOOLS; do echo "$t-bench"; done)
+
+mkdir -p "$DIR/libs" "$DIR/raw"
+
+for v in libs raw; do
+	make -s -C "$SRC" clean
+	make -s -C "$SRC" NETLINK=$v $BENCH nl-gen exec-bench >/dev/null
+	(cd "$SRC" && cp $BENCH nl-gen exec-bench "$DIR/$v")
+done
+
+make -s -C "$SRC" clean
+
+BIN="$DIR/raw"
+
+"$BIN/nl-gen" links 4		> "$DIR/links"
+"$BIN/nl-gen" routes 16		> "$DIR/routes"
+"$BIN/nl-gen" conntrack 16	> "$DIR/conntrack"
+
+cat "$DIR/links" "$DIR/routes" > "$DIR/monitor"
+
+run () {
+	name=$1 args=$2
+	shift 2
+
+	for v in libs raw; do
+		printf "%-24s%-6s%8s B  " "$name" "$v" \
+			$(stat -c %s "$DIR/$v/$name-bench")
+		env "$@" "$BIN/exec-bench" -n $RUNS "$DIR/$v/$name-bench" $args ||
+			true
+	done
+}
+
+run route-show "" NL_CANNED="$DIR/routes"
+run route-monitor "" NL_CANNED="$DIR/monitor"
+run udhcpc-monitor "" NL_CANNED="$DIR/links"
+run conntrack-flush "-D 198.18.0.0/24" NFCT_CANNED="$DIR/conntrack"
+run conntrack-stat "" NFCT_CANNED="$DIR/conntrack"
+run conntrack-nat-callidus "" NL_CANNED="$DIR/routes" \
+	NFCT_CANNED="$DIR/conntrack"
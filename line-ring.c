@@ -0,0 +1,277 @@
+/*
+ * Text Line Ring with Writer Thread
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "line-ring.h"
+
+/*
+ * Head and tail are positions of consumer and producer, never wrapped.
+ * The side going to sleep sets its flag and checks the other position
+ * again under lock, the other side signals under lock if flag is set,
+ * thus no wakeup is lost.
+ */
+struct line_ring {
+	char *buf;
+	size_t size;
+	size_t head, tail;
+	int waiting, blocked, stop, error;
+
+	int fd;
+	enum line_ring_policy policy;
+	const char *const *kinds;
+	unsigned count;
+	unsigned long *lost, total;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t data, space;
+};
+
+#define LOAD(p)      __atomic_load_n  (p, __ATOMIC_SEQ_CST)
+#define STORE(p, v)  __atomic_store_n (p, v, __ATOMIC_SEQ_CST)
+
+static void wake (struct line_ring *o, int *flag, pthread_cond_t *c)
+{
+	if (!LOAD (flag))
+		return;
+
+	pthread_mutex_lock (&o->lock);
+	pthread_cond_signal (c);
+	pthread_mutex_unlock (&o->lock);
+}
+
+static int write_all (int fd, const char *p, size_t size)
+{
+	ssize_t len;
+
+	for (; size > 0; p += len, size -= len)
+		if ((len = write (fd, p, size)) < 0) {
+			if (errno != EINTR)
+				return 0;
+
+			len = 0;
+		}
+
+	return 1;
+}
+
+static void *writer (void *cookie)
+{
+	struct line_ring *o = cookie;
+	size_t head = o->head, tail, off, n;
+
+	for (;;) {
+		if ((tail = LOAD (&o->tail)) == head) {
+			if (LOAD (&o->stop))
+				break;
+
+			pthread_mutex_lock (&o->lock);
+			STORE (&o->waiting, 1);
+
+			if (LOAD (&o->tail) == head && !LOAD (&o->stop))
+				pthread_cond_wait (&o->data, &o->lock);
+
+			STORE (&o->waiting, 0);
+			pthread_mutex_unlock (&o->lock);
+			continue;
+		}
+
+		off = head & (o->size - 1);
+		n   = tail - head < o->size - off ? tail - head : o->size - off;
+
+		if (!write_all (o->fd, o->buf + off, n)) {
+			STORE (&o->error, errno);
+			wake (o, &o->blocked, &o->space);
+			break;
+		}
+
+		STORE (&o->head, head += n);
+		wake (o, &o->blocked, &o->space);
+	}
+
+	return NULL;
+}
+
+struct line_ring *
+line_ring_alloc (int fd, size_t size, enum line_ring_policy policy,
+		 const char *const *kinds, unsigned count)
+{
+	struct line_ring *o;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	for (o->size = 4096; o->size < size; o->size *= 2) {}
+
+	o->fd     = fd;
+	o->policy = policy;
+	o->kinds  = kinds;
+	o->count  = count;
+
+	if ((o->buf  = malloc (o->size)) == NULL ||
+	    (o->lost = calloc (count, sizeof (o->lost[0]))) == NULL)
+		goto no_buf;
+
+	pthread_mutex_init (&o->lock, NULL);
+	pthread_cond_init (&o->data, NULL);
+	pthread_cond_init (&o->space, NULL);
+
+	if ((errno = pthread_create (&o->thread, NULL, writer, o)) != 0)
+		goto no_thread;
+
+	return o;
+no_thread:
+	pthread_cond_destroy (&o->space);
+	pthread_cond_destroy (&o->data);
+	pthread_mutex_destroy (&o->lock);
+no_buf:
+	free (o->lost);
+	free (o->buf);
+	free (o);
+	return NULL;
+}
+
+static size_t space (struct line_ring *o)
+{
+	return o->size - (o->tail - LOAD (&o->head));
+}
+
+/*
+ * Waits for space, returns zero if writer failed
+ */
+static int wait_space (struct line_ring *o, size_t len)
+{
+	pthread_mutex_lock (&o->lock);
+	STORE (&o->blocked, 1);
+
+	while (space (o) < len && !LOAD (&o->error))
+		pthread_cond_wait (&o->space, &o->lock);
+
+	STORE (&o->blocked, 0);
+	pthread_mutex_unlock (&o->lock);
+
+	return !LOAD (&o->error);
+}
+
+static void push (struct line_ring *o, const char *line, size_t len)
+{
+	const size_t off = o->tail & (o->size - 1);
+	const size_t n = len < o->size - off ? len : o->size - off;
+
+	memcpy (o->buf + off, line, n);
+	memcpy (o->buf, line + n, len - n);
+
+	STORE (&o->tail, o->tail + len);
+	wake (o, &o->waiting, &o->data);
+}
+
+static size_t format_lost (struct line_ring *o, char *buf, size_t size)
+{
+	size_t len;
+	unsigned i;
+	const char *sep = ": ";
+
+	if (o->policy != LINE_RING_SUMMARY)
+		return snprintf (buf, size, "gap: %lu events lost\n",
+				 o->total);
+
+	len = snprintf (buf, size, "summary: %lu events", o->total);
+
+	for (i = 0; i < o->count && len < size; ++i)
+		if (o->lost[i] > 0) {
+			len += snprintf (buf + len, size - len, "%s%lu %s",
+					 sep, o->lost[i], o->kinds[i]);
+			sep = ", ";
+		}
+
+	return len < size - 1 ? len + sprintf (buf + len, "\n") : size - 1;
+}
+
+/*
+ * Puts line of lost events if there is room for it and the next line, in
+ * summary mode only once ring is half empty
+ */
+static int recover (struct line_ring *o, size_t next, int wait)
+{
+	char buf[512];
+	size_t len = format_lost (o, buf, sizeof (buf));
+
+	if (o->policy == LINE_RING_SUMMARY && !wait &&
+	    space (o) < o->size / 2)
+		return 0;
+
+	if (space (o) < len + next && !(wait && wait_space (o, len)))
+		return 0;
+
+	push (o, buf, len);
+	memset (o->lost, 0, o->count * sizeof (o->lost[0]));
+	o->total = 0;
+	return 1;
+}
+
+static int drop (struct line_ring *o, unsigned kind)
+{
+	if (kind < o->count)
+		++o->lost[kind];
+
+	++o->total;
+	return 0;
+}
+
+int line_ring_put (struct line_ring *o, unsigned kind, const char *line,
+		   size_t len)
+{
+	if (len > o->size / 2 || LOAD (&o->error))
+		return drop (o, kind);
+
+	if (o->total > 0 && !recover (o, len, 0))
+		return drop (o, kind);
+
+	if (space (o) < len &&
+	    (o->policy != LINE_RING_BLOCK || !wait_space (o, len)))
+		return drop (o, kind);
+
+	push (o, line, len);
+	return 1;
+}
+
+int line_ring_free (struct line_ring *o)
+{
+	int error;
+
+	if (o->total > 0 && !LOAD (&o->error))
+		recover (o, 0, 1);
+
+	pthread_mutex_lock (&o->lock);
+	STORE (&o->stop, 1);
+	pthread_cond_signal (&o->data);
+	pthread_mutex_unlock (&o->lock);
+
+	pthread_join (o->thread, NULL);
+
+	pthread_cond_destroy (&o->space);
+	pthread_cond_destroy (&o->data);
+	pthread_mutex_destroy (&o->lock);
+
+	error = o->error;
+
+	free (o->lost);
+	free (o->buf);
+	free (o);
+
+	if (error != 0)
+		errno = error;
+
+	return error == 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Text Line Ring with Writer Thread
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef LINE_RING_H
+#define LINE_RING_H  1
+
+#include <stddef.h>
+
+/*
+ * Single producer puts lines of text into ring, writer thread writes them
+ * to file descriptor. When ring is full the producer either waits for
+ * space, or drops lines and later puts "gap: N events lost" line, or
+ * drops lines counting them by kind and puts summary line of counts once
+ * the ring is half empty again.
+ */
+enum line_ring_policy {
+	LINE_RING_BLOCK,
+	LINE_RING_DROP,
+	LINE_RING_SUMMARY,
+};
+
+/*
+ * Size is rounded up to power of two, kinds names event kinds for summary
+ * lines and must stay valid while ring is in use
+ */
+struct line_ring *
+line_ring_alloc (int fd, size_t size, enum line_ring_policy policy,
+		 const char *const *kinds, unsigned count);
+
+/*
+ * Writes all lines queued and stops writer thread, returns zero if write
+ * failed (errno is set then)
+ */
+int line_ring_free (struct line_ring *o);
+
+/*
+ * Returns 1 if line was queued, 0 if it was dropped
+ */
+int line_ring_put (struct line_ring *o, unsigned kind, const char *line,
+		   size_t len);
+
+#endif  /* LINE_RING_H */
@@ -0,0 +1,287 @@
+/*
+ * Interface Statistics Sampler
+ *
+ * Takes counters of all interfaces with single netlink dump per sample
+ * and shows rates or deltas of links changed as text, JSON lines or
+ * binary records, see rt-stats.h.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+
+#include "nl-core.h"
+#include "rt-stats.h"
+
+enum format { TEXT, JSON, BINARY };
+
+struct sample {
+	double time;		/* since epoch				*/
+	double interval;	/* since previous sample, seconds	*/
+	int all;		/* show links without changes too	*/
+};
+
+static double now (int clock)
+{
+	struct timespec ts;
+
+	clock_gettime (clock, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int changed (const struct rt_stats_link *l)
+{
+	unsigned i;
+
+	for (i = 0; i < RT_STATS_COUNT; ++i)
+		if (l->delta[i] != 0)
+			return 1;
+
+	return 0;
+}
+
+static int skip (const struct sample *s, const struct rt_stats_link *l)
+{
+	return (l->flags & RT_STATS_NEW) != 0 || (!s->all && !changed (l));
+}
+
+static void show_text (const struct sample *s, const struct rt_stats_link *l,
+		       unsigned count)
+{
+	const double k = s->interval > 0 ? 1 / s->interval : 0;
+	unsigned i;
+
+	for (i = 0; i < count; ++i, ++l) {
+		if (skip (s, l))
+			continue;
+
+		printf ("%.3f %s rx %.0f B/s %.0f p/s tx %.0f B/s %.0f p/s "
+			"err %llu %llu drop %llu %llu\n", s->time, l->name,
+			l->delta[RT_RX_BYTES] * k, l->delta[RT_RX_PACKETS] * k,
+			l->delta[RT_TX_BYTES] * k, l->delta[RT_TX_PACKETS] * k,
+			(unsigned long long) l->delta[RT_RX_ERRORS],
+			(unsigned long long) l->delta[RT_TX_ERRORS],
+			(unsigned long long) l->delta[RT_RX_DROPPED],
+			(unsigned long long) l->delta[RT_TX_DROPPED]);
+	}
+}
+
+static void show_json_str (const char *p)
+{
+	putchar ('"');
+
+	for (; *p != '\0'; ++p)
+		if (*p == '"' || *p == '\\')
+			printf ("\\%c", *p);
+		else if ((unsigned char) *p < 0x20)
+			printf ("\\u%04x", *p);
+		else
+			putchar (*p);
+
+	putchar ('"');
+}
+
+static void show_json (const struct sample *s, const struct rt_stats_link *l,
+		       unsigned count)
+{
+	const char *sep = "";
+	unsigned i, j;
+
+	printf ("{\"time\":%.3f,\"interval\":%.6f,\"links\":[", s->time,
+		s->interval);
+
+	for (i = 0; i < count; ++i, ++l) {
+		if (skip (s, l))
+			continue;
+
+		printf ("%s{\"index\":%d,\"name\":", sep, l->index);
+		show_json_str (l->name);
+
+		for (j = 0; j < RT_STATS_COUNT; ++j)
+			printf (",\"%s\":%llu", rt_stats_name[j],
+				(unsigned long long) l->delta[j]);
+
+		putchar ('}');
+		sep = ",";
+	}
+
+	printf ("]}\n");
+}
+
+static void show_binary (const struct sample *s,
+			 const struct rt_stats_link *l, unsigned count)
+{
+	struct rt_stats_head head = {};
+	struct rt_stats_rec rec = {};
+	unsigned i;
+
+	for (i = 0; i < count; ++i)
+		head.count += !skip (s, l + i);
+
+	head.time     = s->time * 1e9;
+	head.interval = s->interval * 1e6;
+
+	fwrite (&head, sizeof (head), 1, stdout);
+
+	for (i = 0; i < count; ++i, ++l) {
+		if (skip (s, l))
+			continue;
+
+		rec.index = l->index;
+		rec.flags = l->flags;
+		memcpy (rec.name,  l->name,  sizeof (rec.name));
+		memcpy (rec.delta, l->delta, sizeof (rec.delta));
+
+		fwrite (&rec, sizeof (rec), 1, stdout);
+	}
+}
+
+/*
+ * Sleeps up to next tick, ticks missed are skipped
+ */
+static void pace (struct timespec *next, unsigned interval)
+{
+	struct timespec ts;
+
+	next->tv_nsec += interval % 1000 * 1000000L;
+	next->tv_sec  += interval / 1000 + next->tv_nsec / 1000000000;
+	next->tv_nsec %= 1000000000;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	if (ts.tv_sec > next->tv_sec ||
+	    (ts.tv_sec == next->tv_sec && ts.tv_nsec > next->tv_nsec)) {
+		*next = ts;
+		return;
+	}
+
+	while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, next, NULL)
+	       == EINTR) {}
+}
+
+static void report (unsigned samples, unsigned links, double start)
+{
+	const double wall = now (CLOCK_MONOTONIC) - start;
+	struct rusage ru;
+	double cpu;
+
+	getrusage (RUSAGE_SELF, &ru);
+
+	cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	      ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+	fprintf (stderr, "link-stats: %u samples of %u links in %.1fs, "
+			 "cpu %.3fs (%.2f%% of core), %.3f ms per sample\n",
+		 samples, links, wall, cpu, wall > 0 ? cpu / wall * 100 : 0,
+		 samples > 0 ? cpu / samples * 1e3 : 0);
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n"
+			 "\tlink-stats [-i interval-ms] [-c count] "
+			 "[-f text|json|binary] [-l] [-a] [-v]\n"
+			 "\n"
+			 "\t-i  sample every interval, 1000 ms by default\n"
+			 "\t-c  stop after count samples shown\n"
+			 "\t-f  show rates as text, or deltas as JSON lines "
+			 "or binary records\n"
+			 "\t-l  use link dump instead of statistics one, "
+			 "for old kernels\n"
+			 "\t-a  show links without changes too\n"
+			 "\t-v  report CPU time used on exit\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	static char buf[1 << 20];
+	enum format format = TEXT;
+	unsigned interval = 1000, count = 0, n = 0, i;
+	int getlink = 0, verbose = 0, c, ret;
+	struct sample s = {};
+	const struct rt_stats_link *l;
+	struct rt_stats *o;
+	struct timespec next;
+	double start, t, last;
+
+	while ((c = getopt (argc, argv, "i:c:f:lav")) != -1)
+		switch (c) {
+		case 'i':  interval = strtoul (optarg, NULL, 0);	break;
+		case 'c':  count    = strtoul (optarg, NULL, 0);	break;
+		case 'f':
+			if (strcmp (optarg, "text") == 0)
+				format = TEXT;
+			else if (strcmp (optarg, "json") == 0)
+				format = JSON;
+			else if (strcmp (optarg, "binary") == 0)
+				format = BINARY;
+			else
+				return usage ();
+			break;
+		case 'l':  getlink = 1;					break;
+		case 'a':  s.all   = 1;					break;
+		case 'v':  verbose = 1;					break;
+		default:
+			return usage ();
+		}
+
+	if (interval == 0 || optind != argc)
+		return usage ();
+
+	if ((o = rt_stats_alloc (getlink)) == NULL) {
+		perror ("link-stats");
+		return 1;
+	}
+
+	setvbuf (stdout, buf, _IOFBF, sizeof (buf));
+
+	start = last = now (CLOCK_MONOTONIC);
+	clock_gettime (CLOCK_MONOTONIC, &next);
+
+	/* the first sample is a base for deltas */
+	for (i = 0; count == 0 || i <= count; ++i) {
+		t = now (CLOCK_MONOTONIC);
+
+		if ((ret = rt_stats_sample (o)) < 0) {
+			fprintf (stderr, "link-stats: %s\n", nl_geterror (ret));
+			break;
+		}
+
+		s.time     = now (CLOCK_REALTIME);
+		s.interval = t - last;
+		last       = t;
+
+		l = rt_stats_links (o, &n);
+
+		if (i > 0)
+			switch (format) {
+			case TEXT:    show_text   (&s, l, n);  break;
+			case JSON:    show_json   (&s, l, n);  break;
+			case BINARY:  show_binary (&s, l, n);  break;
+			}
+
+		if (fflush (stdout) != 0) {
+			perror ("link-stats");
+			break;
+		}
+
+		if (count == 0 || i < count)
+			pace (&next, interval);
+	}
+
+	if (verbose)
+		report (i, n, start);
+
+	rt_stats_free (o);
+	return i > count && count > 0 ? 0 : 1;
+}
@@ -0,0 +1,366 @@
+/*
+ * Daemon Metrics
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "metrics.h"
+
+/*
+ * Histogram bucket i counts durations up to 2^i microseconds, the last one
+ * is +Inf. Sum is kept in microseconds.
+ */
+#define HIST_BUCKETS  26
+#define HIST_CELLS    (HIST_BUCKETS + 2)
+
+struct slot {
+	struct slot *next;
+	int used;
+	uint64_t cell[];
+};
+
+static const struct metric *metrics;
+static size_t count, cells;
+static size_t *offset;
+static long *gauge;
+
+static struct slot *slots;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t key;
+static __thread struct slot *mine;
+
+/* slot of exited thread is reused by the next one, values stay in place */
+static void slot_release (void *arg)
+{
+	struct slot *s = arg;
+
+	pthread_mutex_lock (&lock);
+	s->used = 0;
+	pthread_mutex_unlock (&lock);
+}
+
+static struct slot *slot_get (void)
+{
+	const size_t size = sizeof (struct slot) + cells * sizeof (uint64_t);
+	struct slot *s;
+
+	if (mine != NULL)
+		return mine;
+
+	pthread_mutex_lock (&lock);
+
+	for (s = slots; s != NULL && s->used; s = s->next) {}
+
+	if (s == NULL && (s = calloc (1, size)) != NULL) {
+		s->next = slots;
+		__atomic_store_n (&slots, s, __ATOMIC_RELEASE);
+	}
+
+	if (s != NULL)
+		s->used = 1;
+
+	pthread_mutex_unlock (&lock);
+
+	if (s != NULL)
+		pthread_setspecific (key, s);
+
+	return mine = s;
+}
+
+int metrics_init (const struct metric *set, size_t n)
+{
+	size_t i, pos;
+
+	if ((offset = calloc (n, sizeof (offset[0]))) == NULL ||
+	    (gauge  = calloc (n, sizeof (gauge[0]))) == NULL)
+		goto no_mem;
+
+	for (i = 0, pos = 0; i < n; ++i) {
+		offset[i] = pos;
+		pos += set[i].type == METRIC_HISTOGRAM ? HIST_CELLS : 1;
+	}
+
+	if (pthread_key_create (&key, slot_release) != 0)
+		goto no_mem;
+
+	metrics = set;
+	count   = n;
+	__atomic_store_n (&cells, pos, __ATOMIC_RELEASE);
+	return 1;
+no_mem:
+	free (gauge);
+	free (offset);
+	return 0;
+}
+
+/* only the owner thread writes its slot: no locked instructions needed */
+static void cell_add (uint64_t *c, uint64_t n)
+{
+	__atomic_store_n (c, __atomic_load_n (c, __ATOMIC_RELAXED) + n,
+			  __ATOMIC_RELAXED);
+}
+
+void metric_add (unsigned id, unsigned long n)
+{
+	struct slot *s;
+
+	if (__atomic_load_n (&cells, __ATOMIC_ACQUIRE) == 0 ||
+	    (s = slot_get ()) == NULL)
+		return;
+
+	cell_add (s->cell + offset[id], n);
+}
+
+void metric_set (unsigned id, long value)
+{
+	if (__atomic_load_n (&cells, __ATOMIC_ACQUIRE) != 0)
+		__atomic_store_n (gauge + id, value, __ATOMIC_RELAXED);
+}
+
+void metric_observe (unsigned id, double seconds)
+{
+	const uint64_t us = seconds > 0 ? seconds * 1e6 : 0;
+	unsigned i;
+	struct slot *s;
+	uint64_t *c;
+
+	if (__atomic_load_n (&cells, __ATOMIC_ACQUIRE) == 0 ||
+	    (s = slot_get ()) == NULL)
+		return;
+
+	i = us <= 1 ? 0 : 64 - __builtin_clzll (us - 1);
+	c = s->cell + offset[id];
+
+	cell_add (c + (i < HIST_BUCKETS ? i : HIST_BUCKETS - 1), 1);
+	cell_add (c + HIST_BUCKETS, us);
+	cell_add (c + HIST_BUCKETS + 1, 1);
+}
+
+static uint64_t sum (size_t cell)
+{
+	const struct slot *s;
+	uint64_t v = 0;
+
+	for (s = __atomic_load_n (&slots, __ATOMIC_ACQUIRE); s != NULL;
+	     s = s->next)
+		v += __atomic_load_n (s->cell + cell, __ATOMIC_RELAXED);
+
+	return v;
+}
+
+static const char *type_name (enum metric_type type)
+{
+	switch (type) {
+	case METRIC_COUNTER:	return "counter";
+	case METRIC_GAUGE:	return "gauge";
+	default:		return "histogram";
+	}
+}
+
+static void write_histogram (FILE *to, const struct metric *m, size_t cell)
+{
+	const char *l = m->labels != NULL ? m->labels : "";
+	const char *sep = m->labels != NULL ? "," : "";
+	uint64_t total = 0;
+	unsigned i;
+
+	for (i = 0; i < HIST_BUCKETS - 1; ++i) {
+		total += sum (cell + i);
+		fprintf (to, "%s_bucket{%s%sle=\"%g\"} %llu\n",
+			 m->name, l, sep, (double) (1ull << i) / 1e6,
+			 (unsigned long long) total);
+	}
+
+	total += sum (cell + i);
+	fprintf (to, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", m->name, l, sep,
+		 (unsigned long long) total);
+
+	if (m->labels != NULL) {
+		fprintf (to, "%s_sum{%s} %.6f\n", m->name, l,
+			 sum (cell + HIST_BUCKETS) / 1e6);
+		fprintf (to, "%s_count{%s} %llu\n", m->name, l,
+			 (unsigned long long) sum (cell + HIST_BUCKETS + 1));
+		return;
+	}
+
+	fprintf (to, "%s_sum %.6f\n", m->name,
+		 sum (cell + HIST_BUCKETS) / 1e6);
+	fprintf (to, "%s_count %llu\n", m->name,
+		 (unsigned long long) sum (cell + HIST_BUCKETS + 1));
+}
+
+int metrics_write (FILE *to)
+{
+	const struct metric *m;
+	unsigned long long v;
+	size_t i;
+
+	for (i = 0; i < count; ++i) {
+		m = metrics + i;
+
+		if (i == 0 || strcmp (m->name, metrics[i - 1].name) != 0)
+			fprintf (to, "# HELP %s %s\n# TYPE %s %s\n", m->name,
+				 m->help, m->name, type_name (m->type));
+
+		if (m->type == METRIC_HISTOGRAM) {
+			write_histogram (to, m, offset[i]);
+			continue;
+		}
+
+		if (m->type == METRIC_GAUGE) {
+			fprintf (to, "%s%s%s%s %ld\n", m->name,
+				 m->labels != NULL ? "{" : "",
+				 m->labels != NULL ? m->labels : "",
+				 m->labels != NULL ? "}" : "",
+				 __atomic_load_n (gauge + i, __ATOMIC_RELAXED));
+			continue;
+		}
+
+		if (m->source != NULL)
+			v = __atomic_load_n (m->source, __ATOMIC_RELAXED);
+		else
+			v = sum (offset[i]);
+
+		if (m->labels != NULL)
+			fprintf (to, "%s{%s} %llu\n", m->name, m->labels, v);
+		else
+			fprintf (to, "%s %llu\n", m->name, v);
+	}
+
+	return !ferror (to);
+}
+
+static int write_textfile (const char *path)
+{
+	char tmp[4096];
+	FILE *to;
+
+	if (snprintf (tmp, sizeof (tmp), "%s.tmp", path) >= sizeof (tmp))
+		return 0;
+
+	if ((to = fopen (tmp, "w")) == NULL)
+		return 0;
+
+	if ((metrics_write (to) & (fclose (to) == 0)) &&
+	    rename (tmp, path) == 0)
+		return 1;
+
+	unlink (tmp);
+	return 0;
+}
+
+static void serve (int s)
+{
+	const struct timeval tv = { .tv_sec = 1 };
+	FILE *to;
+	int fd;
+
+	if ((fd = accept (s, NULL, NULL)) == -1)
+		return;
+
+	/* slow client must not stall textfile updates */
+	setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv));
+
+	if ((to = fdopen (fd, "w")) == NULL) {
+		close (fd);
+		return;
+	}
+
+	metrics_write (to);
+	fclose (to);
+}
+
+struct server {
+	int s;
+	const char *textfile;
+	unsigned period;
+};
+
+static void *metrics_main (void *arg)
+{
+	struct server *o = arg;
+	struct pollfd p = { .fd = o->s, .events = POLLIN };
+	time_t next = 0, t;
+
+	for (;;) {
+		t = time (NULL);
+
+		if (o->textfile != NULL && t >= next) {
+			write_textfile (o->textfile);
+			next = t + o->period;
+		}
+
+		if (poll (&p, o->s != -1, o->textfile != NULL ?
+					  (next - t) * 1000 : -1) > 0)
+			serve (o->s);
+	}
+
+	return NULL;
+}
+
+static int listen_at (const char *path)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	int s;
+
+	if (snprintf (sa.sun_path, sizeof (sa.sun_path), "%s", path) >=
+	    sizeof (sa.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	if ((s = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1)
+		return -1;
+
+	(void) unlink (path);
+
+	if (bind (s, (void *) &sa, sizeof (sa)) != 0 ||
+	    chmod (path, 0600) != 0 || listen (s, 8) != 0) {
+		close (s);
+		return -1;
+	}
+
+	return s;
+}
+
+int metrics_start (const char *sock, const char *textfile, unsigned period)
+{
+	static struct server o;
+	pthread_t thread;
+
+	if (sock == NULL && textfile == NULL)
+		return 1;
+
+	if (sock == NULL)
+		o.s = -1;
+	else if ((o.s = listen_at (sock)) == -1)
+		return 0;
+
+	o.textfile = textfile;
+	o.period   = period > 0 ? period : 1;
+
+	if (pthread_create (&thread, NULL, metrics_main, &o) != 0) {
+		if (o.s != -1)
+			close (o.s);
+
+		return 0;
+	}
+
+	pthread_detach (thread);
+	return 1;
+}
@@ -0,0 +1,52 @@
+/*
+ * Daemon Metrics
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef METRICS_H
+#define METRICS_H  1
+
+#include <stddef.h>
+#include <stdio.h>
+
+enum metric_type {
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM,	/* of durations in seconds */
+};
+
+/*
+ * Metrics with the same name must be adjacent and differ in labels. If
+ * source is set then counter value is read from there instead.
+ */
+struct metric {
+	const char *name, *labels, *help;
+	enum metric_type type;
+	const unsigned long *source;
+};
+
+/*
+ * Counters and histograms are kept per thread without locks and summed on
+ * read. Until metrics_init is called all updates are ignored.
+ */
+int  metrics_init (const struct metric *set, size_t count);
+void metric_add (unsigned id, unsigned long n);
+void metric_set (unsigned id, long value);
+void metric_observe (unsigned id, double seconds);
+
+/*
+ * Writes all metrics in Prometheus text format
+ */
+int metrics_write (FILE *to);
+
+/*
+ * Starts thread serving metrics to clients of Unix stream socket at sock
+ * path and rewriting node-exporter textfile atomically every period
+ * seconds. Either path can be NULL.
+ */
+int metrics_start (const char *sock, const char *textfile, unsigned period);
+
+#endif  /* METRICS_H */
@@ -0,0 +1,141 @@
+/*
+ * Batch Network Prefix Matcher Benchmark
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/socket.h>
+
+#include "net-match.h"
+
+#define ARRAY_SIZE(a)  (sizeof (a) / sizeof ((a)[0]))
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t rnd (void)
+{
+	static uint64_t x = 88172645463325252ull;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+static void make_prefix (int family, unsigned len, unsigned char *net,
+			 unsigned char *mask)
+{
+	const unsigned size = family == AF_INET ? 4 : 16;
+	unsigned i;
+
+	for (i = 0; i < size; ++i, len -= len < 8 ? len : 8) {
+		mask[i] = len < 8 ? 0xff00 >> len : 0xff;
+		net[i]  = rnd () & mask[i];
+	}
+}
+
+static int make_set (struct net_set *o, int family, size_t count)
+{
+	unsigned char net[16], mask[16];
+	size_t i;
+
+	if (!net_set_init (o, family, count))
+		return 0;
+
+	for (i = 0; i < count; ++i) {
+		make_prefix (family, family == AF_INET ? 8 + rnd () % 17 :
+							32 + rnd () % 33,
+			     net, mask);
+		net_set_put (o, i, net, mask);
+	}
+
+	return 1;
+}
+
+/*
+ * Random addresses mostly miss the set, thus every prefix is checked:
+ * this is the worst case for the matcher
+ */
+static double run (const struct net_set *o, const void *a, size_t batches,
+		   uint64_t *sum)
+{
+	const size_t size = o->family == AF_INET ? 4 : 16;
+	double t = now ();
+	size_t i;
+
+	for (i = 0, *sum = 0; i < batches; ++i)
+		*sum += __builtin_popcountll (net_set_match (o, (const char *) a +
+						  i * NET_BATCH * size,
+						  NET_BATCH));
+
+	return now () - t;
+}
+
+int main (int argc, char *argv[])
+{
+	static const char *kernel[] = { "scalar", "sse4", "avx2" };
+	static const size_t count[] = { 1, 100, 10000 };
+	static const int family[] = { AF_INET, AF_INET6 };
+	const size_t total = argc > 1 ? strtoul (argv[1], NULL, 0) : 1 << 24;
+	struct net_set set;
+	size_t f, c, k, batches, i;
+	uint64_t *a, sum, ref;
+	double t;
+
+	if ((a = malloc (total * 16)) == NULL) {
+		perror ("net-match-bench");
+		return 1;
+	}
+
+	for (i = 0; i < total * 2; ++i)
+		a[i] = rnd ();
+
+	printf ("%-6s %-6s %8s %14s %10s\n",
+		"family", "kernel", "prefixes", "entries/s", "ns/entry");
+
+	for (f = 0; f < ARRAY_SIZE (family); ++f)
+	for (c = 0; c < ARRAY_SIZE (count); ++c) {
+		if (!make_set (&set, family[f], count[c])) {
+			perror ("net-match-bench");
+			return 1;
+		}
+
+		/* keep run time of large sets reasonable */
+		batches = total / NET_BATCH / (count[c] > 100 ? 100 : 1);
+
+		for (k = 0, ref = 0; k < ARRAY_SIZE (kernel); ++k) {
+			if (!net_match_use (kernel[k]))
+				continue;
+
+			t = run (&set, a, batches, &sum);
+
+			if (k == 0)
+				ref = sum;
+
+			printf ("%-6s %-6s %8zu %14.0f %10.2f%s\n",
+				family[f] == AF_INET ? "ipv4" : "ipv6",
+				kernel[k], count[c],
+				batches * NET_BATCH / t,
+				t * 1e9 / (batches * NET_BATCH),
+				sum != ref ? "  MISMATCH" : "");
+		}
+
+		net_set_fini (&set);
+	}
+
+	free (a);
+	return 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * Batch Network Prefix Matcher
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+
+#include "net-match.h"
+
+#define ARRAY_SIZE(a)  (sizeof (a) / sizeof ((a)[0]))
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define NET_MATCH_X86  1
+#endif
+
+static size_t net_size (int family)
+{
+	return family == AF_INET ? 4 : 16;
+}
+
+int net_set_init (struct net_set *o, int family, size_t count)
+{
+	const size_t size = count * net_size (family);
+
+	o->family = family;
+	o->count  = count;
+	o->net    = NULL;
+	o->mask   = NULL;
+
+	if (family != AF_INET && family != AF_INET6) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	if (count == 0)
+		return 1;
+
+	if (posix_memalign (&o->net,  32, size) != 0 ||
+	    posix_memalign (&o->mask, 32, size) != 0) {
+		net_set_fini (o);
+		errno = ENOMEM;
+		return 0;
+	}
+
+	return 1;
+}
+
+void net_set_fini (struct net_set *o)
+{
+	free (o->net);
+	free (o->mask);
+
+	o->count = 0;
+	o->net   = NULL;
+	o->mask  = NULL;
+}
+
+void net_set_put (struct net_set *o, size_t i, const void *net,
+		  const void *mask)
+{
+	const size_t size = net_size (o->family);
+
+	memcpy ((char *) o->net  + i * size, net,  size);
+	memcpy ((char *) o->mask + i * size, mask, size);
+}
+
+static uint64_t batch_mask (unsigned n)
+{
+	return n < 64 ? (UINT64_C (1) << n) - 1 : ~UINT64_C (0);
+}
+
+static uint64_t match4_scalar (const struct net_set *o, const uint32_t *a,
+			       uint64_t all)
+{
+	const uint32_t *net = o->net, *mask = o->mask;
+	uint64_t hit = 0;
+	size_t p;
+	unsigned i;
+
+	for (p = 0; p < o->count && hit != all; ++p)
+		for (i = 0; i < NET_BATCH; ++i)
+			hit |= (uint64_t) ((a[i] & mask[p]) == net[p]) << i;
+
+	return hit & all;
+}
+
+static uint64_t match6_scalar (const struct net_set *o, const uint64_t *a,
+			       uint64_t all)
+{
+	const uint64_t *net = o->net, *mask = o->mask;
+	uint64_t hit = 0, x;
+	size_t p;
+	unsigned i;
+
+	for (p = 0; p < o->count && hit != all; ++p, net += 2, mask += 2)
+		for (i = 0; i < NET_BATCH; ++i) {
+			x = ((a[i * 2]     & mask[0]) ^ net[0]) |
+			    ((a[i * 2 + 1] & mask[1]) ^ net[1]);
+			hit |= (uint64_t) (x == 0) << i;
+		}
+
+	return hit & all;
+}
+
+#ifdef NET_MATCH_X86
+
+__attribute__ ((target ("sse4.1")))
+static uint64_t match4_sse4 (const struct net_set *o, const uint32_t *a,
+			     uint64_t all)
+{
+	const uint32_t *net = o->net, *mask = o->mask;
+	__m128i v[NET_BATCH / 4], m, x, eq;
+	uint64_t hit = 0;
+	size_t p;
+	unsigned j;
+
+	for (j = 0; j < NET_BATCH / 4; ++j)
+		v[j] = _mm_loadu_si128 ((const __m128i *) a + j);
+
+	for (p = 0; p < o->count && (hit & all) != all; ++p) {
+		m = _mm_set1_epi32 (mask[p]);
+		x = _mm_set1_epi32 (net[p]);
+
+		for (j = 0; j < NET_BATCH / 4; ++j) {
+			eq = _mm_cmpeq_epi32 (_mm_and_si128 (v[j], m), x);
+			hit |= (uint64_t)
+			       _mm_movemask_ps (_mm_castsi128_ps (eq)) << (j * 4);
+		}
+	}
+
+	return hit & all;
+}
+
+/*
+ * Address matches if both of its words are equal to the prefix ones:
+ * compare words, AND result with its word-swapped copy and accumulate
+ * over prefixes, checking for early exit every 16 prefixes
+ */
+__attribute__ ((target ("sse4.1")))
+static uint64_t match6_sse4 (const struct net_set *o, const uint64_t *a,
+			     uint64_t all)
+{
+	const __m128i *net = o->net, *mask = o->mask;
+	__m128i v, eq, acc;
+	uint64_t hit = 0;
+	size_t p;
+	unsigned i;
+
+	for (i = 0; i < NET_BATCH && (all & (UINT64_C (1) << i)) != 0; ++i) {
+		v   = _mm_loadu_si128 ((const __m128i *) a + i);
+		acc = _mm_setzero_si128 ();
+
+		for (p = 0; p < o->count; ++p) {
+			eq  = _mm_cmpeq_epi64 (_mm_and_si128 (v, mask[p]),
+					       net[p]);
+			eq  = _mm_and_si128 (eq, _mm_shuffle_epi32 (eq, 0x4e));
+			acc = _mm_or_si128 (acc, eq);
+
+			if ((p & 15) == 15 && !_mm_testz_si128 (acc, acc))
+				break;
+		}
+
+		hit |= (uint64_t) !_mm_testz_si128 (acc, acc) << i;
+	}
+
+	return hit;
+}
+
+__attribute__ ((target ("avx2")))
+static uint64_t match4_avx2 (const struct net_set *o, const uint32_t *a,
+			     uint64_t all)
+{
+	const uint32_t *net = o->net, *mask = o->mask;
+	__m256i v[NET_BATCH / 8], m, x, eq;
+	uint64_t hit = 0;
+	size_t p;
+	unsigned j;
+
+	for (j = 0; j < NET_BATCH / 8; ++j)
+		v[j] = _mm256_loadu_si256 ((const __m256i *) a + j);
+
+	for (p = 0; p < o->count && (hit & all) != all; ++p) {
+		m = _mm256_set1_epi32 (mask[p]);
+		x = _mm256_set1_epi32 (net[p]);
+
+		for (j = 0; j < NET_BATCH / 8; ++j) {
+			eq = _mm256_cmpeq_epi32 (_mm256_and_si256 (v[j], m), x);
+			hit |= (uint64_t) (uint8_t)
+			       _mm256_movemask_ps (_mm256_castsi256_ps (eq))
+			       << (j * 8);
+		}
+	}
+
+	return hit & all;
+}
+
+/*
+ * Same as SSE4 one but two addresses per register: lanes hold addresses
+ * i and i + 1, both compared against the prefix broadcast to both lanes
+ */
+__attribute__ ((target ("avx2")))
+static uint64_t match6_avx2 (const struct net_set *o, const uint64_t *a,
+			     uint64_t all)
+{
+	const __m128i *net = o->net, *mask = o->mask;
+	__m256i v, m, x, eq, acc;
+	uint64_t hit = 0;
+	size_t p;
+	unsigned i;
+	int r;
+
+	for (i = 0; i < NET_BATCH && (all & (UINT64_C (1) << i)) != 0; i += 2) {
+		v   = _mm256_loadu_si256 ((const __m256i *) (a + i * 2));
+		acc = _mm256_setzero_si256 ();
+
+		for (p = 0; p < o->count; ++p) {
+			m   = _mm256_broadcastsi128_si256 (mask[p]);
+			x   = _mm256_broadcastsi128_si256 (net[p]);
+			eq  = _mm256_cmpeq_epi64 (_mm256_and_si256 (v, m), x);
+			eq  = _mm256_and_si256 (eq,
+						_mm256_shuffle_epi32 (eq, 0x4e));
+			acc = _mm256_or_si256 (acc, eq);
+
+			if ((p & 15) == 15 &&
+			    _mm256_movemask_pd (_mm256_castsi256_pd (acc)) == 15)
+				break;
+		}
+
+		r = _mm256_movemask_pd (_mm256_castsi256_pd (acc));
+		hit |= (uint64_t) ((r & 1) | (r & 4) >> 1) << i;
+	}
+
+	return hit & all;
+}
+
+#endif  /* NET_MATCH_X86 */
+
+struct net_match {
+	const char *name;
+	int (*supported) (void);
+	uint64_t (*match4) (const struct net_set *o, const uint32_t *a,
+			    uint64_t all);
+	uint64_t (*match6) (const struct net_set *o, const uint64_t *a,
+			    uint64_t all);
+};
+
+static int scalar_supported (void)
+{
+	return 1;
+}
+
+#ifdef NET_MATCH_X86
+
+static int sse4_supported (void)
+{
+	__builtin_cpu_init ();
+	return __builtin_cpu_supports ("sse4.1");
+}
+
+static int avx2_supported (void)
+{
+	__builtin_cpu_init ();
+	return __builtin_cpu_supports ("avx2");
+}
+
+#endif
+
+/* ordered from the best to the worst */
+static const struct net_match match_table[] = {
+#ifdef NET_MATCH_X86
+	{ "avx2",   avx2_supported,   match4_avx2,   match6_avx2   },
+	{ "sse4",   sse4_supported,   match4_sse4,   match6_sse4   },
+#endif
+	{ "scalar", scalar_supported, match4_scalar, match6_scalar },
+};
+
+static const struct net_match *match;
+
+int net_match_use (const char *name)
+{
+	const struct net_match *o;
+
+	for (o = match_table; o < match_table + ARRAY_SIZE (match_table); ++o)
+		if ((name == NULL || strcmp (name, o->name) == 0) &&
+		    o->supported ()) {
+			match = o;
+			return 1;
+		}
+
+	return 0;
+}
+
+const char *net_match_name (void)
+{
+	if (match == NULL)
+		net_match_use (NULL);
+
+	return match->name;
+}
+
+uint64_t net_set_match (const struct net_set *o, const void *a, unsigned n)
+{
+	const uint64_t all = batch_mask (n);
+
+	if (o->count == 0 || n == 0)
+		return 0;
+
+	if (match == NULL)
+		net_match_use (NULL);
+
+	return o->family == AF_INET ? match->match4 (o, a, all) :
+				      match->match6 (o, a, all);
+}
@@ -0,0 +1,47 @@
+/*
+ * Batch Network Prefix Matcher
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef NET_MATCH_H
+#define NET_MATCH_H  1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Prefix set of single family kept as structure of arrays: IPv4 ones as
+ * uint32_t[count], IPv6 ones as uint64_t[count][2], all in network byte
+ * order
+ */
+struct net_set {
+	int family;
+	size_t count;
+	void *net, *mask;
+};
+
+int  net_set_init (struct net_set *o, int family, size_t count);
+void net_set_fini (struct net_set *o);
+void net_set_put  (struct net_set *o, size_t i, const void *net,
+		   const void *mask);
+
+/*
+ * Matches batch of n addresses (of uint32_t[NET_BATCH] or
+ * uint64_t[NET_BATCH][2] array) against the set, returns bit mask of
+ * addresses matched by any prefix
+ */
+#define NET_BATCH  64
+
+uint64_t net_set_match (const struct net_set *o, const void *a, unsigned n);
+
+/*
+ * Selects compare kernel by name (scalar, sse4, avx2), NULL selects the
+ * best one supported by CPU. Returns zero if the kernel is not supported.
+ */
+int net_match_use (const char *name);
+const char *net_match_name (void);
+
+#endif  /* NET_MATCH_H */
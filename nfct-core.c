@@ -0,0 +1,727 @@
+/*
+ * Conntrack NetLink Core
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nfct-core.h"
+
+#ifdef NL_RAW
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+
+#define RECV_SIZE	65536
+#define REQ_SIZE	1024
+
+struct nfnl_handle {
+	int fd;
+};
+
+struct nfct_handle {
+	struct nfnl_handle nfnl;
+	uint32_t pid, seq;
+
+	nfct_cb2 *cb;
+	unsigned cb_type;
+	void *cb_data;
+
+	unsigned char *buf;	/* receive buffer of RECV_SIZE bytes */
+};
+
+/*
+ * Attribute values are kept in slots as library returns them: addresses
+ * and ports in network byte order, other fields in host one
+ */
+struct nf_conntrack {
+	uint32_t set;
+	unsigned char value[ATTR_MAX][16];
+};
+
+static const unsigned char attr_size[ATTR_MAX] = {
+	[ATTR_ORIG_IPV4_SRC] = 4,  [ATTR_ORIG_IPV4_DST] = 4,
+	[ATTR_REPL_IPV4_SRC] = 4,  [ATTR_REPL_IPV4_DST] = 4,
+	[ATTR_ORIG_IPV6_SRC] = 16, [ATTR_ORIG_IPV6_DST] = 16,
+	[ATTR_REPL_IPV6_SRC] = 16, [ATTR_REPL_IPV6_DST] = 16,
+	[ATTR_ORIG_PORT_SRC] = 2,  [ATTR_ORIG_PORT_DST] = 2,
+	[ATTR_REPL_PORT_SRC] = 2,  [ATTR_REPL_PORT_DST] = 2,
+	[ATTR_ICMP_TYPE]     = 1,  [ATTR_ICMP_CODE]     = 1,
+	[ATTR_ICMP_ID]       = 2,
+	[ATTR_ORIG_L3PROTO]  = 1,  [ATTR_REPL_L3PROTO]  = 1,
+	[ATTR_ORIG_L4PROTO]  = 1,  [ATTR_REPL_L4PROTO]  = 1,
+	[ATTR_TCP_STATE]     = 1,
+	[ATTR_TIMEOUT]       = 4,  [ATTR_MARK]          = 4,
+	[ATTR_USE]           = 4,  [ATTR_ID]            = 4,
+	[ATTR_STATUS]        = 4,  [ATTR_ZONE]          = 2,
+};
+
+struct tuple {
+	enum nf_conntrack_attr v4[2], v6[2], port[2], l3, l4;	/* src, dst */
+};
+
+static const struct tuple tuples[2] = {
+	{
+		{ ATTR_ORIG_IPV4_SRC, ATTR_ORIG_IPV4_DST },
+		{ ATTR_ORIG_IPV6_SRC, ATTR_ORIG_IPV6_DST },
+		{ ATTR_ORIG_PORT_SRC, ATTR_ORIG_PORT_DST },
+		ATTR_ORIG_L3PROTO, ATTR_ORIG_L4PROTO,
+	},
+	{
+		{ ATTR_REPL_IPV4_SRC, ATTR_REPL_IPV4_DST },
+		{ ATTR_REPL_IPV6_SRC, ATTR_REPL_IPV6_DST },
+		{ ATTR_REPL_PORT_SRC, ATTR_REPL_PORT_DST },
+		ATTR_REPL_L3PROTO, ATTR_REPL_L4PROTO,
+	},
+};
+
+struct nf_conntrack *nfct_new (void)
+{
+	return calloc (1, sizeof (struct nf_conntrack));
+}
+
+void nfct_destroy (struct nf_conntrack *ct)
+{
+	free (ct);
+}
+
+static void copy_attr (struct nf_conntrack *to, const struct nf_conntrack *from,
+		       enum nf_conntrack_attr type)
+{
+	if ((from->set & (1u << type)) == 0)
+		return;
+
+	memcpy (to->value[type], from->value[type], attr_size[type]);
+	to->set |= 1u << type;
+}
+
+void nfct_copy (struct nf_conntrack *to, const struct nf_conntrack *from,
+		unsigned flags)
+{
+	const struct tuple *t;
+	unsigned dir, i;
+
+	if (flags == NFCT_CP_ALL) {
+		*to = *from;
+		return;
+	}
+
+	for (dir = 0; dir < 2; ++dir) {
+		if ((flags & (dir == 0 ? NFCT_CP_ORIG : NFCT_CP_REPL)) == 0)
+			continue;
+
+		t = tuples + dir;
+
+		for (i = 0; i < 2; ++i) {
+			copy_attr (to, from, t->v4[i]);
+			copy_attr (to, from, t->v6[i]);
+			copy_attr (to, from, t->port[i]);
+		}
+
+		copy_attr (to, from, t->l3);
+		copy_attr (to, from, t->l4);
+	}
+
+	if ((flags & NFCT_CP_ORIG) != 0) {
+		copy_attr (to, from, ATTR_ICMP_TYPE);
+		copy_attr (to, from, ATTR_ICMP_CODE);
+		copy_attr (to, from, ATTR_ICMP_ID);
+	}
+}
+
+int nfct_attr_is_set (const struct nf_conntrack *ct,
+		      const enum nf_conntrack_attr type)
+{
+	if (type >= ATTR_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return (ct->set & (1u << type)) != 0;
+}
+
+const void *nfct_get_attr (const struct nf_conntrack *ct,
+			   const enum nf_conntrack_attr type)
+{
+	if (nfct_attr_is_set (ct, type) <= 0) {
+		errno = ENODATA;
+		return NULL;
+	}
+
+	return ct->value[type];
+}
+
+uint8_t nfct_get_attr_u8 (const struct nf_conntrack *ct,
+			  const enum nf_conntrack_attr type)
+{
+	const uint8_t *p = nfct_get_attr (ct, type);
+
+	return p != NULL ? *p : 0;
+}
+
+uint16_t nfct_get_attr_u16 (const struct nf_conntrack *ct,
+			    const enum nf_conntrack_attr type)
+{
+	const void *p = nfct_get_attr (ct, type);
+	uint16_t v = 0;
+
+	if (p != NULL)
+		memcpy (&v, p, sizeof (v));
+
+	return v;
+}
+
+uint32_t nfct_get_attr_u32 (const struct nf_conntrack *ct,
+			    const enum nf_conntrack_attr type)
+{
+	const void *p = nfct_get_attr (ct, type);
+	uint32_t v = 0;
+
+	if (p != NULL)
+		memcpy (&v, p, sizeof (v));
+
+	return v;
+}
+
+void nfct_set_attr (struct nf_conntrack *ct, const enum nf_conntrack_attr type,
+		    const void *value)
+{
+	if (type >= ATTR_MAX)
+		return;
+
+	memcpy (ct->value[type], value, attr_size[type]);
+	ct->set |= 1u << type;
+}
+
+void nfct_set_attr_u8 (struct nf_conntrack *ct,
+		       const enum nf_conntrack_attr type, uint8_t value)
+{
+	nfct_set_attr (ct, type, &value);
+}
+
+void nfct_set_attr_u16 (struct nf_conntrack *ct,
+			const enum nf_conntrack_attr type, uint16_t value)
+{
+	nfct_set_attr (ct, type, &value);
+}
+
+void nfct_set_attr_u32 (struct nf_conntrack *ct,
+			const enum nf_conntrack_attr type, uint32_t value)
+{
+	nfct_set_attr (ct, type, &value);
+}
+
+/*
+ * Message parser
+ */
+#define NLA_OK(a, len)	((len) >= (int) sizeof (*(a)) &&		\
+			 (a)->nla_len >= sizeof (*(a)) &&		\
+			 (a)->nla_len <= (len))
+#define NLA_NEXT(a, len)  ((len) -= NLA_ALIGN ((a)->nla_len),		\
+			   (struct nlattr *) ((char *) (a) +		\
+					      NLA_ALIGN ((a)->nla_len)))
+#define NLA_DATA(a)	((void *) ((char *) (a) + NLA_HDRLEN))
+#define NLA_PAYLOAD(a)	((int) (a)->nla_len - NLA_HDRLEN)
+
+#define for_each_attr(a, from, size)					\
+	for (int len_ = (size), a##_ = 1; a##_; a##_ = 0)		\
+		for (a = (from); NLA_OK (a, len_); a = NLA_NEXT (a, len_))
+
+static void take (struct nf_conntrack *ct, enum nf_conntrack_attr type,
+		  const struct nlattr *a)
+{
+	if (NLA_PAYLOAD (a) >= attr_size[type])
+		nfct_set_attr (ct, type, NLA_DATA (a));
+}
+
+static void take_be32 (struct nf_conntrack *ct, enum nf_conntrack_attr type,
+		       const struct nlattr *a)
+{
+	uint32_t v;
+
+	if (NLA_PAYLOAD (a) >= sizeof (v)) {
+		memcpy (&v, NLA_DATA (a), sizeof (v));
+		nfct_set_attr_u32 (ct, type, ntohl (v));
+	}
+}
+
+static void parse_ip (struct nf_conntrack *ct, const struct tuple *t,
+		      const struct nlattr *nest)
+{
+	const struct nlattr *a;
+
+	for_each_attr (a, NLA_DATA (nest), NLA_PAYLOAD (nest))
+		switch (a->nla_type & NLA_TYPE_MASK) {
+		case CTA_IP_V4_SRC:  take (ct, t->v4[0], a);  break;
+		case CTA_IP_V4_DST:  take (ct, t->v4[1], a);  break;
+		case CTA_IP_V6_SRC:  take (ct, t->v6[0], a);  break;
+		case CTA_IP_V6_DST:  take (ct, t->v6[1], a);  break;
+		}
+}
+
+static void parse_proto (struct nf_conntrack *ct, const struct tuple *t,
+			 const struct nlattr *nest, int orig)
+{
+	const struct nlattr *a;
+
+	for_each_attr (a, NLA_DATA (nest), NLA_PAYLOAD (nest))
+		switch (a->nla_type & NLA_TYPE_MASK) {
+		case CTA_PROTO_NUM:       take (ct, t->l4, a);		break;
+		case CTA_PROTO_SRC_PORT:  take (ct, t->port[0], a);	break;
+		case CTA_PROTO_DST_PORT:  take (ct, t->port[1], a);	break;
+		case CTA_PROTO_ICMP_ID:
+		case CTA_PROTO_ICMPV6_ID:
+			if (orig)
+				take (ct, ATTR_ICMP_ID, a);
+			break;
+		case CTA_PROTO_ICMP_TYPE:
+		case CTA_PROTO_ICMPV6_TYPE:
+			if (orig)
+				take (ct, ATTR_ICMP_TYPE, a);
+			break;
+		case CTA_PROTO_ICMP_CODE:
+		case CTA_PROTO_ICMPV6_CODE:
+			if (orig)
+				take (ct, ATTR_ICMP_CODE, a);
+			break;
+		}
+}
+
+static void parse_tuple (struct nf_conntrack *ct, int dir, int family,
+			 const struct nlattr *nest)
+{
+	const struct tuple *t = tuples + dir;
+	const struct nlattr *a;
+
+	nfct_set_attr_u8 (ct, t->l3, family);
+
+	for_each_attr (a, NLA_DATA (nest), NLA_PAYLOAD (nest))
+		switch (a->nla_type & NLA_TYPE_MASK) {
+		case CTA_TUPLE_IP:     parse_ip (ct, t, a);		break;
+		case CTA_TUPLE_PROTO:  parse_proto (ct, t, a, dir == 0);	break;
+		}
+}
+
+static void parse_protoinfo (struct nf_conntrack *ct,
+			     const struct nlattr *nest)
+{
+	const struct nlattr *a, *b;
+
+	for_each_attr (a, NLA_DATA (nest), NLA_PAYLOAD (nest))
+		if ((a->nla_type & NLA_TYPE_MASK) == CTA_PROTOINFO_TCP)
+			for_each_attr (b, NLA_DATA (a), NLA_PAYLOAD (a))
+				if ((b->nla_type & NLA_TYPE_MASK) ==
+				    CTA_PROTOINFO_TCP_STATE)
+					take (ct, ATTR_TCP_STATE, b);
+}
+
+int nfct_nlmsg_parse (const struct nlmsghdr *h, struct nf_conntrack *ct)
+{
+	const struct nfgenmsg *g = NLMSG_DATA (h);
+	const struct nlattr *a;
+	uint16_t zone;
+
+	if (h->nlmsg_len < NLMSG_LENGTH (sizeof (*g))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for_each_attr (a, (void *) ((char *) g + NLMSG_ALIGN (sizeof (*g))),
+		       h->nlmsg_len - NLMSG_LENGTH (sizeof (*g)))
+		switch (a->nla_type & NLA_TYPE_MASK) {
+		case CTA_TUPLE_ORIG:
+			parse_tuple (ct, 0, g->nfgen_family, a);
+			break;
+		case CTA_TUPLE_REPLY:
+			parse_tuple (ct, 1, g->nfgen_family, a);
+			break;
+		case CTA_PROTOINFO:  parse_protoinfo (ct, a);		break;
+		case CTA_STATUS:     take_be32 (ct, ATTR_STATUS,  a);	break;
+		case CTA_TIMEOUT:    take_be32 (ct, ATTR_TIMEOUT, a);	break;
+		case CTA_MARK:       take_be32 (ct, ATTR_MARK,    a);	break;
+		case CTA_USE:        take_be32 (ct, ATTR_USE,     a);	break;
+		case CTA_ID:         take_be32 (ct, ATTR_ID,      a);	break;
+		case CTA_ZONE:
+			if (NLA_PAYLOAD (a) >= sizeof (zone)) {
+				memcpy (&zone, NLA_DATA (a), sizeof (zone));
+				nfct_set_attr_u16 (ct, ATTR_ZONE, ntohs (zone));
+			}
+			break;
+		}
+
+	return 0;
+}
+
+/*
+ * Message builder, caller provides room for attributes
+ */
+static struct nlattr *put (struct nlmsghdr *h, int type, const void *data,
+			   size_t len)
+{
+	struct nlattr *a = (void *) ((char *) h + NLMSG_ALIGN (h->nlmsg_len));
+
+	a->nla_type = type;
+	a->nla_len  = NLA_HDRLEN + len;
+
+	memcpy (NLA_DATA (a), data, len);
+	memset ((char *) NLA_DATA (a) + len, 0, NLA_ALIGN (len) - len);
+
+	h->nlmsg_len = NLMSG_ALIGN (h->nlmsg_len) + NLA_ALIGN (a->nla_len);
+	return a;
+}
+
+static void put_attr (struct nlmsghdr *h, int type,
+		      const struct nf_conntrack *ct, enum nf_conntrack_attr id)
+{
+	if (nfct_attr_is_set (ct, id) > 0)
+		put (h, type, ct->value[id], attr_size[id]);
+}
+
+static void put_be32 (struct nlmsghdr *h, int type,
+		      const struct nf_conntrack *ct, enum nf_conntrack_attr id)
+{
+	const uint32_t v = htonl (nfct_get_attr_u32 (ct, id));
+
+	if (nfct_attr_is_set (ct, id) > 0)
+		put (h, type, &v, sizeof (v));
+}
+
+static struct nlattr *nest_start (struct nlmsghdr *h, int type)
+{
+	return put (h, type | NLA_F_NESTED, NULL, 0);
+}
+
+static void nest_end (struct nlmsghdr *h, struct nlattr *nest)
+{
+	nest->nla_len = (char *) h + h->nlmsg_len - (char *) nest;
+}
+
+static int has_tuple (const struct nf_conntrack *ct, int dir)
+{
+	const struct tuple *t = tuples + dir;
+	const uint32_t mask = 1u << t->v4[0] | 1u << t->v4[1] |
+			      1u << t->v6[0] | 1u << t->v6[1];
+
+	return (ct->set & mask) != 0;
+}
+
+/*
+ * Reply tuple takes protocols of original one unless they are set
+ */
+static enum nf_conntrack_attr proto (const struct nf_conntrack *ct,
+				     enum nf_conntrack_attr repl,
+				     enum nf_conntrack_attr orig)
+{
+	return nfct_attr_is_set (ct, repl) > 0 ? repl : orig;
+}
+
+static void build_tuple (struct nlmsghdr *h, const struct nf_conntrack *ct,
+			 int dir)
+{
+	const struct tuple *t = tuples + dir;
+	const enum nf_conntrack_attr l3 = proto (ct, t->l3, ATTR_ORIG_L3PROTO);
+	const enum nf_conntrack_attr l4 = proto (ct, t->l4, ATTR_ORIG_L4PROTO);
+	const int icmp6 = nfct_get_attr_u8 (ct, l4) == IPPROTO_ICMPV6;
+	struct nlattr *tuple, *nest;
+
+	tuple = nest_start (h, dir == 0 ? CTA_TUPLE_ORIG : CTA_TUPLE_REPLY);
+
+	nest = nest_start (h, CTA_TUPLE_IP);
+
+	if (nfct_get_attr_u8 (ct, l3) == AF_INET6) {
+		put_attr (h, CTA_IP_V6_SRC, ct, t->v6[0]);
+		put_attr (h, CTA_IP_V6_DST, ct, t->v6[1]);
+	}
+	else {
+		put_attr (h, CTA_IP_V4_SRC, ct, t->v4[0]);
+		put_attr (h, CTA_IP_V4_DST, ct, t->v4[1]);
+	}
+
+	nest_end (h, nest);
+
+	nest = nest_start (h, CTA_TUPLE_PROTO);
+	put_attr (h, CTA_PROTO_NUM,      ct, l4);
+	put_attr (h, CTA_PROTO_SRC_PORT, ct, t->port[0]);
+	put_attr (h, CTA_PROTO_DST_PORT, ct, t->port[1]);
+
+	if (dir == 0) {
+		put_attr (h, icmp6 ? CTA_PROTO_ICMPV6_ID : CTA_PROTO_ICMP_ID,
+			  ct, ATTR_ICMP_ID);
+		put_attr (h, icmp6 ? CTA_PROTO_ICMPV6_TYPE :
+				     CTA_PROTO_ICMP_TYPE, ct, ATTR_ICMP_TYPE);
+		put_attr (h, icmp6 ? CTA_PROTO_ICMPV6_CODE :
+				     CTA_PROTO_ICMP_CODE, ct, ATTR_ICMP_CODE);
+	}
+
+	nest_end (h, nest);
+	nest_end (h, tuple);
+}
+
+enum build {
+	BUILD_ALL, BUILD_NEW, BUILD_KEY,	/* key finds entry to delete */
+};
+
+static void build (struct nlmsghdr *h, const struct nf_conntrack *ct,
+		   enum build what)
+{
+	const uint16_t zone = htons (nfct_get_attr_u16 (ct, ATTR_ZONE));
+	struct nlattr *info, *tcp;
+
+	if (has_tuple (ct, 0))
+		build_tuple (h, ct, 0);
+
+	if (has_tuple (ct, 1) && (what != BUILD_KEY || !has_tuple (ct, 0)))
+		build_tuple (h, ct, 1);
+
+	if (nfct_attr_is_set (ct, ATTR_ZONE) > 0)
+		put (h, CTA_ZONE, &zone, sizeof (zone));
+
+	if (what != BUILD_NEW)
+		put_be32 (h, CTA_ID, ct, ATTR_ID);
+
+	if (what == BUILD_KEY)
+		return;
+
+	put_be32 (h, CTA_STATUS,  ct, ATTR_STATUS);
+	put_be32 (h, CTA_TIMEOUT, ct, ATTR_TIMEOUT);
+	put_be32 (h, CTA_MARK,    ct, ATTR_MARK);
+
+	if (nfct_attr_is_set (ct, ATTR_TCP_STATE) > 0) {
+		info = nest_start (h, CTA_PROTOINFO);
+		tcp  = nest_start (h, CTA_PROTOINFO_TCP);
+		put_attr (h, CTA_PROTOINFO_TCP_STATE, ct, ATTR_TCP_STATE);
+		nest_end (h, tcp);
+		nest_end (h, info);
+	}
+}
+
+int nfct_nlmsg_build (struct nlmsghdr *h, const struct nf_conntrack *ct)
+{
+	build (h, ct, BUILD_ALL);
+	return 0;
+}
+
+/*
+ * Conntrack handle
+ */
+struct nfct_handle *nfct_open (uint8_t subsys, unsigned groups)
+{
+	struct sockaddr_nl local = { .nl_family = AF_NETLINK };
+	socklen_t len = sizeof (local);
+	struct nfct_handle *o;
+
+	if (subsys != CONNTRACK) {
+		errno = EOPNOTSUPP;
+		return NULL;
+	}
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((o->buf = malloc (RECV_SIZE)) == NULL)
+		goto no_buf;
+
+	o->nfnl.fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC,
+			     NETLINK_NETFILTER);
+	if (o->nfnl.fd == -1)
+		goto no_buf;
+
+	local.nl_groups = groups;
+
+	if (bind (o->nfnl.fd, (void *) &local, sizeof (local)) != 0 ||
+	    getsockname (o->nfnl.fd, (void *) &local, &len) != 0)
+		goto no_bind;
+
+	o->pid = local.nl_pid;
+	o->seq = time (NULL);
+	return o;
+no_bind:
+	close (o->nfnl.fd);
+no_buf:
+	free (o->buf);
+	free (o);
+	return NULL;
+}
+
+int nfct_close (struct nfct_handle *o)
+{
+	int ret = close (o->nfnl.fd);
+
+	free (o->buf);
+	free (o);
+	return ret;
+}
+
+int nfct_fd (struct nfct_handle *o)
+{
+	return o->nfnl.fd;
+}
+
+struct nfnl_handle *nfct_nfnlh (struct nfct_handle *o)
+{
+	return &o->nfnl;
+}
+
+unsigned nfnl_rcvbufsiz (const struct nfnl_handle *o, unsigned size)
+{
+	socklen_t len = sizeof (size);
+
+	if (setsockopt (o->fd, SOL_SOCKET, SO_RCVBUFFORCE, &size,
+			sizeof (size)) != 0)
+		setsockopt (o->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof (size));
+
+	getsockopt (o->fd, SOL_SOCKET, SO_RCVBUF, &size, &len);
+	return size;
+}
+
+int nfct_callback_register2 (struct nfct_handle *o,
+			     enum nf_conntrack_msg_type type,
+			     nfct_cb2 *cb, void *data)
+{
+	o->cb      = cb;
+	o->cb_type = type;
+	o->cb_data = data;
+	return 0;
+}
+
+static enum nf_conntrack_msg_type msg_type (const struct nlmsghdr *h)
+{
+	if ((h->nlmsg_type >> 8) != NFNL_SUBSYS_CTNETLINK)
+		return NFCT_T_UNKNOWN;
+
+	switch (h->nlmsg_type & 0xff) {
+	case IPCTNL_MSG_CT_NEW:
+		return (h->nlmsg_flags & (NLM_F_CREATE | NLM_F_EXCL)) != 0 ?
+		       NFCT_T_NEW : NFCT_T_UPDATE;
+	case IPCTNL_MSG_CT_DELETE:
+		return NFCT_T_DESTROY;
+	}
+
+	return NFCT_T_UNKNOWN;
+}
+
+/*
+ * Returns 1 to go on, 0 if callback stops and -1 on failure
+ */
+static int deliver (struct nfct_handle *o, const struct nlmsghdr *h)
+{
+	const enum nf_conntrack_msg_type type = msg_type (h);
+	struct nf_conntrack *ct;
+	int ret;
+
+	if (o->cb == NULL || (type & o->cb_type) == 0)
+		return 1;
+
+	if ((ct = nfct_new ()) == NULL)
+		return -1;
+
+	nfct_nlmsg_parse (h, ct);
+
+	if ((ret = o->cb (h, type, ct, o->cb_data)) != NFCT_CB_STOLEN)
+		nfct_destroy (ct);
+
+	return ret == NFCT_CB_FAILURE ? -1 : ret == NFCT_CB_STOP ? 0 : 1;
+}
+
+/*
+ * Receives replies to request up to acknowledgement or end of dump
+ */
+static int catch (struct nfct_handle *o, uint32_t seq)
+{
+	const struct nlmsghdr *h;
+	const struct nlmsgerr *e;
+	ssize_t len;
+	int ret;
+
+	for (;;) {
+		while ((len = recv (o->nfnl.fd, o->buf, RECV_SIZE, 0)) < 0)
+			if (errno != EINTR)
+				return -1;
+
+		for (h = (void *) o->buf; NLMSG_OK (h, len);
+		     h = NLMSG_NEXT (h, len)) {
+			if (h->nlmsg_seq != seq)
+				continue;
+
+			switch (h->nlmsg_type) {
+			case NLMSG_DONE:
+				return 0;
+			case NLMSG_NOOP:
+				continue;
+			case NLMSG_OVERRUN:
+				errno = ENOBUFS;
+				return -1;
+			case NLMSG_ERROR:
+				e = NLMSG_DATA (h);
+
+				if (e->error == 0)
+					return 0;
+
+				errno = -e->error;
+				return -1;
+			}
+
+			if ((ret = deliver (o, h)) <= 0)
+				return ret;
+		}
+	}
+}
+
+int nfct_query (struct nfct_handle *o, const enum nf_conntrack_query q,
+		const void *data)
+{
+	uint32_t buf[REQ_SIZE / 4] = {};
+	struct nlmsghdr *h = (void *) buf;
+	struct nfgenmsg *g = NLMSG_DATA (h);
+	const struct nf_conntrack *ct = data;
+	struct sockaddr_nl to = { .nl_family = AF_NETLINK };
+
+	h->nlmsg_len   = NLMSG_LENGTH (sizeof (*g));
+	h->nlmsg_type  = NFNL_SUBSYS_CTNETLINK << 8;
+	h->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	h->nlmsg_pid   = o->pid;
+	h->nlmsg_seq   = ++o->seq;
+	g->version     = NFNETLINK_V0;
+
+	switch (q) {
+	case NFCT_Q_DUMP:
+		h->nlmsg_type  |= IPCTNL_MSG_CT_GET;
+		h->nlmsg_flags  = NLM_F_REQUEST | NLM_F_DUMP;
+		g->nfgen_family = *(const uint32_t *) data;
+		break;
+	case NFCT_Q_CREATE:
+		h->nlmsg_type  |= IPCTNL_MSG_CT_NEW;
+		h->nlmsg_flags |= NLM_F_CREATE | NLM_F_EXCL;
+		g->nfgen_family = nfct_get_attr_u8 (ct, ATTR_L3PROTO);
+		build (h, ct, BUILD_NEW);
+		break;
+	case NFCT_Q_UPDATE:
+		h->nlmsg_type  |= IPCTNL_MSG_CT_NEW;
+		g->nfgen_family = nfct_get_attr_u8 (ct, ATTR_L3PROTO);
+		build (h, ct, BUILD_ALL);
+		break;
+	case NFCT_Q_DESTROY:
+		h->nlmsg_type  |= IPCTNL_MSG_CT_DELETE;
+		g->nfgen_family = nfct_get_attr_u8 (ct, ATTR_L3PROTO);
+		build (h, ct, BUILD_KEY);
+		break;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	while (sendto (o->nfnl.fd, h, h->nlmsg_len, 0, (void *) &to,
+		       sizeof (to)) < 0)
+		if (errno != EINTR)
+			return -1;
+
+	return catch (o, h->nlmsg_seq) < 0 ? -1 : 0;
+}
+
+#endif  /* NL_RAW */
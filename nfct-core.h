@@ -0,0 +1,138 @@
+/*
+ * Conntrack NetLink Core
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef NFCT_CORE_H
+#define NFCT_CORE_H  1
+
+#ifndef NL_RAW
+
+#include <libnetfilter_conntrack/libnetfilter_conntrack.h>
+#include <libnfnetlink/libnfnetlink.h>
+
+#else  /* NL_RAW */
+
+/*
+ * Built-in replacement for the part of libnetfilter_conntrack used by
+ * tools: conntrack handle with dump, create, update and destroy queries,
+ * entry attributes of tuples, protocol state, status, timeout, mark and
+ * zone. Names, attribute byte order and callback semantics follow the
+ * library. ICMP attributes are kept for original tuple only.
+ */
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <linux/netfilter/nf_conntrack_common.h>
+#include <linux/netfilter/nf_conntrack_tcp.h>
+
+#define CONNTRACK  NFNL_SUBSYS_CTNETLINK
+
+struct nfct_handle;
+struct nfnl_handle;
+struct nf_conntrack;
+
+enum nf_conntrack_attr {
+	ATTR_ORIG_IPV4_SRC, ATTR_ORIG_IPV4_DST,
+	ATTR_REPL_IPV4_SRC, ATTR_REPL_IPV4_DST,
+	ATTR_ORIG_IPV6_SRC, ATTR_ORIG_IPV6_DST,
+	ATTR_REPL_IPV6_SRC, ATTR_REPL_IPV6_DST,
+	ATTR_ORIG_PORT_SRC, ATTR_ORIG_PORT_DST,
+	ATTR_REPL_PORT_SRC, ATTR_REPL_PORT_DST,
+	ATTR_ICMP_TYPE, ATTR_ICMP_CODE, ATTR_ICMP_ID,
+	ATTR_ORIG_L3PROTO, ATTR_REPL_L3PROTO,
+	ATTR_ORIG_L4PROTO, ATTR_REPL_L4PROTO,
+	ATTR_TCP_STATE, ATTR_TIMEOUT, ATTR_MARK, ATTR_USE, ATTR_ID,
+	ATTR_STATUS, ATTR_ZONE,
+	ATTR_MAX,
+
+	ATTR_IPV4_SRC = ATTR_ORIG_IPV4_SRC,
+	ATTR_IPV4_DST = ATTR_ORIG_IPV4_DST,
+	ATTR_IPV6_SRC = ATTR_ORIG_IPV6_SRC,
+	ATTR_IPV6_DST = ATTR_ORIG_IPV6_DST,
+	ATTR_PORT_SRC = ATTR_ORIG_PORT_SRC,
+	ATTR_PORT_DST = ATTR_ORIG_PORT_DST,
+	ATTR_L3PROTO  = ATTR_ORIG_L3PROTO,
+	ATTR_L4PROTO  = ATTR_ORIG_L4PROTO,
+};
+
+enum nf_conntrack_msg_type {
+	NFCT_T_UNKNOWN	= 0,
+	NFCT_T_NEW	= 1 << 0,
+	NFCT_T_UPDATE	= 1 << 1,
+	NFCT_T_DESTROY	= 1 << 2,
+	NFCT_T_ALL	= NFCT_T_NEW | NFCT_T_UPDATE | NFCT_T_DESTROY,
+};
+
+enum {
+	NFCT_CB_FAILURE = -1, NFCT_CB_STOP, NFCT_CB_CONTINUE, NFCT_CB_STOLEN,
+};
+
+enum nf_conntrack_query {
+	NFCT_Q_CREATE, NFCT_Q_UPDATE, NFCT_Q_DESTROY, NFCT_Q_DUMP,
+};
+
+enum {
+	NFCT_CP_ALL = 0, NFCT_CP_ORIG = 1 << 0, NFCT_CP_REPL = 1 << 1,
+};
+
+typedef int nfct_cb2 (const struct nlmsghdr *h,
+		      enum nf_conntrack_msg_type type,
+		      struct nf_conntrack *ct, void *data);
+
+struct nfct_handle *nfct_open (uint8_t subsys, unsigned groups);
+int nfct_close (struct nfct_handle *o);
+int nfct_fd (struct nfct_handle *o);
+struct nfnl_handle *nfct_nfnlh (struct nfct_handle *o);
+unsigned nfnl_rcvbufsiz (const struct nfnl_handle *o, unsigned size);
+
+int nfct_callback_register2 (struct nfct_handle *o,
+			     enum nf_conntrack_msg_type type,
+			     nfct_cb2 *cb, void *data);
+
+/*
+ * Dump takes pointer to family, other queries take entry
+ */
+int nfct_query (struct nfct_handle *o, const enum nf_conntrack_query q,
+		const void *data);
+
+struct nf_conntrack *nfct_new (void);
+void nfct_destroy (struct nf_conntrack *ct);
+void nfct_copy (struct nf_conntrack *to, const struct nf_conntrack *from,
+		unsigned flags);
+
+int nfct_attr_is_set (const struct nf_conntrack *ct,
+		      const enum nf_conntrack_attr type);
+const void *nfct_get_attr (const struct nf_conntrack *ct,
+			   const enum nf_conntrack_attr type);
+uint8_t  nfct_get_attr_u8  (const struct nf_conntrack *ct,
+			    const enum nf_conntrack_attr type);
+uint16_t nfct_get_attr_u16 (const struct nf_conntrack *ct,
+			    const enum nf_conntrack_attr type);
+uint32_t nfct_get_attr_u32 (const struct nf_conntrack *ct,
+			    const enum nf_conntrack_attr type);
+
+void nfct_set_attr (struct nf_conntrack *ct, const enum nf_conntrack_attr type,
+		    const void *value);
+void nfct_set_attr_u8  (struct nf_conntrack *ct,
+			const enum nf_conntrack_attr type, uint8_t value);
+void nfct_set_attr_u16 (struct nf_conntrack *ct,
+			const enum nf_conntrack_attr type, uint16_t value);
+void nfct_set_attr_u32 (struct nf_conntrack *ct,
+			const enum nf_conntrack_attr type, uint32_t value);
+
+/*
+ * Build appends attributes of entry to message, parse takes them from it
+ */
+int nfct_nlmsg_build (struct nlmsghdr *h, const struct nf_conntrack *ct);
+int nfct_nlmsg_parse (const struct nlmsghdr *h, struct nf_conntrack *ct);
+
+#endif  /* NL_RAW */
+
+#endif  /* NFCT_CORE_H */
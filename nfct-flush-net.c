@@ -1,50 +1,1265 @@
+#include <errno.h>
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-#include <libnetfilter_conntrack/libnetfilter_conntrack.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
+#include "net-match.h"
+#include "nfct-core.h"
 #include "nfct-flush-net.h"
+#include "usdt.h"
 
-struct ctx {
+#ifdef NL_CANNED
+#include "nl-canned.h"
+#endif
+
+#define CT_COUNT  "/proc/sys/net/netfilter/nf_conntrack_count"
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void pause_for (double t)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = t;
+	ts.tv_nsec = (t - ts.tv_sec) * 1e9;
+
+	while (nanosleep (&ts, &ts) != 0) {}
+}
+
+static unsigned long ct_count (void)
+{
+	FILE *f;
+	unsigned long count;
+
+	if ((f = fopen (CT_COUNT, "r")) == NULL)
+		return 0;
+
+	if (fscanf (f, "%lu", &count) != 1)
+		count = 0;
+
+	fclose (f);
+	return count;
+}
+
+int nfct_net_set (struct nfct_net *o, int family, const void *address,
+		  unsigned prefix, int flags)
+{
+	const unsigned size = family == AF_INET ? 4 : 16;
+	unsigned char *m = (void *) &o->mask;
+	unsigned i;
+
+	if ((family != AF_INET && family != AF_INET6) || prefix > size * 8) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	memset (o, 0, sizeof (*o));
+
+	o->family = family;
+	o->flags  = flags & (NFCT_NET_REPLY | NFCT_NET_SRC);
+
+	if (address != NULL)
+		memcpy (&o->address, address, size);
+
+	for (i = 0; i < size; ++i, prefix -= prefix < 8 ? prefix : 8)
+		m[i] = prefix < 8 ? 0xff00 >> prefix : 0xff;
+
+	o->address.w[0] &= o->mask.w[0];
+	o->address.w[1] &= o->mask.w[1];
+	return 1;
+}
+
+int nfct_net_parse (struct nfct_net *o, const char *from, int flags)
+{
+	char buf[INET6_ADDRSTRLEN + 4], *p, *end;
+	union nfct_addr a;
+	unsigned long prefix;
+	int family;
+
+	if (snprintf (buf, sizeof (buf), "%s", from) >= sizeof (buf))
+		goto einval;
+
+	if ((p = strchr (buf, '/')) != NULL)
+		*p++ = '\0';
+
+	family = strchr (buf, ':') != NULL ? AF_INET6 : AF_INET;
+
+	if (inet_pton (family, buf, &a) != 1)
+		goto einval;
+
+	if (p == NULL)
+		prefix = family == AF_INET ? 32 : 128;
+	else if ((prefix = strtoul (p, &end, 10)) > 128 || *p == '\0' ||
+		 *end != '\0')
+		goto einval;
+
+	return nfct_net_set (o, family, &a, prefix, flags);
+einval:
+	errno = EINVAL;
+	return 0;
+}
+
+/*
+ * Conntrack address attribute to match, indexed by family and net flags
+ */
+static const enum nf_conntrack_attr net_attr[2][4] = {
+	{
+		ATTR_ORIG_IPV4_DST, ATTR_REPL_IPV4_DST,
+		ATTR_ORIG_IPV4_SRC, ATTR_REPL_IPV4_SRC,
+	},
+	{
+		ATTR_ORIG_IPV6_DST, ATTR_REPL_IPV6_DST,
+		ATTR_ORIG_IPV6_SRC, ATTR_REPL_IPV6_SRC,
+	},
+};
+
+/*
+ * Prefix set split into groups of net_attr layout, entries are matched
+ * against them in batches
+ */
+static void groups_fini (struct net_set group[2][4])
+{
+	unsigned f, k;
+
+	for (f = 0; f < 2; ++f)
+		for (k = 0; k < 4; ++k)
+			net_set_fini (&group[f][k]);
+}
+
+static int groups_init (struct net_set group[2][4],
+			const struct nfct_net *set, size_t count)
+{
+	size_t size[2][4] = {}, i;
+	const struct nfct_net *o;
+	unsigned f, k;
+
+	for (i = 0, o = set; i < count; ++i, ++o)
+		++size[o->family == AF_INET6][o->flags & 3];
+
+	for (f = 0; f < 2; ++f)
+		for (k = 0; k < 4; ++k)
+			if (!net_set_init (&group[f][k], f ? AF_INET6 : AF_INET,
+					   size[f][k]))
+				goto no_set;
+
+	memset (size, 0, sizeof (size));
+
+	for (i = 0, o = set; i < count; ++i, ++o) {
+		f = o->family == AF_INET6;
+		k = o->flags & 3;
+
+		net_set_put (&group[f][k], size[f][k]++, &o->address, &o->mask);
+	}
+
+	return 1;
+no_set:
+	groups_fini (group);
+	return 0;
+}
+
+struct batch {
+	struct nf_conntrack *ct[NET_BATCH];
+	unsigned char family[NET_BATCH];
+	unsigned count;
+
+	union {
+		uint32_t in [NET_BATCH];
+		uint64_t in6[NET_BATCH][2];
+	} a;
+};
+
+static uint64_t batch_match (struct batch *o, const struct net_set *g,
+			     enum nf_conntrack_attr attr)
+{
+	uint64_t valid = 0;
+	unsigned i;
+
+	for (i = 0; i < o->count; ++i) {
+		if (o->family[i] != g->family ||
+		    !nfct_attr_is_set (o->ct[i], attr))
+			continue;
+
+		valid |= UINT64_C (1) << i;
+
+		if (g->family == AF_INET)
+			o->a.in[i] = nfct_get_attr_u32 (o->ct[i], attr);
+		else
+			memcpy (o->a.in6[i], nfct_get_attr (o->ct[i], attr),
+				sizeof (o->a.in6[i]));
+	}
+
+	return valid == 0 ? 0 : net_set_match (g, &o->a, o->count) & valid;
+}
+
+/*
+ * Token bucket with AIMD back-off on delete round-trip time: when smoothed
+ * RTT exceeds RTT_LIMIT times the best one seen, the rate is halved, else
+ * it grows by 1/32 of the configured rate per check.
+ */
+#define RTT_CHECK  64
+#define RTT_LIMIT  4
+
+struct pace {
+	double rate, burst, tokens, last;
+	double rtt_min, rtt;
+	unsigned limit, count;
+	int adaptive;
+};
+
+static void pace_init (struct pace *o, const struct nfct_flush_opts *opts,
+		       unsigned share)
+{
+	o->limit    = opts->rate > 0 && opts->rate < share ? 1 :
+							 opts->rate / share;
+	o->rate     = o->limit;
+	o->burst    = opts->burst > 0 ? opts->burst / share : o->limit / 10;
+	o->adaptive = opts->adaptive;
+
+	if (o->burst < 1)
+		o->burst = 1;
+
+	o->tokens  = o->burst;
+	o->last    = now ();
+	o->rtt_min = 0;
+	o->rtt     = 0;
+	o->count   = 0;
+}
+
+static void pace_wait (struct pace *o)
+{
+	double t;
+
+	if (o->limit == 0)
+		return;
+
+	t = now ();
+	o->tokens += (t - o->last) * o->rate;
+	o->last = t;
+
+	if (o->tokens > o->burst)
+		o->tokens = o->burst;
+
+	if (o->tokens < 1) {
+		pause_for ((1 - o->tokens) / o->rate);
+		o->last = now ();
+		o->tokens = 1;
+	}
+
+	o->tokens -= 1;
+}
+
+static void pace_feed (struct pace *o, double rtt)
+{
+	if (o->limit == 0 || !o->adaptive)
+		return;
+
+	if (o->rtt_min == 0 || rtt < o->rtt_min)
+		o->rtt_min = rtt;
+
+	o->rtt = o->rtt == 0 ? rtt : (o->rtt * 7 + rtt) / 8;
+
+	if (++o->count < RTT_CHECK)
+		return;
+
+	o->count = 0;
+
+	if (o->rtt > o->rtt_min * RTT_LIMIT) {
+		if ((o->rate /= 2) < 1)
+			o->rate = 1;
+	}
+	else if ((o->rate += o->limit / 32.0) > o->limit)
+		o->rate = o->limit;
+}
+
+/*
+ * Delete worker: owns conntrack handle and bounded queue of matched entries
+ */
+#define WORKER_QUEUE  1024
+#define WORKER_BATCH  64
+
+struct item {
+	struct nf_conntrack *ct;
+	uint64_t owners;	/* mask of requests matched the entry	*/
+};
+
+struct worker {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t ready, space;
+	struct item queue[WORKER_QUEUE];
+	unsigned head, count, taken;	/* taken out of queue, not done yet */
+	int stop;
+
+	struct nfct_flush_req *req;
 	struct nfct_handle *handle;
-	struct in_net *net;
+	struct pace pace;
+	struct nfct_flush_worker_stat stat;
+	unsigned rate;
 };
 
-static int flush_cb (enum nf_conntrack_msg_type type,
-			struct nf_conntrack *ct, void *data)
+/*
+ * Canned conntrack dump (NFCT_CANNED) replaces the kernel one in benchmark
+ * builds (NL_CANNED defined), there are no handles then and deletes are not
+ * sent
+ */
+#ifdef NL_CANNED
+static struct nl_canned *canned;
+#else
+#define canned  ((struct nl_canned *) NULL)
+#endif
+
+static struct nfct_handle *ct_open (unsigned rcvbuf)
+{
+	struct nfct_handle *h;
+
+	if (canned != NULL || (h = nfct_open (CONNTRACK, 0)) == NULL)
+		return NULL;
+
+	if (rcvbuf > 0)
+		nfnl_rcvbufsiz (nfct_nfnlh (h), rcvbuf);
+
+	return h;
+}
+
+static void ct_close (struct nfct_handle *h)
+{
+	if (h != NULL)
+		nfct_close (h);
+}
+
+static int ct_delete (struct nfct_handle *h, struct pace *pace,
+		      struct nf_conntrack *ct, double *busy)
+{
+	double t;
+	int ok;
+
+	pace_wait (pace);
+
+	t = now ();
+	ok = h == NULL || nfct_query (h, NFCT_Q_DESTROY, ct) == 0;
+	t = now () - t;
+
+	USDT_PROBE2 (nfct, delete, ok, (long) (t * 1e9));
+
+	pace_feed (pace, t);
+	*busy += t;
+	return ok;
+}
+
+/*
+ * Credits deleted entry to all requests matched it, workers do it
+ * concurrently
+ */
+static void credit (struct nfct_flush_req *req, uint64_t owners)
+{
+	for (; owners != 0; owners &= owners - 1)
+		__atomic_fetch_add (&req[__builtin_ctzll (owners)].deleted, 1,
+				    __ATOMIC_RELAXED);
+}
+
+static void *worker_main (void *arg)
+{
+	struct worker *w = arg;
+	struct item batch[WORKER_BATCH];
+	unsigned i, n;
+	unsigned long deleted;
+	double busy;
+
+	for (;;) {
+		pthread_mutex_lock (&w->lock);
+
+		while (w->count == 0 && !w->stop)
+			pthread_cond_wait (&w->ready, &w->lock);
+
+		for (n = 0; n < WORKER_BATCH && w->count > 0; ++n) {
+			batch[n] = w->queue[w->head];
+			w->head = (w->head + 1) % WORKER_QUEUE;
+			--w->count;
+		}
+
+		w->taken = n;
+		pthread_cond_signal (&w->space);
+		pthread_mutex_unlock (&w->lock);
+
+		if (n == 0)
+			return NULL;
+
+		for (i = 0, deleted = 0, busy = 0; i < n; ++i) {
+			if (ct_delete (w->handle, &w->pace, batch[i].ct,
+				       &busy)) {
+				credit (w->req, batch[i].owners);
+				++deleted;
+			}
+
+			nfct_destroy (batch[i].ct);
+		}
+
+		pthread_mutex_lock (&w->lock);
+		w->stat.deleted += deleted;
+		w->stat.busy    += busy;
+		w->rate          = w->pace.rate;
+		w->taken         = 0;
+		pthread_cond_signal (&w->space);
+		pthread_mutex_unlock (&w->lock);
+	}
+}
+
+static void worker_push (struct worker *w, struct nf_conntrack *ct,
+			 uint64_t owners)
+{
+	struct item *o;
+
+	pthread_mutex_lock (&w->lock);
+
+	while (w->count == WORKER_QUEUE)
+		pthread_cond_wait (&w->space, &w->lock);
+
+	o = w->queue + (w->head + w->count++) % WORKER_QUEUE;
+	o->ct     = ct;
+	o->owners = owners;
+
+	pthread_cond_signal (&w->ready);
+	pthread_mutex_unlock (&w->lock);
+}
+
+/*
+ * Waits for all entries pushed to be done with
+ */
+static void worker_drain (struct worker *w)
+{
+	pthread_mutex_lock (&w->lock);
+
+	while (w->count > 0 || w->taken > 0)
+		pthread_cond_wait (&w->space, &w->lock);
+
+	pthread_mutex_unlock (&w->lock);
+}
+
+static void worker_stop (struct worker *w)
+{
+	pthread_mutex_lock (&w->lock);
+	w->stop = 1;
+	pthread_cond_signal (&w->ready);
+	pthread_mutex_unlock (&w->lock);
+
+	pthread_join (w->thread, NULL);
+}
+
+static void worker_fini (struct worker *w)
+{
+	pthread_cond_destroy (&w->space);
+	pthread_cond_destroy (&w->ready);
+	pthread_mutex_destroy (&w->lock);
+}
+
+static int worker_init (struct worker *w, const struct nfct_flush_opts *opts,
+			struct nfct_flush_req *req, struct nfct_handle *h)
+{
+	w->handle = h;
+	w->req    = req;
+
+	pthread_mutex_init (&w->lock, NULL);
+	pthread_cond_init (&w->ready, NULL);
+	pthread_cond_init (&w->space, NULL);
+
+	w->head = w->count = w->taken = w->stop = 0;
+	w->stat.deleted = 0;
+	w->stat.busy    = 0;
+
+	pace_init (&w->pace, opts, opts->workers);
+	w->rate = w->pace.rate;
+
+	if (pthread_create (&w->thread, NULL, worker_main, w) != 0) {
+		worker_fini (w);
+		return 0;
+	}
+
+	return 1;
+}
+
+static uint32_t addr_hash (const struct nf_conntrack *ct, int family,
+			   enum nf_conntrack_attr v4, enum nf_conntrack_attr v6)
+{
+	const uint32_t *a;
+
+	if (family == AF_INET)
+		return nfct_get_attr_u32 (ct, v4);
+
+	a = nfct_get_attr (ct, v6);
+	return a[0] ^ a[1] ^ a[2] ^ a[3];
+}
+
+static unsigned ct_hash (const struct nf_conntrack *ct, int family)
+{
+	uint32_t h;
+
+	h  = addr_hash (ct, family, ATTR_ORIG_IPV4_SRC, ATTR_ORIG_IPV6_SRC);
+	h  = (h ^ addr_hash (ct, family, ATTR_ORIG_IPV4_DST,
+					 ATTR_ORIG_IPV6_DST)) * 0x9e3779b1;
+	h ^= nfct_get_attr_u16 (ct, ATTR_ORIG_PORT_SRC) << 16 |
+	     nfct_get_attr_u16 (ct, ATTR_ORIG_PORT_DST);
+	h ^= nfct_get_attr_u8 (ct, ATTR_ORIG_L4PROTO);
+	h *= 0x85ebca6b;
+
+	return h ^ h >> 16;
+}
+
+/*
+ * Flush context keeps handles open between flushes: the dumping one and
+ * ones of delete workers, opened as needed
+ */
+struct nfct_flush {
+	struct nfct_handle *handle, **worker;
+	unsigned workers, rcvbuf;
+	int soft;		/* socket for expire batches or -1	*/
+};
+
+#define RCVBUF_DEFAULT	(4u << 20)
+#define RCVBUF_MAX	(256u << 20)
+#define DUMP_RETRY	4
+
+/*
+ * Soft flush batch: update requests setting timeout of matched entries,
+ * sent with single write without acknowledgements, kernel reports only
+ * failed ones (sequence number is index in batch)
+ */
+#define SOFT_BATCH	64
+#define SOFT_MSG_MAX	512
+
+struct soft {
+	unsigned char buf[SOFT_BATCH * SOFT_MSG_MAX];
+	size_t len;
+	uint64_t owners[SOFT_BATCH];
+	unsigned count;
+	uint64_t seed;
+};
+
+struct ctx {
+	struct nfct_flush *flush;
+	struct nfct_handle *handle;	/* for inline deletes */
+	int intr;
+	struct net_set (*group)[2][4];	/* per request */
+	struct nfct_flush_req *req;
+	size_t count;
+	struct batch batch;
+	struct soft soft;
+	const struct nfct_flush_opts *opts;
+	struct pace pace;
+	struct nfct_flush_stat stat;
+	double start, report, busy;
+
+	struct worker *worker;
+	struct nfct_flush_worker_stat *worker_stat;
+};
+
+static void collect (struct ctx *c)
+{
+	struct nfct_flush_stat *s = &c->stat;
+	unsigned i;
+
+	if (s->workers == 0) {
+		s->rate = c->pace.rate;
+		return;
+	}
+
+	for (i = 0, s->deleted = 0, s->rate = 0; i < s->workers; ++i) {
+		pthread_mutex_lock (&c->worker[i].lock);
+		c->worker_stat[i] = c->worker[i].stat;
+		s->rate += c->worker[i].rate;
+		pthread_mutex_unlock (&c->worker[i].lock);
+
+		s->deleted += c->worker_stat[i].deleted;
+	}
+}
+
+static void report (struct ctx *c, int done)
+{
+	struct nfct_flush_stat *s = &c->stat;
+	double t;
+
+	if (c->opts->progress == NULL)
+		return;
+
+	if ((t = now ()) < c->report && !done)
+		return;
+
+	c->report = t + 1;
+
+	collect (c);
+
+	s->elapsed = t - c->start;
+	s->done    = done;
+	s->eta     = done ? 0 : -1;
+
+	if (!done && s->scanned > 0 && s->total > s->scanned)
+		s->eta = s->elapsed * (s->total - s->scanned) / s->scanned;
+
+	c->opts->progress (s, c->opts->cookie);
+}
+
+static uint64_t soft_errors (int fd)
+{
+	char buf[8192];
+	struct nlmsghdr *h;
+	struct nlmsgerr *e;
+	uint64_t failed = 0;
+	ssize_t len;
+
+	while ((len = recv (fd, buf, sizeof (buf), MSG_DONTWAIT)) > 0)
+		for (h = (void *) buf; NLMSG_OK (h, len);
+		     h = NLMSG_NEXT (h, len)) {
+			e = NLMSG_DATA (h);
+
+			if (h->nlmsg_type == NLMSG_ERROR && e->error != 0 &&
+			    h->nlmsg_seq < SOFT_BATCH)
+				failed |= UINT64_C (1) << h->nlmsg_seq;
+		}
+
+	return failed;
+}
+
+/*
+ * Kernel handles requests within write, thus all errors are queued on
+ * socket when it returns
+ */
+static void soft_send (struct ctx *c)
+{
+	struct soft *s = &c->soft;
+	const int fd = c->flush->soft;
+	uint64_t failed = 0;
+	unsigned i, ok;
+	double t;
+
+	if (s->count == 0)
+		return;
+
+	t = now ();
+
+	if (fd != -1)
+		failed = send (fd, s->buf, s->len, 0) != s->len ?
+			 ~UINT64_C (0) : soft_errors (fd);
+
+	t = now () - t;
+
+	for (i = 0, ok = 0; i < s->count; ++i)
+		if ((failed >> i & 1) == 0) {
+			credit (c->req, s->owners[i]);
+			++ok;
+		}
+
+	USDT_PROBE3 (nfct, expire, s->count, ok, (long) (t * 1e9));
+
+	c->stat.deleted += ok;
+	c->busy += t;
+	s->count = 0;
+	s->len   = 0;
+}
+
+static uint64_t soft_next (struct soft *s)
+{
+	s->seed ^= s->seed << 13;
+	s->seed ^= s->seed >> 7;
+	s->seed ^= s->seed << 17;
+	return s->seed;
+}
+
+/*
+ * Update request holds original tuple and zone to find the entry by and
+ * new timeout spread evenly over expire interval
+ */
+static void soft_put (struct ctx *c, struct nf_conntrack *ct, uint64_t owners)
+{
+	struct soft *s = &c->soft;
+	struct nf_conntrack *u;
+	struct nlmsghdr *h;
+	struct nfgenmsg *g;
+
+	if (s->count == SOFT_BATCH || s->len + SOFT_MSG_MAX > sizeof (s->buf))
+		soft_send (c);
+
+	if ((u = nfct_new ()) == NULL)
+		return;
+
+	nfct_copy (u, ct, NFCT_CP_ORIG);
+	nfct_set_attr_u16 (u, ATTR_ZONE, nfct_get_attr_u16 (ct, ATTR_ZONE));
+	nfct_set_attr_u32 (u, ATTR_TIMEOUT,
+			   1 + soft_next (s) % c->opts->expire);
+
+	pace_wait (&c->pace);
+
+	h = (void *) (s->buf + s->len);
+	memset (h, 0, NLMSG_SPACE (sizeof (*g)));
+
+	h->nlmsg_len   = NLMSG_LENGTH (sizeof (*g));
+	h->nlmsg_type  = NFNL_SUBSYS_CTNETLINK << 8 | IPCTNL_MSG_CT_NEW;
+	h->nlmsg_flags = NLM_F_REQUEST;
+	h->nlmsg_seq   = s->count;
+
+	g = NLMSG_DATA (h);
+	g->nfgen_family = nfct_get_attr_u8 (ct, ATTR_L3PROTO);
+	g->version      = NFNETLINK_V0;
+
+	nfct_nlmsg_build (h, u);
+	nfct_destroy (u);
+
+	s->len += NLMSG_ALIGN (h->nlmsg_len);
+	s->owners[s->count++] = owners;
+}
+
+/*
+ * Entry re-timed by soft flush stays in table: repeated dump shows it
+ * again with timeout within expire interval, it is skipped then
+ */
+static int soft_done (struct ctx *c, const struct nf_conntrack *ct)
+{
+	return c->opts->expire > 0 && c->stat.retries > 0 &&
+	       nfct_attr_is_set (ct, ATTR_TIMEOUT) > 0 &&
+	       nfct_get_attr_u32 (ct, ATTR_TIMEOUT) <= c->opts->expire;
+}
+
+static void batch_flush (struct ctx *c)
+{
+	struct batch *b = &c->batch;
+	struct nf_conntrack *ct;
+	uint64_t owners[NET_BATCH] = {}, hit, o;
+	size_t r;
+	unsigned f, k, i, w;
+
+	for (r = 0; r < c->count; ++r)
+		for (f = 0; f < 2; ++f)
+			for (k = 0; k < 4; ++k) {
+				if (c->group[r][f][k].count == 0)
+					continue;
+
+				hit = batch_match (b, &c->group[r][f][k],
+						   net_attr[f][k]);
+
+				for (; hit != 0; hit &= hit - 1)
+					owners[__builtin_ctzll (hit)] |=
+						UINT64_C (1) << r;
+			}
+
+	for (i = 0; i < b->count; ++i) {
+		ct = b->ct[i];
+
+		if (owners[i] == 0 || soft_done (c, ct)) {
+			nfct_destroy (ct);
+			continue;
+		}
+
+		++c->stat.matched;
+
+		for (o = owners[i]; o != 0; o &= o - 1)
+			++c->req[__builtin_ctzll (o)].matched;
+
+		if (c->opts->dry_run) {
+			nfct_destroy (ct);
+			continue;
+		}
+
+		if (c->opts->expire > 0) {
+			soft_put (c, ct, owners[i]);
+			nfct_destroy (ct);
+			continue;
+		}
+
+		if (c->stat.workers > 0) {
+			w = ct_hash (ct, b->family[i]) % c->stat.workers;
+			worker_push (c->worker + w, ct, owners[i]);
+			continue;
+		}
+
+		if (ct_delete (c->handle, &c->pace, ct, &c->busy)) {
+			credit (c->req, owners[i]);
+			++c->stat.deleted;
+		}
+
+		nfct_destroy (ct);
+	}
+
+	b->count = 0;
+}
+
+static int flush_cb (const struct nlmsghdr *h, enum nf_conntrack_msg_type type,
+		     struct nf_conntrack *ct, void *data)
 {
 	struct ctx *c = data;
-	struct in_addr dest;
+	struct batch *b = &c->batch;
+
+	if ((h->nlmsg_flags & NLM_F_DUMP_INTR) != 0)
+		c->intr = 1;
 
-	if ((type != NFCT_T_NEW && type != NFCT_T_UPDATE) ||
-	    !nfct_attr_is_set (ct, ATTR_IPV4_DST))
+	if (type != NFCT_T_NEW && type != NFCT_T_UPDATE)
 		return NFCT_CB_CONTINUE;
 
-	dest.s_addr = nfct_get_attr_u32 (ct, ATTR_IPV4_DST);
+	++c->stat.scanned;
+	report (c, 0);
 
-	if ((dest.s_addr & c->net->mask.s_addr) != c->net->address.s_addr)
-		return NFCT_CB_CONTINUE;
+	if (c->opts->inspect != NULL)
+		c->opts->inspect (ct, c->opts->cookie);
+
+	b->family[b->count] = nfct_get_attr_u8 (ct, ATTR_L3PROTO);
+	b->ct[b->count++]   = ct;
 
-	(void) nfct_query(c->handle, NFCT_Q_DESTROY, ct);
+	if (b->count == NET_BATCH)
+		batch_flush (c);
 
-	return NFCT_CB_CONTINUE;
+	return NFCT_CB_STOLEN;
 }
 
-int nfct_flush_net (struct in_net *net)
+#ifdef NL_CANNED
+static int canned_dump (struct ctx *c)
+{
+	const struct nlmsghdr *h;
+	struct nf_conntrack *ct;
+
+	nl_canned_rewind (canned);
+
+	while ((h = nl_canned_next (canned)) != NULL) {
+		if (h->nlmsg_type == NLMSG_DONE)
+			break;
+
+		if ((ct = nfct_new ()) == NULL)
+			return -1;
+
+		if (nfct_nlmsg_parse (h, ct) != 0 ||
+		    flush_cb (h, NFCT_T_NEW, ct, c) != NFCT_CB_STOLEN)
+			nfct_destroy (ct);
+	}
+
+	return 0;
+}
+#endif
+
+/*
+ * Opens delete handles up to given number, they are kept for later flushes
+ */
+static int flush_pool (struct nfct_flush *o, unsigned n)
+{
+	struct nfct_handle **p;
+
+	if (n <= o->workers)
+		return 1;
+
+	if ((p = realloc (o->worker, n * sizeof (p[0]))) == NULL)
+		return 0;
+
+	for (o->worker = p; o->workers < n; ++o->workers)
+		if ((p[o->workers] = ct_open (0)) == NULL && canned == NULL)
+			return 0;
+
+	return 1;
+}
+
+static int workers_start (struct ctx *c)
+{
+	const unsigned n = c->opts->workers;
+	unsigned i;
+
+	/* inline deletes go via pool handle, their acks do not mix with dump */
+	if (n < 2) {
+		if (!flush_pool (c->flush, 1))
+			return 0;
+
+		c->handle = c->flush->worker[0];
+		return 1;
+	}
+
+	c->worker      = calloc (n, sizeof (c->worker[0]));
+	c->worker_stat = calloc (n, sizeof (c->worker_stat[0]));
+
+	if (c->worker == NULL || c->worker_stat == NULL)
+		goto no_init;
+
+	if (!flush_pool (c->flush, n))
+		goto no_init;
+
+	for (i = 0; i < n; ++i)
+		if (!worker_init (c->worker + i, c->opts, c->req,
+				  c->flush->worker[i]))
+			goto no_worker;
+
+	c->stat.workers = n;
+	c->stat.worker  = c->worker_stat;
+	return 1;
+no_worker:
+	while (i-- > 0) {
+		worker_stop (c->worker + i);
+		worker_fini (c->worker + i);
+	}
+no_init:
+	free (c->worker_stat);
+	free (c->worker);
+	return 0;
+}
+
+static void workers_drain (struct ctx *c)
+{
+	unsigned i;
+
+	for (i = 0; i < c->stat.workers; ++i)
+		worker_drain (c->worker + i);
+}
+
+static void workers_stop (struct ctx *c)
+{
+	unsigned i;
+
+	for (i = 0; i < c->stat.workers; ++i)
+		worker_stop (c->worker + i);
+}
+
+static void workers_fini (struct ctx *c)
+{
+	unsigned i;
+
+	for (i = 0; i < c->stat.workers; ++i)
+		worker_fini (c->worker + i);
+
+	free (c->worker_stat);
+	free (c->worker);
+}
+
+/*
+ * Returns family to dump for given requests: single one if all prefixes
+ * are of the same family, AF_UNSPEC to dump all of them otherwise
+ */
+static int req_family (const struct nfct_flush_req *req, size_t count)
+{
+	int family = AF_UNSPEC;
+	size_t r, i;
+
+	for (r = 0; r < count; ++r)
+		for (i = 0; i < req[r].count; ++i)
+			if (family == AF_UNSPEC)
+				family = req[r].set[i].family;
+			else if (req[r].set[i].family != family)
+				return AF_UNSPEC;
+
+	return family;
+}
+
+static int ctx_init (struct ctx *c, struct nfct_flush_req *req, size_t count)
 {
-	struct ctx c;
-	const int family = AF_INET;
+	size_t r, i;
+
+	if (count > NFCT_FLUSH_REQ_MAX) {
+		errno = EINVAL;
+		return 0;
+	}
+
+	for (r = 0; r < count; ++r)
+		for (i = 0; i < req[r].count; ++i)
+			if (req[r].set[i].family != AF_INET &&
+			    req[r].set[i].family != AF_INET6) {
+				errno = EINVAL;
+				return 0;
+			}
+
+	if ((c->group = calloc (count, sizeof (c->group[0]))) == NULL)
+		return 0;
+
+	for (r = 0; r < count; ++r) {
+		req[r].matched = req[r].deleted = 0;
+
+		if (!groups_init (c->group[r], req[r].set, req[r].count))
+			goto no_group;
+	}
+
+	c->req   = req;
+	c->count = count;
+	return 1;
+no_group:
+	while (r-- > 0)
+		groups_fini (c->group[r]);
+
+	free (c->group);
+	return 0;
+}
+
+static void ctx_fini (struct ctx *c)
+{
+	size_t r;
+
+	for (r = 0; r < c->count; ++r)
+		groups_fini (c->group[r]);
+
+	free (c->group);
+}
+
+static inline unsigned net_len (const struct nfct_net *o)
+{
+	return __builtin_popcountll (o->mask.w[0]) +
+	       __builtin_popcountll (o->mask.w[1]);
+}
+
+/*
+ * nfct:flush_start probe gets request index, number of prefixes, family,
+ * address and length of the first one, nfct:flush_end gets request index,
+ * number of matched and deleted entries and elapsed time in ns
+ */
+static void probe_start (const struct ctx *c)
+{
+	size_t r;
+
+	for (r = 0; r < c->count; ++r)
+		if (c->req[r].count > 0)
+			USDT_PROBE5 (nfct, flush_start, r, c->req[r].count,
+				     c->req[r].set[0].family,
+				     &c->req[r].set[0].address,
+				     net_len (c->req[r].set));
+}
+
+static void probe_end (const struct ctx *c)
+{
+	size_t r;
+
+	for (r = 0; r < c->count; ++r)
+		USDT_PROBE4 (nfct, flush_end, r, c->req[r].matched,
+			     c->req[r].deleted,
+			     (long) ((now () - c->start) * 1e9));
+}
+
+struct nfct_flush *nfct_flush_alloc (unsigned rcvbuf)
+{
+	struct nfct_flush *o;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+#ifdef NL_CANNED
+	canned    = nl_canned ("NFCT_CANNED");
+#endif
+	o->rcvbuf = rcvbuf > 0 ? rcvbuf : RCVBUF_DEFAULT;
+	o->soft   = -1;
+
+	if ((o->handle = ct_open (o->rcvbuf)) == NULL && canned == NULL) {
+		free (o);
+		return NULL;
+	}
+
+	return o;
+}
+
+void nfct_flush_free (struct nfct_flush *o)
+{
+	unsigned i;
+
+	if (o == NULL)
+		return;
+
+	for (i = 0; i < o->workers; ++i)
+		ct_close (o->worker[i]);
+
+	free (o->worker);
+	ct_close (o->handle);
+
+	if (o->soft != -1)
+		close (o->soft);
+
+	free (o);
+}
+
+/*
+ * Expire batches go via own socket, errors reported back to it do not
+ * mix with dump then
+ */
+static int soft_open (struct nfct_flush *o)
+{
+	const int one = 1;
+
+	if (canned != NULL || o->soft != -1)
+		return 1;
+
+	o->soft = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC,
+			  NETLINK_NETFILTER);
+	if (o->soft == -1)
+		return 0;
+
+	/* errors need not carry failed request back */
+	(void) setsockopt (o->soft, SOL_NETLINK, NETLINK_CAP_ACK, &one,
+			   sizeof (one));
+	return 1;
+}
+
+/*
+ * Socket overrun loses part of dump and leaves the rest of it queued:
+ * reopen handle with larger receive buffer. If that fails the old handle
+ * is kept for later flushes, the rest of dump is dropped from it then.
+ */
+static int dump_grow (struct nfct_flush *o)
+{
+	struct nfct_handle *h;
+	char buf[8192];
+
+	if (errno != ENOBUFS)
+		return 0;
+
+	if (o->rcvbuf < RCVBUF_MAX && (h = ct_open (o->rcvbuf * 2)) != NULL) {
+		ct_close (o->handle);
+		o->handle  = h;
+		o->rcvbuf *= 2;
+		return 1;
+	}
+
+	while (recv (nfct_fd (o->handle), buf, sizeof (buf), MSG_DONTWAIT)
+	       > 0) {}
+
+	errno = ENOBUFS;
+	return 0;
+}
+
+/*
+ * Repeated dump scans the table anew. Entries deleted already do not show
+ * up again, thus they stay counted as matched, other ones are matched
+ * again. Entries re-timed by soft flush do show up again, but they are
+ * skipped, thus counters are kept as is then.
+ */
+static void dump_reset (struct ctx *c)
+{
+	size_t r;
+
+	workers_drain (c);
+	collect (c);
+
+	c->stat.scanned = 0;
+
+	if (c->opts->expire > 0)
+		return;
+
+	c->stat.matched = c->stat.deleted;
+
+	for (r = 0; r < c->count; ++r)
+		c->req[r].matched = c->req[r].deleted;
+}
+
+/*
+ * Dump interrupted by table change may miss entries: repeat it, entries
+ * deleted already do not show up again, ones re-timed already are not
+ * updated again. The last attempt is taken as is.
+ */
+static int dump (struct ctx *c, int family)
+{
+	struct nfct_flush *o = c->flush;
 	int ret;
 
-	if ((c.handle = nfct_open (CONNTRACK, 0)) == NULL)
+#ifdef NL_CANNED
+	if (canned != NULL) {
+		ret = canned_dump (c);
+		batch_flush (c);
+		soft_send (c);
+		return ret;
+	}
+#endif
+
+	for (;;) {
+		c->intr = 0;
+
+		nfct_callback_register2 (o->handle, NFCT_T_ALL, flush_cb, c);
+		ret = nfct_query (o->handle, NFCT_Q_DUMP, &family);
+		batch_flush (c);
+		soft_send (c);
+
+		if ((ret == 0 && !c->intr) || c->stat.retries == DUMP_RETRY)
+			return ret;
+
+		if (ret != 0 && !dump_grow (o))
+			return ret;
+
+		++c->stat.retries;
+		dump_reset (c);
+	}
+}
+
+int nfct_flush_run (struct nfct_flush *o, struct nfct_flush_req *req,
+		    size_t count, const struct nfct_flush_opts *opts)
+{
+	static const struct nfct_flush_opts defaults;
+	struct ctx c = { .flush = o };
+	int family, ret;
+
+	if (!ctx_init (&c, req, count))
+		return -1;
+
+	family = req_family (req, count);
+	c.opts = opts != NULL ? opts : &defaults;
+
+	if ((c.opts->expire > 0 && !soft_open (o)) ||
+	    (!c.opts->dry_run && c.opts->expire == 0 && !workers_start (&c))) {
+		ctx_fini (&c);
 		return -1;
+	}
+
+	pace_init (&c.pace, c.opts, 1);
+
+	c.start = c.report = now ();
+	c.soft.seed = (uint64_t) (c.start * 1e9) | 1;
+	probe_start (&c);
 
-	c.net = net;
+	if (c.opts->progress != NULL)
+		c.stat.total = ct_count ();
 
-	nfct_callback_register (c.handle, NFCT_T_ALL, flush_cb, &c);
+	ret = dump (&c, family);
 
-	ret = nfct_query (c.handle, NFCT_Q_DUMP, &family);
+	workers_stop (&c);
 
-	nfct_close (c.handle);
+	report (&c, 1);
+	probe_end (&c);
+	workers_fini (&c);
+	ctx_fini (&c);
+	return ret;
+}
+
+int nfct_flush_multi (struct nfct_flush_req *req, size_t count,
+		      const struct nfct_flush_opts *o)
+{
+	struct nfct_flush *f;
+	int ret, e;
+
+	if ((f = nfct_flush_alloc (0)) == NULL)
+		return -1;
 
+	ret = nfct_flush_run (f, req, count, o);
+	e = errno;
+	nfct_flush_free (f);
+	errno = e;
 	return ret;
 }
+
+int nfct_flush_net_ex (const struct nfct_net *set, size_t count,
+		       const struct nfct_flush_opts *o)
+{
+	struct nfct_flush_req req = { .set = set, .count = count };
+
+	if (count == 0)
+		return 0;
+
+	return nfct_flush_multi (&req, 1, o);
+}
+
+int nfct_flush_net (struct in_net *net)
+{
+	struct nfct_net o = { .family = AF_INET };
+
+	o.address.in = net->address;
+	o.mask.in    = net->mask;
+
+	return nfct_flush_net_ex (&o, 1, NULL);
+}
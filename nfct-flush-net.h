@@ -1,12 +1,135 @@
 #ifndef _NFCT_FLUSH_NET_H
 #define _NFCT_FLUSH_NET_H  1_
 
+#include <stddef.h>
+#include <stdint.h>
 #include <netinet/in.h>
 
 struct in_net {
 	struct in_addr address, mask;
 };
 
+/*
+ * Family-generic prefix: matches address of original (default) or reply
+ * tuple, destination (default) or source one. Address and mask are kept
+ * in network byte order, IPv4 ones in the first word.
+ */
+#define NFCT_NET_REPLY	1
+#define NFCT_NET_SRC	2
+
+union nfct_addr {
+	struct in_addr	in;
+	struct in6_addr	in6;
+	uint64_t	w[2];
+};
+
+struct nfct_net {
+	unsigned char family, flags;
+	union nfct_addr address, mask;
+};
+
+int nfct_net_set (struct nfct_net *o, int family, const void *address,
+		  unsigned prefix, int flags);
+int nfct_net_parse (struct nfct_net *o, const char *from, int flags);
+
+struct nfct_flush_worker_stat {
+	unsigned long deleted;
+	double busy;		/* seconds spent in delete requests	*/
+};
+
+struct nfct_flush_stat {
+	unsigned long scanned, matched, deleted;
+	unsigned long total;	/* table size at start, zero if unknown	*/
+	unsigned rate;		/* current effective deletion rate	*/
+	double elapsed, eta;	/* in seconds, eta < 0 if unknown	*/
+	unsigned retries;	/* of dumps interrupted or overrun	*/
+	int done;
+
+	unsigned workers;
+	const struct nfct_flush_worker_stat *worker;
+};
+
+typedef void nfct_flush_progress_t (const struct nfct_flush_stat *s,
+				    void *cookie);
+
+struct nf_conntrack;
+
+typedef void nfct_flush_inspect_t (const struct nf_conntrack *ct,
+				   void *cookie);
+
+/*
+ * Deletion pacing: token bucket with given rate (entries per second) and
+ * burst size. Zero rate means no limit, zero burst means rate / 10. With
+ * adaptive flag set the effective rate is backed off while observed delete
+ * round-trip time grows and recovered slowly when it settles.
+ */
+struct nfct_flush_opts {
+	unsigned rate, burst;
+	int adaptive;
+
+	/*
+	 * Number of delete workers, each with own conntrack handle and
+	 * queue; matched entries are spread over them by tuple hash, rate
+	 * limit is shared equally. Zero or one means delete inline.
+	 */
+	unsigned workers;
+
+	nfct_flush_progress_t *progress;  /* called every second and at end */
+	void *cookie;
+
+	/*
+	 * Inspect callback sees every entry dumped. With dry run flag set
+	 * matched entries are counted but not deleted.
+	 */
+	nfct_flush_inspect_t *inspect;
+	int dry_run;
+
+	/*
+	 * Soft flush: instead of deleting matched entries set their timeout
+	 * to random value up to expire seconds in batched updates, kernel
+	 * garbage collector spreads teardown over that interval. Workers
+	 * are not used then, entries updated are counted as deleted.
+	 */
+	unsigned expire;
+};
+
+/*
+ * Deletes conntrack entries matching any prefix of the set with single
+ * table dump
+ */
+int nfct_flush_net_ex (const struct nfct_net *set, size_t count,
+		       const struct nfct_flush_opts *o);
+
+/*
+ * Serves several flush requests with single table dump, an entry matched
+ * by more than one of them is deleted once and credited to all of them
+ */
+#define NFCT_FLUSH_REQ_MAX  64
+
+struct nfct_flush_req {
+	const struct nfct_net *set;
+	size_t count;
+	unsigned long matched, deleted;
+};
+
+int nfct_flush_multi (struct nfct_flush_req *req, size_t count,
+		      const struct nfct_flush_opts *o);
+
+/*
+ * Flush context keeps conntrack handles open between flushes. Dump socket
+ * gets receive buffer of given size (zero means 4 MiB), doubled up to
+ * 256 MiB on overrun. Dump interrupted by table change or overrun is
+ * repeated up to four times; scanned entries are counted anew then, and
+ * matched ones are the ones deleted already plus ones matched again. In
+ * soft mode entries re-timed already stay in table: repeated dump skips
+ * ones with timeout within expire interval, they are neither counted nor
+ * updated again. Inspect callback may see some entries again.
+ */
+struct nfct_flush *nfct_flush_alloc (unsigned rcvbuf);
+void nfct_flush_free (struct nfct_flush *o);
+
+int nfct_flush_run (struct nfct_flush *o, struct nfct_flush_req *req,
+		    size_t count, const struct nfct_flush_opts *opts);
 int nfct_flush_net (struct in_net *net);
 
 #endif  /* _NFCT_FLUSH_NET_H */
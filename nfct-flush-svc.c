@@ -0,0 +1,103 @@
+/*
+ * Conntrack Flush Service Client
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "nfct-flush-svc.h"
+
+static int svc_connect (const char *path)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	int s, e;
+
+	if (snprintf (sa.sun_path, sizeof (sa.sun_path), "%s", path) >=
+	    sizeof (sa.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	if ((s = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) == -1)
+		return -1;
+
+	if (connect (s, (void *) &sa, sizeof (sa)) != 0) {
+		e = errno;
+		close (s);
+		errno = e;
+		return -1;
+	}
+
+	return s;
+}
+
+int nfct_flush_remote (const char *path, const struct nfct_net *set,
+		       size_t count, const struct nfct_flush_opts *o,
+		       struct nfct_flush_svc_reply *reply)
+{
+	struct nfct_flush_svc_req *req;
+	const size_t size = sizeof (*req) + count * sizeof (set[0]);
+	ssize_t len;
+	int s, e;
+
+	if (count > NFCT_FLUSH_SVC_MAX) {
+		errno = E2BIG;
+		return -1;
+	}
+
+	if ((req = calloc (1, size)) == NULL)
+		return -1;
+
+	req->version = NFCT_FLUSH_SVC_VERSION;
+	req->count   = count;
+
+	if (o != NULL) {
+		req->rate     = o->rate;
+		req->burst    = o->burst;
+		req->adaptive = o->adaptive;
+		req->workers  = o->workers;
+	}
+
+	memcpy (req->set, set, count * sizeof (set[0]));
+
+	if ((s = svc_connect (path != NULL ? path : NFCT_FLUSH_SVC_PATH)) == -1)
+		goto no_connect;
+
+	if (send (s, req, size, MSG_NOSIGNAL) != size)
+		goto no_send;
+
+	do
+		len = recv (s, reply, sizeof (*reply), 0);
+	while (len == -1 && errno == EINTR);
+
+	if (len != sizeof (*reply)) {
+		errno = len < 0 ? errno : EPROTO;
+		goto no_send;
+	}
+
+	close (s);
+	free (req);
+
+	if (reply->error == 0)
+		return 0;
+
+	errno = reply->error;
+	return -1;
+no_send:
+	e = errno;
+	close (s);
+	errno = e;
+no_connect:
+	free (req);
+	return -1;
+}
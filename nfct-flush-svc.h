@@ -0,0 +1,49 @@
+/*
+ * Conntrack Flush Service Protocol
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef NFCT_FLUSH_SVC_H
+#define NFCT_FLUSH_SVC_H  1
+
+#include <stdint.h>
+
+#include "nfct-flush-net.h"
+
+/*
+ * Requests and replies are single datagrams on SOCK_SEQPACKET Unix socket,
+ * client sends one request and waits for reply before the next one: one
+ * sent while the previous is pending is refused with EBUSY. Service limits
+ * number of delete workers, prefixes of unknown family or longer than the
+ * family allows are refused with EINVAL.
+ */
+#define NFCT_FLUSH_SVC_PATH	"/var/run/conntrack-flushd.sock"
+#define NFCT_FLUSH_SVC_VERSION	1
+#define NFCT_FLUSH_SVC_MAX	1024	/* prefixes per request */
+
+struct nfct_flush_svc_req {
+	uint32_t version;
+	uint32_t rate, burst, adaptive, workers;
+	uint32_t count;
+	struct nfct_net set[];
+};
+
+struct nfct_flush_svc_reply {
+	int32_t error;		/* errno value, zero on success	*/
+	uint32_t pad;
+	uint64_t matched, deleted;
+};
+
+/*
+ * Sends flush request to the service at path (default one if NULL) and
+ * waits for reply. Returns -1 with errno set to ENOENT or ECONNREFUSED if
+ * there is no service running.
+ */
+int nfct_flush_remote (const char *path, const struct nfct_net *set,
+		       size_t count, const struct nfct_flush_opts *o,
+		       struct nfct_flush_svc_reply *reply);
+
+#endif  /* NFCT_FLUSH_SVC_H */
@@ -0,0 +1,231 @@
+/*
+ * Canned NetLink Stream
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "nl-canned.h"
+
+/* defined by bench-alloc.o when linked in */
+extern unsigned long bench_allocs __attribute__ ((weak));
+
+struct nl_canned {
+	const char *env;
+	const unsigned char *data;
+	size_t size, pos, first;
+	int recorded;
+	double speed, start;
+	uint64_t origin;
+};
+
+static struct nl_canned streams[2];
+static unsigned long count;
+static double start;
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void pause_for (double t)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = t;
+	ts.tv_nsec = (t - ts.tv_sec) * 1e9;
+
+	while (nanosleep (&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+static void report (void)
+{
+	const double t = now () - start;
+	const unsigned long allocs = &bench_allocs != NULL ? bench_allocs : 0;
+
+	fprintf (stderr, "canned: %lu messages in %.3fs, %.0f msg/s, "
+			 "%.1f ns/msg",
+		 count, t, count / t, count > 0 ? t * 1e9 / count : 0);
+
+	if (&bench_allocs != NULL)
+		fprintf (stderr, ", %.2f allocs/msg",
+			 count > 0 ? (double) allocs / count : 0);
+
+	fprintf (stderr, "\n");
+}
+
+static int map (struct nl_canned *o, const char *path)
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	if ((fd = open (path, O_RDONLY | O_CLOEXEC)) == -1)
+		return 0;
+
+	if (fstat (fd, &st) != 0 ||
+	    (p = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+	    == MAP_FAILED) {
+		close (fd);
+		return 0;
+	}
+
+	close (fd);
+
+	o->data = p;
+	o->size = st.st_size;
+
+	o->recorded = o->size >= sizeof (NL_CANNED_MAGIC) - 1 &&
+		      memcmp (p, NL_CANNED_MAGIC,
+			      sizeof (NL_CANNED_MAGIC) - 1) == 0;
+
+	o->first = o->pos = o->recorded ? sizeof (NL_CANNED_MAGIC) - 1 : 0;
+	return 1;
+}
+
+struct nl_canned *nl_canned (const char *env)
+{
+	struct nl_canned *o;
+	const char *path;
+
+	for (o = streams; o < streams + 2 && o->env != NULL; ++o)
+		if (strcmp (o->env, env) == 0)
+			return o->data != NULL ? o : NULL;
+
+	if (o == streams + 2)
+		return NULL;
+
+	o->env = env;
+
+	if ((path = getenv (env)) == NULL || !map (o, path))
+		return NULL;
+
+	if ((path = getenv ("NL_CANNED_SPEED")) != NULL)
+		o->speed = strtod (path, NULL);
+
+	if (start == 0) {
+		start = now ();
+		atexit (report);
+	}
+
+	return o;
+}
+
+/*
+ * Waits for the time of record relative to the first one scaled by speed
+ */
+static void pace (struct nl_canned *o, const struct nl_canned_rec *r)
+{
+	double t;
+
+	if (o->start == 0) {
+		o->start  = now ();
+		o->origin = r->time;
+		return;
+	}
+
+	t = o->start + (r->time - o->origin) / 1e9 / o->speed - now ();
+
+	if (t > 0)
+		pause_for (t);
+}
+
+static const struct nlmsghdr *next_rec (struct nl_canned *o)
+{
+	const struct nl_canned_rec *r = (const void *) (o->data + o->pos);
+	const struct nlmsghdr *h = (const void *) (r + 1);
+	const size_t avail = o->size - o->pos;
+
+	if (avail < sizeof (*r) + NLMSG_HDRLEN || r->size > avail ||
+	    r->size < sizeof (*r) + NLMSG_HDRLEN ||
+	    !NLMSG_OK (h, (int) (r->size - sizeof (*r))))
+		return NULL;
+
+	if (o->speed > 0)
+		pace (o, r);
+
+	o->pos += r->size;
+	return h;
+}
+
+const struct nlmsghdr *nl_canned_next (struct nl_canned *o)
+{
+	const struct nlmsghdr *h = (const void *) (o->data + o->pos);
+	int len = o->size - o->pos;
+
+	if (o->recorded) {
+		if ((h = next_rec (o)) != NULL)
+			++count;
+
+		return h;
+	}
+
+	if (!NLMSG_OK (h, len))
+		return NULL;
+
+	o->pos += NLMSG_ALIGN (h->nlmsg_len);
+	++count;
+	return h;
+}
+
+void nl_canned_rewind (struct nl_canned *o)
+{
+	o->pos   = o->first;
+	o->start = 0;
+}
+
+int nl_canned_create (const char *path)
+{
+	const int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+	const size_t len = sizeof (NL_CANNED_MAGIC) - 1;
+	struct stat st;
+	int fd;
+
+	if ((fd = open (path, flags, 0644)) == -1)
+		return -1;
+
+	if (fstat (fd, &st) != 0 ||
+	    (st.st_size == 0 && write (fd, NL_CANNED_MAGIC, len) != len)) {
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int nl_canned_write (int fd, uint64_t time, uint32_t group,
+		     const struct nlmsghdr *h)
+{
+	static const char pad[8];
+	struct nl_canned_rec r = { .time = time, .group = group };
+	const size_t tail = (8 - h->nlmsg_len % 8) % 8;
+	struct iovec v[3];
+
+	r.size = sizeof (r) + h->nlmsg_len + tail;
+
+	v[0].iov_base = &r;
+	v[0].iov_len  = sizeof (r);
+	v[1].iov_base = (void *) h;
+	v[1].iov_len  = h->nlmsg_len;
+	v[2].iov_base = (void *) pad;
+	v[2].iov_len  = tail;
+
+	/* single writev to O_APPEND file keeps records whole */
+	return writev (fd, v, 3) == r.size;
+}
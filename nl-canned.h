@@ -0,0 +1,59 @@
+/*
+ * Canned NetLink Stream
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef NL_CANNED_H
+#define NL_CANNED_H  1
+
+#include <stdint.h>
+
+#include <linux/netlink.h>
+
+/*
+ * File of raw netlink messages used instead of kernel socket: if the
+ * environment variable given names such a file, messages are read from
+ * it. Returns NULL if variable is not set or file cannot be mapped. Tools
+ * look for it only when built with NL_CANNED defined, as benchmarks are.
+ *
+ * Recorded streams (see below) are replayed at maximum speed by default.
+ * NL_CANNED_SPEED environment variable sets replay speed relative to the
+ * recorded one: 1 for real time, 10 for ten times faster, 0 for maximum.
+ *
+ * Statistics (messages, ns/message and allocations/message when bench
+ * allocator is linked in) are printed to stderr at exit.
+ */
+struct nl_canned *nl_canned (const char *env);
+
+/*
+ * Returns next message or NULL at end of stream
+ */
+const struct nlmsghdr *nl_canned_next (struct nl_canned *o);
+void nl_canned_rewind (struct nl_canned *o);
+
+/*
+ * Recorded stream is a magic followed by records of 8-byte aligned size,
+ * each one holds receive time in nanoseconds since the Epoch, multicast
+ * groups of message, and message itself. File is append-only: partially
+ * written record at the end is ignored by readers.
+ */
+#define NL_CANNED_MAGIC  "NLREC\0\0\1"
+
+struct nl_canned_rec {
+	uint64_t time;
+	uint32_t group;
+	uint32_t size;		/* of the whole record	*/
+};
+
+/*
+ * Opens recording file for append and writes magic if file is empty.
+ * Returns file descriptor or -1 on error.
+ */
+int nl_canned_create (const char *path);
+int nl_canned_write (int fd, uint64_t time, uint32_t group,
+		     const struct nlmsghdr *h);
+
+#endif  /* NL_CANNED_H */
@@ -0,0 +1,480 @@
+/*
+ * Linux NetLink Core
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nl-core.h"
+
+#ifdef NL_RAW
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RECV_SIZE	65536
+#define SOCK_BUF	32768	/* libnl default */
+
+struct nl_msg {
+	struct sockaddr_nl src;
+	struct nlmsghdr *h;
+	size_t size;		/* of own buffer, zero for received one */
+};
+
+struct nl_cb {
+	nl_recvmsg_msg_cb_t fn;
+	void *arg;
+};
+
+struct nl_sock {
+	int fd;
+	struct sockaddr_nl local;
+	unsigned seq;
+	struct nl_cb valid, in;
+
+	unsigned char *buf;	/* receive buffer of RECV_SIZE bytes */
+};
+
+struct nl_sock *nl_socket_alloc (void)
+{
+	struct nl_sock *o;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	o->fd  = -1;
+	o->seq = time (NULL);
+	return o;
+}
+
+void nl_socket_free (struct nl_sock *o)
+{
+	if (o == NULL)
+		return;
+
+	nl_close (o);
+	free (o->buf);
+	free (o);
+}
+
+int nl_connect (struct nl_sock *o, int protocol)
+{
+	const int size = SOCK_BUF;
+	socklen_t len = sizeof (o->local);
+
+	if (o->fd != -1)
+		return -NLE_BAD_SOCK;
+
+	if (o->buf == NULL && (o->buf = malloc (RECV_SIZE)) == NULL)
+		return -NLE_NOMEM;
+
+	o->fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+	if (o->fd == -1)
+		return -nl_syserr2nlerr (errno);
+
+	o->local.nl_family = AF_NETLINK;
+
+	if (setsockopt (o->fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof (size)) ||
+	    setsockopt (o->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof (size)) ||
+	    bind (o->fd, (void *) &o->local, sizeof (o->local)) != 0 ||
+	    getsockname (o->fd, (void *) &o->local, &len) != 0) {
+		const int error = errno;
+
+		nl_close (o);
+		return -nl_syserr2nlerr (error);
+	}
+
+	return 0;
+}
+
+void nl_close (struct nl_sock *o)
+{
+	if (o->fd != -1)
+		close (o->fd);
+
+	o->fd = -1;
+}
+
+void nl_socket_disable_seq_check (struct nl_sock *o)
+{
+	/* sequence numbers are never checked */
+}
+
+int nl_socket_add_membership (struct nl_sock *o, int group)
+{
+	if (setsockopt (o->fd, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &group,
+			sizeof (group)) != 0)
+		return -nl_syserr2nlerr (errno);
+
+	return 0;
+}
+
+int nl_socket_set_nonblocking (const struct nl_sock *o)
+{
+	const int flags = fcntl (o->fd, F_GETFL);
+
+	if (flags == -1 || fcntl (o->fd, F_SETFL, flags | O_NONBLOCK) == -1)
+		return -nl_syserr2nlerr (errno);
+
+	return 0;
+}
+
+int nl_socket_get_fd (const struct nl_sock *o)
+{
+	return o->fd;
+}
+
+int nl_socket_modify_cb (struct nl_sock *o, enum nl_cb_type type,
+			 enum nl_cb_kind kind, nl_recvmsg_msg_cb_t fn,
+			 void *arg)
+{
+	struct nl_cb *cb = type == NL_CB_VALID  ? &o->valid :
+			   type == NL_CB_MSG_IN ? &o->in : NULL;
+
+	if (cb == NULL || kind != NL_CB_CUSTOM)
+		return -NLE_OPNOTSUPP;
+
+	cb->fn  = fn;
+	cb->arg = arg;
+	return 0;
+}
+
+static int call (struct nl_cb *cb, struct nl_msg *m)
+{
+	return cb->fn != NULL ? cb->fn (m, cb->arg) : NL_OK;
+}
+
+/*
+ * Returns number of bytes received, or negative error code
+ */
+static int recv_one (struct nl_sock *o, struct sockaddr_nl *src)
+{
+	struct iovec iov = { o->buf, RECV_SIZE };
+	struct msghdr mh = {
+		.msg_name	= src,
+		.msg_namelen	= sizeof (*src),
+		.msg_iov	= &iov,
+		.msg_iovlen	= 1,
+	};
+	ssize_t len;
+
+	while ((len = recvmsg (o->fd, &mh, MSG_TRUNC)) < 0)
+		if (errno != EINTR)
+			return -nl_syserr2nlerr (errno);
+
+	if (len > RECV_SIZE || (mh.msg_flags & MSG_TRUNC) != 0)
+		return -NLE_MSG_TRUNC;
+
+	return len;
+}
+
+/*
+ * Messages are passed to callbacks in place, in receive buffer. Returns
+ * 1 if multipart message goes on, 0 if it is done and negative error code
+ * on failure.
+ */
+static int process (struct nl_sock *o, struct nl_msg *m, int len)
+{
+	struct nlmsghdr *h;
+	struct nlmsgerr *e;
+	int multi = 0, ret;
+
+	for (h = (void *) o->buf; NLMSG_OK (h, len); h = NLMSG_NEXT (h, len)) {
+		m->h = h;
+
+		if ((ret = call (&o->in, m)) == NL_STOP)
+			return 0;
+
+		if (ret < 0)
+			return ret;
+
+		if (ret == NL_SKIP)
+			continue;
+
+		if ((h->nlmsg_flags & NLM_F_MULTI) != 0)
+			multi = 1;
+
+		switch (h->nlmsg_type) {
+		case NLMSG_DONE:
+			return 0;
+		case NLMSG_NOOP:
+			continue;
+		case NLMSG_OVERRUN:
+			return -NLE_MSG_OVERFLOW;
+		case NLMSG_ERROR:
+			e = NLMSG_DATA (h);
+
+			if (h->nlmsg_len < NLMSG_LENGTH (sizeof (*e)))
+				return -NLE_MSG_TRUNC;
+
+			if (e->error != 0)
+				return -nl_syserr2nlerr (-e->error);
+
+			continue;  /* acknowledgement */
+		}
+
+		if ((ret = call (&o->valid, m)) == NL_STOP)
+			return 0;
+
+		if (ret < 0)
+			return ret;
+	}
+
+	return multi;
+}
+
+int nl_recvmsgs_default (struct nl_sock *o)
+{
+	struct nl_msg m = {};
+	int len, ret;
+
+	do {
+		if ((len = recv_one (o, &m.src)) < 0)
+			return len;
+	}
+	while ((ret = process (o, &m, len)) > 0);
+
+	return ret;
+}
+
+static int send_msg (struct nl_sock *o, struct nlmsghdr *h)
+{
+	struct sockaddr_nl to = { .nl_family = AF_NETLINK };
+
+	h->nlmsg_pid = o->local.nl_pid;
+	h->nlmsg_seq = ++o->seq;
+
+	while (sendto (o->fd, h, h->nlmsg_len, 0, (void *) &to,
+		       sizeof (to)) < 0)
+		if (errno != EINTR)
+			return -nl_syserr2nlerr (errno);
+
+	return 0;
+}
+
+int nl_rtgen_request (struct nl_sock *o, int type, int family, int flags)
+{
+	struct {
+		struct nlmsghdr h;
+		struct rtgenmsg g;
+	} req = {};
+
+	req.h.nlmsg_len   = NLMSG_LENGTH (sizeof (req.g));
+	req.h.nlmsg_type  = type;
+	req.h.nlmsg_flags = flags;
+	req.g.rtgen_family = family;
+
+	return send_msg (o, &req.h);
+}
+
+int nl_send_auto (struct nl_sock *o, struct nl_msg *m)
+{
+	int ret;
+
+	m->h->nlmsg_flags |= NLM_F_REQUEST;
+
+	if ((ret = send_msg (o, m->h)) < 0)
+		return ret;
+
+	return m->h->nlmsg_len;
+}
+
+/*
+ * Sends request with acknowledgement asked and waits for it, other
+ * messages are skipped
+ */
+int nl_send_sync (struct nl_sock *o, struct nl_msg *m)
+{
+	struct nlmsghdr *h = m->h;
+	struct nlmsgerr *e;
+	struct sockaddr_nl src;
+	int len, ret;
+
+	h->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+
+	ret = send_msg (o, h);
+	nlmsg_free (m);
+
+	if (ret < 0)
+		return ret;
+
+	for (;;) {
+		if ((len = recv_one (o, &src)) < 0)
+			return len;
+
+		for (h = (void *) o->buf; NLMSG_OK (h, len);
+		     h = NLMSG_NEXT (h, len)) {
+			if (h->nlmsg_type != NLMSG_ERROR)
+				continue;
+
+			e = NLMSG_DATA (h);
+			return e->error != 0 ? -nl_syserr2nlerr (-e->error) : 0;
+		}
+	}
+}
+
+struct nl_msg *nlmsg_alloc_size (size_t size)
+{
+	struct nl_msg *m;
+
+	if (size < NLMSG_HDRLEN)
+		size = NLMSG_HDRLEN;
+
+	if ((m = calloc (1, sizeof (*m) + size)) == NULL)
+		return NULL;
+
+	m->h    = (void *) (m + 1);
+	m->size = size;
+
+	m->h->nlmsg_len = NLMSG_HDRLEN;
+	return m;
+}
+
+struct nl_msg *nlmsg_alloc_simple (int type, int flags)
+{
+	struct nl_msg *m;
+
+	if ((m = nlmsg_alloc_size (getpagesize ())) == NULL)
+		return NULL;
+
+	m->h->nlmsg_type  = type;
+	m->h->nlmsg_flags = flags;
+	return m;
+}
+
+void nlmsg_free (struct nl_msg *m)
+{
+	free (m);
+}
+
+struct nlmsghdr *nlmsg_hdr (struct nl_msg *m)
+{
+	return m->h;
+}
+
+size_t nlmsg_get_max_size (struct nl_msg *m)
+{
+	return m->size;
+}
+
+struct sockaddr_nl *nlmsg_get_src (struct nl_msg *m)
+{
+	return &m->src;
+}
+
+void nlmsg_set_src (struct nl_msg *m, struct sockaddr_nl *src)
+{
+	m->src = *src;
+}
+
+static void *reserve (struct nl_msg *m, size_t len)
+{
+	const size_t pos = NLMSG_ALIGN (m->h->nlmsg_len);
+	void *p = (char *) m->h + pos;
+
+	if (pos + NLMSG_ALIGN (len) > m->size)
+		return NULL;
+
+	memset (p, 0, NLMSG_ALIGN (len));
+	m->h->nlmsg_len = pos + NLMSG_ALIGN (len);
+	return p;
+}
+
+int nlmsg_append (struct nl_msg *m, void *data, size_t len, int pad)
+{
+	void *p;
+
+	if ((p = reserve (m, len)) == NULL)
+		return -NLE_NOMEM;
+
+	memcpy (p, data, len);
+	return 0;
+}
+
+int nla_put (struct nl_msg *m, int type, int len, const void *data)
+{
+	struct nlattr *a;
+
+	if ((a = reserve (m, NLA_HDRLEN + len)) == NULL)
+		return -NLE_NOMEM;
+
+	a->nla_type = type;
+	a->nla_len  = NLA_HDRLEN + len;
+	memcpy ((char *) a + NLA_HDRLEN, data, len);
+	return 0;
+}
+
+int nla_put_u32 (struct nl_msg *m, int type, uint32_t value)
+{
+	return nla_put (m, type, sizeof (value), &value);
+}
+
+int nl_syserr2nlerr (int error)
+{
+	switch (error < 0 ? -error : error) {
+	case EBADF:		return NLE_BAD_SOCK;
+	case EADDRINUSE:	return NLE_EXIST;
+	case EEXIST:		return NLE_EXIST;
+	case EADDRNOTAVAIL:	return NLE_NOADDR;
+	case ESRCH:		return NLE_OBJ_NOTFOUND;
+	case ENOENT:		return NLE_OBJ_NOTFOUND;
+	case EINTR:		return NLE_INTR;
+	case EAGAIN:		return NLE_AGAIN;
+	case ENOTSOCK:		return NLE_BAD_SOCK;
+	case ENOPROTOOPT:	return NLE_INVAL;
+	case EFAULT:		return NLE_INVAL;
+	case EACCES:		return NLE_NOACCESS;
+	case EINVAL:		return NLE_INVAL;
+	case ENOBUFS:		return NLE_NOMEM;
+	case ENOMEM:		return NLE_NOMEM;
+	case EAFNOSUPPORT:	return NLE_AF_NOSUPPORT;
+	case EPROTONOSUPPORT:	return NLE_PROTO_MISMATCH;
+	case EOPNOTSUPP:	return NLE_OPNOTSUPP;
+	case EPERM:		return NLE_PERM;
+	case EBUSY:		return NLE_BUSY;
+	case ERANGE:		return NLE_RANGE;
+	case ENODEV:		return NLE_NODEV;
+	default:		return NLE_FAILURE;
+	}
+}
+
+const char *nl_geterror (int error)
+{
+	static const char *s[] = {
+		"Success", "Unspecific failure", "Interrupted system call",
+		"Bad socket", "Try again", "Out of memory", "Object exists",
+		"Invalid input data or parameter", "Input data out of range",
+		"Message size not sufficient", "Operation not supported",
+		"Address family not supported", "Object not found",
+		"Attribute not available", "Missing attribute",
+		"Address family mismatch", "Message sequence number mismatch",
+		"Kernel reported message overflow", "Kernel reported truncated "
+		"message", "Invalid address for specified address family",
+		"Source based routing not supported", "Netlink message is too "
+		"short", "Netlink message type is not supported",
+		"Object type does not match cache", "Unknown or invalid cache "
+		"type", "Object busy", "Protocol mismatch",
+		"No Access", "Operation not permitted",
+		"Unable to open packet location file",
+		"Unable to parse object", "No such device",
+		"Immutable attribute", "Dump inconsistency detected, "
+		"interrupted", "Attribute max length exceeded",
+	};
+
+	error = error < 0 ? -error : error;
+
+	if (error >= sizeof (s) / sizeof (s[0]))
+		return "Unknown error";
+
+	return s[error];
+}
+
+void nl_perror (int error, const char *s)
+{
+	fprintf (stderr, "%s: %s\n", s, nl_geterror (error));
+}
+
+#endif  /* NL_RAW */
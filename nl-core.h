@@ -0,0 +1,104 @@
+/*
+ * Linux NetLink Core
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef NL_CORE_H
+#define NL_CORE_H  1
+
+#ifndef NL_RAW
+
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <netlink/route/rtnl.h>
+
+#else  /* NL_RAW */
+
+/*
+ * Built-in replacement for the part of libnl used by tools, for small
+ * embedded builds: blocking or non-blocking socket without sequence
+ * checks, receive with valid message and message-in callbacks, route
+ * dump requests and requests with attributes, synchronous or not. Names
+ * and semantics follow libnl.
+ */
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+enum {
+	NLE_SUCCESS, NLE_FAILURE, NLE_INTR, NLE_BAD_SOCK, NLE_AGAIN,
+	NLE_NOMEM, NLE_EXIST, NLE_INVAL, NLE_RANGE, NLE_MSGSIZE,
+	NLE_OPNOTSUPP, NLE_AF_NOSUPPORT, NLE_OBJ_NOTFOUND, NLE_NOATTR,
+	NLE_MISSING_ATTR, NLE_AF_MISMATCH, NLE_SEQ_MISMATCH,
+	NLE_MSG_OVERFLOW, NLE_MSG_TRUNC, NLE_NOADDR, NLE_SRCRT_NOSUPPORT,
+	NLE_MSG_TOOSHORT, NLE_MSGTYPE_NOSUPPORT, NLE_OBJ_MISMATCH,
+	NLE_NOCACHE, NLE_BUSY, NLE_PROTO_MISMATCH, NLE_NOACCESS, NLE_PERM,
+	NLE_PKTLOC_FILE, NLE_PARSE_ERR, NLE_NODEV, NLE_IMMUTABLE,
+	NLE_DUMP_INTR, NLE_ATTRSIZE,
+};
+
+enum nl_cb_action { NL_OK, NL_SKIP, NL_STOP };
+enum nl_cb_kind   { NL_CB_DEFAULT, NL_CB_VERBOSE, NL_CB_DEBUG, NL_CB_CUSTOM };
+
+enum nl_cb_type {
+	NL_CB_VALID, NL_CB_FINISH, NL_CB_OVERRUN, NL_CB_SKIPPED, NL_CB_ACK,
+	NL_CB_MSG_IN, NL_CB_MSG_OUT, NL_CB_INVALID, NL_CB_SEQ_CHECK,
+	NL_CB_SEND_ACK, NL_CB_DUMP_INTR,
+};
+
+struct nl_msg;
+struct nl_sock;
+
+typedef int (*nl_recvmsg_msg_cb_t) (struct nl_msg *m, void *arg);
+
+struct nl_sock *nl_socket_alloc (void);
+void nl_socket_free (struct nl_sock *o);
+
+int  nl_connect (struct nl_sock *o, int protocol);
+void nl_close   (struct nl_sock *o);
+
+void nl_socket_disable_seq_check (struct nl_sock *o);
+int  nl_socket_add_membership (struct nl_sock *o, int group);
+int  nl_socket_set_nonblocking (const struct nl_sock *o);
+int  nl_socket_get_fd (const struct nl_sock *o);
+int  nl_socket_modify_cb (struct nl_sock *o, enum nl_cb_type type,
+			  enum nl_cb_kind kind, nl_recvmsg_msg_cb_t cb,
+			  void *arg);
+
+int nl_recvmsgs_default (struct nl_sock *o);
+int nl_rtgen_request (struct nl_sock *o, int type, int family, int flags);
+int nl_send_auto (struct nl_sock *o, struct nl_msg *m);
+int nl_send_sync (struct nl_sock *o, struct nl_msg *m);
+
+struct nl_msg *nlmsg_alloc_size (size_t size);
+struct nl_msg *nlmsg_alloc_simple (int type, int flags);
+void nlmsg_free (struct nl_msg *m);
+
+struct nlmsghdr *nlmsg_hdr (struct nl_msg *m);
+size_t nlmsg_get_max_size (struct nl_msg *m);
+struct sockaddr_nl *nlmsg_get_src (struct nl_msg *m);
+void nlmsg_set_src (struct nl_msg *m, struct sockaddr_nl *src);
+
+int nlmsg_append (struct nl_msg *m, void *data, size_t len, int pad);
+int nla_put (struct nl_msg *m, int type, int len, const void *data);
+int nla_put_u32 (struct nl_msg *m, int type, uint32_t value);
+
+int nl_syserr2nlerr (int error);
+const char *nl_geterror (int error);
+void nl_perror (int error, const char *s);
+
+#endif  /* NL_RAW */
+
+#endif  /* NL_CORE_H */
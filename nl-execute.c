@@ -6,9 +6,93 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-#include <netlink/route/rtnl.h>
+#include <string.h>
 
+#include "nl-core.h"
 #include "nl-monitor.h"
+#include "usdt.h"
+
+#ifdef NL_CANNED
+#include "nl-canned.h"
+#endif
+
+static int probe_in (struct nl_msg *m, void *arg)
+{
+	USDT_PROBE2 (nl, recv, nlmsg_hdr (m)->nlmsg_type,
+			       nlmsg_hdr (m)->nlmsg_len);
+	return NL_OK;
+}
+
+static int probe_cb (struct nl_msg *m, void *arg)
+{
+	nl_recvmsg_msg_cb_t *cb = arg;
+	int ret;
+
+	USDT_PROBE1 (nl, cb_entry, nlmsg_hdr (m)->nlmsg_type);
+	ret = (*cb) (m, NULL);
+	USDT_PROBE2 (nl, cb_exit, nlmsg_hdr (m)->nlmsg_type, ret);
+	return ret;
+}
+
+int nl_socket_probe_cb (struct nl_sock *h, nl_recvmsg_msg_cb_t *cb)
+{
+	int ret;
+
+	ret = nl_socket_modify_cb (h, NL_CB_MSG_IN, NL_CB_CUSTOM, probe_in,
+				   NULL);
+	if (ret < 0)
+		return ret;
+
+	return nl_socket_modify_cb (h, NL_CB_VALID, NL_CB_CUSTOM, probe_cb, cb);
+}
+
+/*
+ * Feeds message to callback through reusable message buffer, grown as
+ * needed
+ */
+int nl_feed (struct nl_msg **m, const struct nlmsghdr *h,
+	     struct sockaddr_nl *src, nl_recvmsg_msg_cb_t cb)
+{
+	const size_t size = h->nlmsg_len > 16384 ? h->nlmsg_len : 16384;
+
+	if (*m == NULL || h->nlmsg_len > nlmsg_get_max_size (*m)) {
+		nlmsg_free (*m);
+
+		if ((*m = nlmsg_alloc_size (size)) == NULL)
+			return -NLE_NOMEM;
+	}
+
+	memcpy (nlmsg_hdr (*m), h, h->nlmsg_len);
+
+	if (src != NULL)
+		nlmsg_set_src (*m, src);
+
+	probe_in (*m, NULL);
+	return probe_cb (*m, &cb);
+}
+
+#ifdef NL_CANNED
+int nl_replay (struct nl_canned *o, nl_recvmsg_msg_cb_t cb, int dump)
+{
+	const struct nlmsghdr *h;
+	struct nl_msg *m = NULL;
+	int ret = 0;
+
+	while ((h = nl_canned_next (o)) != NULL) {
+		if (h->nlmsg_type == NLMSG_DONE && dump)
+			break;
+
+		if (h->nlmsg_type < NLMSG_MIN_TYPE)
+			continue;
+
+		if ((ret = nl_feed (&m, h, NULL, cb)) < 0 || ret == NL_STOP)
+			break;
+	}
+
+	nlmsg_free (m);
+	return ret < 0 ? ret : 0;
+}
+#endif
 
 /*
  * Function takes message callback, network family, netlink type and
@@ -16,17 +100,24 @@
  */
 int nl_execute_ex (nl_recvmsg_msg_cb_t cb, int family, int type, int cmd)
 {
+#ifdef NL_CANNED
+	struct nl_canned *canned;
+#endif
 	struct nl_sock *h;
 	int ret;
 
+#ifdef NL_CANNED
+	if ((canned = nl_canned ("NL_CANNED")) != NULL)
+		return nl_replay (canned, cb, 1);
+#endif
+
 	if ((h = nl_socket_alloc ()) == NULL)
 		return -1;
 
 	/* notifications do not use sequence numbers */
 	nl_socket_disable_seq_check (h);
 
-	ret = nl_socket_modify_cb (h, NL_CB_VALID, NL_CB_CUSTOM, cb, NULL);
-	if (ret < 0)
+	if ((ret = nl_socket_probe_cb (h, &cb)) < 0)
 		return ret;
 
 	if ((ret = nl_connect (h, type)) < 0)
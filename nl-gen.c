@@ -0,0 +1,358 @@
+/*
+ * Synthetic NetLink Stream Generator
+ *
+ * Writes canned streams of raw netlink messages for benchmarks, see
+ * nl-canned.h. Dumps are terminated with NLMSG_DONE, so streams for tools
+ * doing several dumps are built by concatenation.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+
+#include <linux/if.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <linux/rtnetlink.h>
+
+static union {
+	struct nlmsghdr h;
+	unsigned char data[4096];
+} msg;
+
+static void *msg_init (int type, int flags, size_t size)
+{
+	memset (&msg, 0, NLMSG_SPACE (size));
+
+	msg.h.nlmsg_len   = NLMSG_LENGTH (size);
+	msg.h.nlmsg_type  = type;
+	msg.h.nlmsg_flags = flags;
+	return NLMSG_DATA (&msg.h);
+}
+
+static struct rtattr *attr_put (int type, const void *data, size_t size)
+{
+	struct rtattr *a = (void *) (msg.data + NLMSG_ALIGN (msg.h.nlmsg_len));
+
+	a->rta_type = type;
+	a->rta_len  = RTA_LENGTH (size);
+
+	if (size > 0)
+		memcpy (RTA_DATA (a), data, size);
+
+	msg.h.nlmsg_len = NLMSG_ALIGN (msg.h.nlmsg_len) + RTA_ALIGN (a->rta_len);
+	return a;
+}
+
+static void attr_u8 (int type, uint8_t v)
+{
+	attr_put (type, &v, sizeof (v));
+}
+
+static void attr_u32 (int type, uint32_t v)
+{
+	attr_put (type, &v, sizeof (v));
+}
+
+static struct rtattr *nest_start (int type)
+{
+	return attr_put (type | NLA_F_NESTED, NULL, 0);
+}
+
+static void nest_end (struct rtattr *a)
+{
+	a->rta_len = msg.data + msg.h.nlmsg_len - (unsigned char *) a;
+}
+
+static int msg_emit (void)
+{
+	return fwrite (&msg, NLMSG_ALIGN (msg.h.nlmsg_len), 1, stdout) == 1;
+}
+
+static int done_emit (void)
+{
+	msg_init (NLMSG_DONE, NLM_F_MULTI, sizeof (int));
+	return msg_emit ();
+}
+
+/*
+ * Prefix of route i: /24 networks starting from 1.0.0.0 for IPv4, /64
+ * networks from 2001:db8:: for IPv6
+ */
+static void route_prefix (int family, unsigned long i, void *prefix)
+{
+	uint32_t v4 = htonl (0x01000000 + (i << 8));
+	struct in6_addr v6 = {{{ 0x20, 0x01, 0x0d, 0xb8 }}};
+
+	if (family == AF_INET) {
+		memcpy (prefix, &v4, sizeof (v4));
+		return;
+	}
+
+	v6.s6_addr[4] = i >> 24;
+	v6.s6_addr[5] = i >> 16;
+	v6.s6_addr[6] = i >> 8;
+	v6.s6_addr[7] = i;
+	memcpy (prefix, &v6, sizeof (v6));
+}
+
+static struct rtmsg *route_init (int type, int family, unsigned long i)
+{
+	static const unsigned char gw4[4]  = { 10, 255, 255, 1 };
+	static const unsigned char gw6[16] = { 0xfe, 0x80, [15] = 1 };
+	const size_t size = family == AF_INET ? 4 : 16;
+	unsigned char prefix[16];
+	struct rtmsg *rtm;
+
+	rtm = msg_init (type, type == RTM_NEWROUTE ? NLM_F_MULTI : 0,
+			sizeof (*rtm));
+
+	rtm->rtm_family   = family;
+	rtm->rtm_dst_len  = family == AF_INET ? 24 : 64;
+	rtm->rtm_table    = RT_TABLE_MAIN;
+	rtm->rtm_protocol = RTPROT_STATIC;
+	rtm->rtm_scope    = RT_SCOPE_UNIVERSE;
+	rtm->rtm_type     = RTN_UNICAST;
+
+	route_prefix (family, i, prefix);
+
+	attr_u32 (RTA_TABLE, RT_TABLE_MAIN);
+	attr_put (RTA_DST, prefix, size);
+	attr_put (RTA_GATEWAY, family == AF_INET ? gw4 : gw6, size);
+	attr_u32 (RTA_OIF, 1 + i % 4);
+	attr_u32 (RTA_PRIORITY, 100 + i % 8);
+	return rtm;
+}
+
+static int route_emit (int type, int family, unsigned long i)
+{
+	route_init (type, family, i);
+	return msg_emit ();
+}
+
+/*
+ * IPv6 route i with every attribute kernel may add: source prefix, input
+ * interface, metrics, multipath, cache info, preference and expiry
+ */
+static int route_full_emit (unsigned long i)
+{
+	static const unsigned char gw6[16] = { 0xfe, 0x80, [15] = 2 };
+	struct in6_addr src = {{{ 0x20, 0x01, 0x0d, 0xb8, 0xff, 0xff }}};
+	struct rta_cacheinfo ci = {};
+	unsigned char nh[RTNH_LENGTH (RTA_LENGTH (16))] = {};
+	struct rtnexthop *rtnh = (void *) nh;
+	struct rtattr *a = RTNH_DATA (rtnh);
+	struct rtmsg *rtm;
+
+	rtm = route_init (RTM_NEWROUTE, AF_INET6, i);
+	rtm->rtm_src_len = 48;
+
+	rtnh->rtnh_len     = sizeof (nh);
+	rtnh->rtnh_ifindex = 2;
+	a->rta_type = RTA_GATEWAY;
+	a->rta_len  = RTA_LENGTH (sizeof (gw6));
+	memcpy (RTA_DATA (a), gw6, sizeof (gw6));
+
+	attr_put (RTA_SRC, &src, sizeof (src));
+	attr_u32 (RTA_IIF, 1);
+	a = nest_start (RTA_METRICS);
+	attr_u32 (RTAX_MTU, 1280);
+	nest_end (a);
+	attr_put (RTA_MULTIPATH, nh, sizeof (nh));
+	attr_put (RTA_CACHEINFO, &ci, sizeof (ci));
+	attr_u8  (RTA_PREF, 0);
+	attr_u32 (RTA_EXPIRES, 1800);
+	return msg_emit ();
+}
+
+static int link_emit (unsigned long i)
+{
+	unsigned char mac[6] = { 0x02, 0, i >> 24, i >> 16, i >> 8, i };
+	char name[IFNAMSIZ];
+	struct ifinfomsg *ifi;
+
+	ifi = msg_init (RTM_NEWLINK, NLM_F_MULTI, sizeof (*ifi));
+
+	ifi->ifi_family = AF_UNSPEC;
+	ifi->ifi_type   = ARPHRD_ETHER;
+	ifi->ifi_index  = 1 + i;
+	ifi->ifi_flags  = IFF_UP | IFF_BROADCAST | IFF_RUNNING | IFF_LOWER_UP;
+
+	snprintf (name, sizeof (name), "nlgen%lu", i % 1000000);
+
+	attr_put (IFLA_IFNAME, name, strlen (name) + 1);
+	attr_u32 (IFLA_MTU, 1500);
+	attr_put (IFLA_ADDRESS, mac, sizeof (mac));
+	attr_u8  (IFLA_OPERSTATE, IF_OPER_UP);
+	return msg_emit ();
+}
+
+static int addr_emit (unsigned long i)
+{
+	uint32_t a = htonl (0x0a000001 + (i << 8));
+	struct ifaddrmsg *ifa;
+	char label[IFNAMSIZ];
+
+	ifa = msg_init (RTM_NEWADDR, NLM_F_MULTI, sizeof (*ifa));
+
+	ifa->ifa_family    = AF_INET;
+	ifa->ifa_prefixlen = 24;
+	ifa->ifa_scope     = RT_SCOPE_UNIVERSE;
+	ifa->ifa_index     = 1 + i;
+
+	snprintf (label, sizeof (label), "nlgen%lu", i % 1000000);
+
+	attr_put (IFA_ADDRESS, &a, sizeof (a));
+	attr_put (IFA_LOCAL, &a, sizeof (a));
+	attr_put (IFA_LABEL, label, strlen (label) + 1);
+	return msg_emit ();
+}
+
+static void ct_tuple (int type, int family, const void *src, const void *dst,
+		      uint16_t sport, uint16_t dport)
+{
+	const size_t size = family == AF_INET ? 4 : 16;
+	struct rtattr *t, *n;
+
+	t = nest_start (type);
+
+	n = nest_start (CTA_TUPLE_IP);
+	attr_put (family == AF_INET ? CTA_IP_V4_SRC : CTA_IP_V6_SRC, src, size);
+	attr_put (family == AF_INET ? CTA_IP_V4_DST : CTA_IP_V6_DST, dst, size);
+	nest_end (n);
+
+	n = nest_start (CTA_TUPLE_PROTO);
+	attr_u8  (CTA_PROTO_NUM, IPPROTO_TCP);
+	attr_put (CTA_PROTO_SRC_PORT, &sport, sizeof (sport));
+	attr_put (CTA_PROTO_DST_PORT, &dport, sizeof (dport));
+	nest_end (n);
+
+	nest_end (t);
+}
+
+/*
+ * Entry i: TCP from 10.0.0.0/8 (fd00::/64) client to one of 64K servers
+ * in 198.18.0.0/16 (2001:db8:ffff::/112)
+ */
+static int ct_emit (int family, unsigned long i)
+{
+	uint32_t src4 = htonl (0x0a000000 + i);
+	uint32_t dst4 = htonl (0xc6120000 + i % 65536);
+	struct in6_addr src6 = {{{ 0xfd }}};
+	struct in6_addr dst6 = {{{ 0x20, 0x01, 0x0d, 0xb8, 0xff, 0xff }}};
+	const void *src = family == AF_INET ? (void *) &src4 : &src6;
+	const void *dst = family == AF_INET ? (void *) &dst4 : &dst6;
+	const uint16_t sport = htons (1024 + i % 60000), dport = htons (443);
+	struct nfgenmsg *nfg;
+	struct rtattr *n, *tcp;
+
+	src6.s6_addr32[3] = src4;
+	dst6.s6_addr[14]  = i >> 8;
+	dst6.s6_addr[15]  = i;
+
+	nfg = msg_init ((NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_NEW,
+			NLM_F_MULTI, sizeof (*nfg));
+
+	nfg->nfgen_family = family;
+	nfg->version      = NFNETLINK_V0;
+
+	ct_tuple (CTA_TUPLE_ORIG,  family, src, dst, sport, dport);
+	ct_tuple (CTA_TUPLE_REPLY, family, dst, src, dport, sport);
+
+	attr_u32 (CTA_STATUS,  htonl (0x18e));	/* replied, assured, confirmed */
+	attr_u32 (CTA_TIMEOUT, htonl (432000));
+	attr_u32 (CTA_MARK,    htonl (0));
+	attr_u32 (CTA_ID,      htonl (i));
+
+	n = nest_start (CTA_PROTOINFO);
+	tcp = nest_start (CTA_PROTOINFO_TCP);
+	attr_u8 (CTA_PROTOINFO_TCP_STATE, 3);	/* established */
+	nest_end (tcp);
+	nest_end (n);
+
+	return msg_emit ();
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n"
+			 "\tnl-gen routes <count> [deletes]\n"
+			 "\tnl-gen routes6 <count> [deletes]\n"
+			 "\tnl-gen routes6-full <count>\n"
+			 "\tnl-gen links <count>\n"
+			 "\tnl-gen addrs <count>\n"
+			 "\tnl-gen conntrack <count>\n"
+			 "\tnl-gen conntrack6 <count>\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	unsigned long count, deletes, i;
+	const char *kind;
+	int ok = 1;
+
+	if (argc < 3)
+		return usage ();
+
+	kind    = argv[1];
+	count   = strtoul (argv[2], NULL, 0);
+	deletes = argc > 3 ? strtoul (argv[3], NULL, 0) : 0;
+
+	if (strcmp (kind, "routes") == 0 || strcmp (kind, "routes6") == 0) {
+		const int family = kind[6] == '6' ? AF_INET6 : AF_INET;
+
+		for (i = 0; ok && i < count; ++i)
+			ok = route_emit (RTM_NEWROUTE, family, i);
+
+		ok = ok && done_emit ();
+
+		for (i = 0; ok && i < deletes && i < count; ++i)
+			ok = route_emit (RTM_DELROUTE, family, i);
+	}
+	else if (strcmp (kind, "routes6-full") == 0) {
+		for (i = 0; ok && i < count; ++i)
+			ok = route_full_emit (i);
+
+		ok = ok && done_emit ();
+	}
+	else if (strcmp (kind, "links") == 0) {
+		for (i = 0; ok && i < count; ++i)
+			ok = link_emit (i);
+
+		ok = ok && done_emit ();
+	}
+	else if (strcmp (kind, "addrs") == 0) {
+		for (i = 0; ok && i < count; ++i)
+			ok = addr_emit (i);
+
+		ok = ok && done_emit ();
+	}
+	else if (strcmp (kind, "conntrack") == 0 ||
+		 strcmp (kind, "conntrack6") == 0) {
+		const int family = kind[9] == '6' ? AF_INET6 : AF_INET;
+
+		for (i = 0; ok && i < count; ++i)
+			ok = ct_emit (family, i);
+
+		ok = ok && done_emit ();
+	}
+	else
+		return usage ();
+
+	if (!ok || fflush (stdout) != 0) {
+		perror ("nl-gen");
+		return 1;
+	}
+
+	return 0;
+}
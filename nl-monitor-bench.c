@@ -0,0 +1,283 @@
+/*
+ * NetLink Monitor Backend Benchmark
+ *
+ * Runs in a private network namespace: starts monitor of IPv4 routes with
+ * each receive backend in turn, adds and deletes routes via loopback in
+ * batches and reports CPU time and wakeups of monitor per event.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <linux/rtnetlink.h>
+
+#include "nl-monitor.h"
+
+static unsigned routes = 10000, batch = 64, timeout = 10;
+
+struct shared {
+	int ready;
+	unsigned long events, overruns;
+};
+
+static struct shared *shared;
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void pause_for (double t)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = t;
+	ts.tv_nsec = (t - ts.tv_sec) * 1e9;
+
+	while (nanosleep (&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+struct route_req {
+	struct nlmsghdr h;
+	struct rtmsg rtm;
+	struct rtattr dst_rta;
+	uint32_t dst;
+	struct rtattr oif_rta;
+	uint32_t oif;
+};
+
+static void route_req (struct route_req *o, int type, int oif, unsigned i)
+{
+	memset (o, 0, sizeof (*o));
+
+	o->h.nlmsg_len   = sizeof (*o);
+	o->h.nlmsg_type  = type;
+	o->h.nlmsg_flags = NLM_F_REQUEST |
+			   (type == RTM_NEWROUTE ? NLM_F_CREATE | NLM_F_EXCL : 0);
+
+	o->rtm.rtm_family   = AF_INET;
+	o->rtm.rtm_dst_len  = 24;
+	o->rtm.rtm_table    = RT_TABLE_MAIN;
+	o->rtm.rtm_protocol = RTPROT_STATIC;
+	o->rtm.rtm_scope    = RT_SCOPE_LINK;
+	o->rtm.rtm_type     = RTN_UNICAST;
+
+	o->dst_rta.rta_len  = RTA_LENGTH (sizeof (o->dst));
+	o->dst_rta.rta_type = RTA_DST;
+	o->dst              = htonl (0x01000000 + (i << 8));
+	o->oif_rta.rta_len  = RTA_LENGTH (sizeof (o->oif));
+	o->oif_rta.rta_type = RTA_OIF;
+	o->oif              = oif;
+}
+
+/*
+ * Sends route requests in batches, many messages per datagram, without
+ * acknowledgements
+ */
+static int route_change (int s, int type, int oif)
+{
+	struct route_req req[batch];
+	unsigned i, k;
+
+	for (i = 0; i < routes; i += k) {
+		for (k = 0; k < batch && i + k < routes; ++k)
+			route_req (req + k, type, oif, i + k);
+
+		if (send (s, req, k * sizeof (req[0]), 0) == -1)
+			return 0;
+	}
+
+	return 1;
+}
+
+static int link_up (int s, int index)
+{
+	struct {
+		struct nlmsghdr h;
+		struct ifinfomsg ifi;
+	} req = {
+		.h = {
+			.nlmsg_len   = sizeof (req),
+			.nlmsg_type  = RTM_NEWLINK,
+			.nlmsg_flags = NLM_F_REQUEST,
+		},
+		.ifi = {
+			.ifi_family = AF_UNSPEC,
+			.ifi_index  = index,
+			.ifi_flags  = IFF_UP,
+			.ifi_change = IFF_UP,
+		},
+	};
+
+	return send (s, &req, sizeof (req), 0) != -1;
+}
+
+static int cb (struct nl_msg *m, void *ctx)
+{
+	__atomic_store_n (&shared->overruns, nl_monitor_overruns,
+			  __ATOMIC_RELAXED);
+	__atomic_store_n (&shared->events, shared->events + 1,
+			  __ATOMIC_RELEASE);
+	return NL_OK;
+}
+
+/*
+ * Events lost are counted, not recovered: there is nothing to resync
+ */
+static int resync (void *cookie)
+{
+	__atomic_store_n (&shared->overruns, nl_monitor_overruns,
+			  __ATOMIC_RELAXED);
+	return 0;
+}
+
+static pid_t start (const char *backend)
+{
+	static const int groups[] = { RTNLGRP_IPV4_ROUTE, 0 };
+	pid_t pid;
+
+	if ((pid = fork ()) != 0)
+		return pid;
+
+	if (strcmp (backend, "classic") == 0)
+		setenv ("NL_URING", "0", 1);
+
+	__atomic_store_n (&shared->ready, 1, __ATOMIC_RELEASE);
+	nl_monitor_sync (cb, NETLINK_ROUTE, groups, resync, NULL);
+	_exit (1);
+}
+
+static int run (const char *backend, int s, int oif)
+{
+	const unsigned long expect = routes * 2ul;
+	unsigned long events;
+	struct rusage ru;
+	double t0, t, cpu;
+	pid_t pid;
+
+	memset (shared, 0, sizeof (*shared));
+
+	if ((pid = start (backend)) == -1) {
+		perror ("nl-monitor-bench: fork");
+		return 0;
+	}
+
+	while (!__atomic_load_n (&shared->ready, __ATOMIC_ACQUIRE))
+		pause_for (1e-3);
+
+	pause_for (0.1);  /* let it subscribe */
+
+	t0 = now ();
+
+	if (!route_change (s, RTM_NEWROUTE, oif) ||
+	    !route_change (s, RTM_DELROUTE, oif)) {
+		perror ("nl-monitor-bench: route");
+		kill (pid, SIGKILL);
+		waitpid (pid, NULL, 0);
+		return 0;
+	}
+
+	while ((events = __atomic_load_n (&shared->events, __ATOMIC_ACQUIRE))
+	       < expect && now () - t0 < timeout)
+		pause_for (50e-6);
+
+	t = now () - t0;
+
+	kill (pid, SIGKILL);
+	wait4 (pid, NULL, 0, &ru);
+
+	cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	      ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+	printf ("%-8s %lu events in %.3fs, %lu lost, %lu overruns\n", backend,
+		events, t, expect - events, shared->overruns);
+	printf ("%-8s cpu %.3fs (%.0f ns/event), %ld wakeups "
+		"(%.1f events/wakeup)\n", "",
+		cpu, events > 0 ? cpu * 1e9 / events : 0, ru.ru_nvcsw,
+		ru.ru_nvcsw > 0 ? (double) events / ru.ru_nvcsw : 0);
+	return 1;
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n\tnl-monitor-bench [-n routes] [-b batch] "
+			 "[-t timeout] [backend]...\n"
+			 "\nBackends are classic and uring, both by default\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	static char *backends[] = { "classic", "uring" };
+	char **list = backends;
+	int c, n = 2, s, oif, i, ok = 1;
+
+	while ((c = getopt (argc, argv, "n:b:t:")) != -1)
+		switch (c) {
+		case 'n':  routes  = strtoul (optarg, NULL, 0); break;
+		case 'b':  batch   = strtoul (optarg, NULL, 0); break;
+		case 't':  timeout = strtoul (optarg, NULL, 0); break;
+		default:
+			return usage ();
+		}
+
+	if (routes == 0 || routes > 1 << 24 || batch == 0 || batch > 1024)
+		return usage ();
+
+	if (optind < argc) {
+		list = argv + optind;
+		n    = argc - optind;
+	}
+
+	for (i = 0; i < n; ++i)
+		if (strcmp (list[i], "classic") != 0 &&
+		    strcmp (list[i], "uring") != 0)
+			return usage ();
+
+	shared = mmap (NULL, sizeof (*shared), PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		perror ("nl-monitor-bench");
+		return 1;
+	}
+
+	if (unshare (CLONE_NEWNET) != 0) {
+		perror ("nl-monitor-bench: cannot create network namespace");
+		return 1;
+	}
+
+	if ((s = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC,
+			 NETLINK_ROUTE)) == -1 ||
+	    (oif = if_nametoindex ("lo")) == 0 || !link_up (s, oif)) {
+		perror ("nl-monitor-bench: cannot bring loopback up");
+		return 1;
+	}
+
+	for (i = 0; i < n; ++i)
+		ok &= run (list[i], s, oif);
+
+	close (s);
+	return !ok;
+}
@@ -7,44 +7,109 @@
  */
 
 #include <stdarg.h>
-#include <netlink/route/rtnl.h>
 
+#include "nl-core.h"
 #include "nl-monitor.h"
+#include "nl-uring.h"
+
+#ifdef NL_CANNED
+#include "nl-canned.h"
+#endif
+
+unsigned long nl_monitor_overruns;
 
 /*
- * Function takes message callback, netlink type and zero-terminated list
- * of netlink groups
+ * Receives until error, overrun ends it unless there is sync function
  */
-int nl_monitor (nl_recvmsg_msg_cb_t cb, int type, ...)
+static int monitor (struct nl_sock *h, nl_recvmsg_msg_cb_t cb,
+		    nl_sync_t *sync, void *cookie)
 {
+	int ret;
+
+	for (;;) {
+		if ((ret = nl_uring_recv (h, cb)) == -NLE_OPNOTSUPP)
+			while ((ret = nl_recvmsgs_default (h)) >= 0) {}
+
+		if (ret != -NLE_NOMEM)
+			return ret;
+
+		__atomic_fetch_add (&nl_monitor_overruns, 1, __ATOMIC_RELAXED);
+
+		if (sync == NULL || (ret = sync (cookie)) < 0)
+			return ret;
+	}
+}
+
+int nl_monitor_sync (nl_recvmsg_msg_cb_t cb, int type, const int *groups,
+		     nl_sync_t *sync, void *cookie)
+{
+#ifdef NL_CANNED
+	struct nl_canned *canned;
+#endif
 	struct nl_sock *h;
-	va_list ap;
-	int group;
 	int ret;
 
+#ifdef NL_CANNED
+	if ((canned = nl_canned ("NL_CANNED")) != NULL) {
+		if (sync != NULL && (ret = sync (cookie)) < 0)
+			return ret;
+
+		return nl_replay (canned, cb, 0);
+	}
+#endif
+
 	if ((h = nl_socket_alloc ()) == NULL)
 		return -1;
 
 	/* notifications do not use sequence numbers */
 	nl_socket_disable_seq_check (h);
 
-	ret = nl_socket_modify_cb (h, NL_CB_VALID, NL_CB_CUSTOM, cb, NULL);
-	if (ret < 0)
+	if ((ret = nl_socket_probe_cb (h, &cb)) < 0)
 		return ret;
 
 	if ((ret = nl_connect (h, type)) < 0)
 		return ret;
 
-	va_start (ap, type);
-
-	while ((group = va_arg (ap, int)) != 0)
-		nl_socket_add_membership (h, group);
+	for (; *groups != 0; ++groups)
+		nl_socket_add_membership (h, *groups);
 
-	va_end (ap);
-
-	while ((ret = nl_recvmsgs_default (h)) >= 0) {}
+	/* changes made while syncing are queued on socket */
+	if (sync == NULL || (ret = sync (cookie)) >= 0)
+		ret = monitor (h, cb, sync, cookie);
 
 	nl_close (h);
 	nl_socket_free (h);
 	return ret;
 }
+
+/*
+ * Function takes message callback, netlink type and zero-terminated array
+ * of netlink groups
+ */
+int nl_monitor_ex (nl_recvmsg_msg_cb_t cb, int type, const int *groups)
+{
+	return nl_monitor_sync (cb, type, groups, NULL, NULL);
+}
+
+#define GROUPS_MAX  32
+
+/*
+ * Function takes message callback, netlink type and zero-terminated list
+ * of netlink groups
+ */
+int nl_monitor (nl_recvmsg_msg_cb_t cb, int type, ...)
+{
+	int groups[GROUPS_MAX + 1], i;
+	va_list ap;
+
+	va_start (ap, type);
+
+	for (i = 0; i < GROUPS_MAX; ++i)
+		if ((groups[i] = va_arg (ap, int)) == 0)
+			break;
+
+	va_end (ap);
+
+	groups[i] = 0;
+	return nl_monitor_ex (cb, type, groups);
+}
@@ -9,7 +9,7 @@
 #ifndef _NL_MONITOR_H
 #define _NL_MONITOR_H  1
 
-#include <netlink/netlink.h>
+#include "nl-core.h"
 
 /*
  * Function takes message callback, netlink type and zero-terminated list
@@ -18,6 +18,53 @@
 int nl_monitor (nl_recvmsg_msg_cb_t cb, int type, ...);
 int nl_execute (nl_recvmsg_msg_cb_t cb, int type, int cmd);
 
+int nl_monitor_ex (nl_recvmsg_msg_cb_t cb, int type, const int *groups);
 int nl_execute_ex (nl_recvmsg_msg_cb_t cb, int family, int type, int cmd);
 
+/*
+ * Monitor with state sync: sync function is called after subscription to
+ * groups to dump the state events apply to, events of changes made
+ * meanwhile are queued on socket and fed after it. Receive buffer overrun
+ * loses events, sync is called again then to recover; monitors without
+ * sync function fail with -NLE_NOMEM on overrun. Sync function returns
+ * negative libnl error code to stop monitor.
+ */
+typedef int nl_sync_t (void *cookie);
+
+int nl_monitor_sync (nl_recvmsg_msg_cb_t cb, int type, const int *groups,
+		     nl_sync_t *sync, void *cookie);
+
+/*
+ * Number of receive buffer overruns (ENOBUFS) seen by monitors, events
+ * were lost then
+ */
+extern unsigned long nl_monitor_overruns;
+
+/*
+ * Installs message callback wrapped with nl:recv, nl:cb_entry and
+ * nl:cb_exit USDT probes, callback pointer must stay valid while socket
+ * is in use
+ */
+int nl_socket_probe_cb (struct nl_sock *h, nl_recvmsg_msg_cb_t *cb);
+
+/*
+ * In benchmark builds (NL_CANNED defined) if NL_CANNED environment variable
+ * names a file of raw netlink messages then both functions above read
+ * messages from it instead of kernel, see nl-canned.h. Replay function
+ * feeds them to callback up to the NLMSG_DONE if dump requested, or up to
+ * the end of stream otherwise.
+ */
+#ifdef NL_CANNED
+struct nl_canned;
+
+int nl_replay (struct nl_canned *o, nl_recvmsg_msg_cb_t cb, int dump);
+#endif
+
+/*
+ * Feeds message received by other means to callback as above, through
+ * reused message buffer, initially NULL. Source address is optional.
+ */
+int nl_feed (struct nl_msg **m, const struct nlmsghdr *h,
+	     struct sockaddr_nl *src, nl_recvmsg_msg_cb_t cb);
+
 #endif  /* _NL_MONITOR_H */
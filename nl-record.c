@@ -0,0 +1,179 @@
+/*
+ * NetLink Event Recorder
+ *
+ * Records raw netlink messages of selected groups with receive time into
+ * append-only file to be replayed later into benchmark build of any tool
+ * through NL_CANNED, see nl-canned.h. Optional dumps are recorded first,
+ * each one terminated with NLMSG_DONE, as tools do them before monitoring.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/rtnetlink.h>
+
+#include "nl-canned.h"
+#include "nl-core.h"
+#include "nl-monitor.h"
+
+struct name_map {
+	const char *name;
+	int value;
+};
+
+static const struct name_map route_groups[] = {
+	{ "link",	RTNLGRP_LINK		},
+	{ "neigh",	RTNLGRP_NEIGH		},
+	{ "ipv4-addr",	RTNLGRP_IPV4_IFADDR	},
+	{ "ipv6-addr",	RTNLGRP_IPV6_IFADDR	},
+	{ "ipv4-route",	RTNLGRP_IPV4_ROUTE	},
+	{ "ipv6-route",	RTNLGRP_IPV6_ROUTE	},
+	{ "ipv4-rule",	RTNLGRP_IPV4_RULE	},
+	{ "ipv6-rule",	RTNLGRP_IPV6_RULE	},
+	{ "nexthop",	RTNLGRP_NEXTHOP		},
+	{}
+};
+
+static const struct name_map netfilter_groups[] = {
+	{ "ct-new",	NFNLGRP_CONNTRACK_NEW		},
+	{ "ct-update",	NFNLGRP_CONNTRACK_UPDATE	},
+	{ "ct-destroy",	NFNLGRP_CONNTRACK_DESTROY	},
+	{}
+};
+
+static const struct name_map route_dumps[] = {
+	{ "link",	RTM_GETLINK	},
+	{ "addr",	RTM_GETADDR	},
+	{ "route",	RTM_GETROUTE	},
+	{ "neigh",	RTM_GETNEIGH	},
+	{ "rule",	RTM_GETRULE	},
+	{}
+};
+
+static int lookup (const struct name_map *map, const char *name)
+{
+	char *end;
+	long v;
+
+	for (; map->name != NULL; ++map)
+		if (strcmp (map->name, name) == 0)
+			return map->value;
+
+	v = strtol (name, &end, 0);
+	return *end == '\0' && v > 0 ? v : -1;
+}
+
+static int fd;
+
+static uint64_t wall_time (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_REALTIME, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int record (int group, const struct nlmsghdr *h)
+{
+	if (nl_canned_write (fd, wall_time (), group, h))
+		return 1;
+
+	perror ("nl-record: cannot write");
+	exit (1);
+}
+
+static int cb (struct nl_msg *m, void *ctx)
+{
+	record (nlmsg_get_src (m)->nl_groups, nlmsg_hdr (m));
+	return NL_OK;
+}
+
+static int dump (int type, int cmd)
+{
+	struct {
+		struct nlmsghdr h;
+		int error;
+	} done = {{ NLMSG_LENGTH (sizeof (int)), NLMSG_DONE, NLM_F_MULTI }};
+	int ret;
+
+	if ((ret = nl_execute (cb, type, cmd)) < 0)
+		return ret;
+
+	return record (0, &done.h);
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n\tnl-record [-p route|netfilter] "
+			 "[-d dump]... <file> <group>...\n");
+	return 1;
+}
+
+#define GROUPS_MAX  32
+
+int main (int argc, char *argv[])
+{
+	const struct name_map *groups = route_groups;
+	int type = NETLINK_ROUTE, cmd[8], group[GROUPS_MAX + 1];
+	int c, i, ndumps = 0, ngroups = 0, ret;
+
+	while ((c = getopt (argc, argv, "p:d:")) != -1)
+		switch (c) {
+		case 'p':
+			if (strcmp (optarg, "route") == 0)
+				break;
+
+			if (strcmp (optarg, "netfilter") != 0)
+				return usage ();
+
+			type   = NETLINK_NETFILTER;
+			groups = netfilter_groups;
+			break;
+		case 'd':
+			if (ndumps == 8 ||
+			    (cmd[ndumps++] = lookup (route_dumps, optarg)) < 0)
+				return usage ();
+
+			break;
+		default:
+			return usage ();
+		}
+
+	if (argc - optind < 2 || argc - optind - 1 > GROUPS_MAX ||
+	    (ndumps > 0 && type != NETLINK_ROUTE))
+		return usage ();
+
+	for (i = optind + 1; i < argc; ++i)
+		if ((group[ngroups++] = lookup (groups, argv[i])) < 0) {
+			fprintf (stderr, "nl-record: unknown group %s\n",
+				 argv[i]);
+			return 1;
+		}
+
+	group[ngroups] = 0;
+
+	if ((fd = nl_canned_create (argv[optind])) == -1) {
+		perror ("nl-record: cannot open file");
+		return 1;
+	}
+
+	for (i = 0; i < ndumps; ++i)
+		if ((ret = dump (type, cmd[i])) < 0)
+			goto error;
+
+	if ((ret = nl_monitor_ex (cb, type, group)) < 0)
+		goto error;
+
+	return 0;
+error:
+	nl_perror (ret, "nl-record");
+	return 1;
+}
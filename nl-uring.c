@@ -0,0 +1,319 @@
+/*
+ * NetLink io_uring Receiver
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include <linux/io_uring.h>
+
+#include "nl-core.h"
+#include "nl-monitor.h"
+#include "nl-uring.h"
+
+#if defined (IORING_RECV_MULTISHOT) && defined (__NR_io_uring_setup)
+
+#define SQ_ENTRIES  4
+#define BUF_COUNT   64		/* power of two */
+#define BUF_SIZE    16384	/* multicast datagrams are much smaller */
+
+struct uring {
+	int fd;
+	struct io_uring_params p;
+	void *ring;
+	size_t ring_size;
+	struct io_uring_sqe *sqe;
+	struct io_uring_buf_ring *br;
+	unsigned char *buf;
+	unsigned short tail;
+	unsigned short given, taken;	/* buffers published, consumed	*/
+	int rearm;
+	struct msghdr msg;
+};
+
+#define RING(o, field)  ((unsigned *) ((char *) (o)->ring + (o)->p.field))
+
+static int uring_enter (int fd, unsigned submit, unsigned wait)
+{
+	const unsigned flags = wait > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+	return syscall (__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static void buf_put (struct uring *o, unsigned short bid)
+{
+	struct io_uring_buf *b = o->br->bufs + (o->tail++ & (BUF_COUNT - 1));
+
+	b->addr = (uintptr_t) (o->buf + bid * BUF_SIZE);
+	b->len  = BUF_SIZE;
+	b->bid  = bid;
+}
+
+static void buf_publish (struct uring *o)
+{
+	__atomic_store_n (&o->br->tail, o->tail, __ATOMIC_RELEASE);
+	o->given = o->tail;
+}
+
+static void *map_ring (struct uring *o, size_t size, off_t offset)
+{
+	void *p;
+
+	p = mmap (NULL, size, PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_POPULATE, o->fd, offset);
+
+	return p == MAP_FAILED ? NULL : p;
+}
+
+static int uring_setup (struct uring *o)
+{
+	/* completions are run at our io_uring_enter only, in batches */
+	static const unsigned flags[] = {
+		IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+		0,
+	};
+	unsigned i;
+
+	for (i = 0; i < sizeof (flags) / sizeof (flags[0]); ++i) {
+		memset (&o->p, 0, sizeof (o->p));
+		o->p.flags = flags[i];
+
+		o->fd = syscall (__NR_io_uring_setup, SQ_ENTRIES, &o->p);
+		if (o->fd != -1)
+			return 1;
+	}
+
+	return 0;
+}
+
+static int uring_init (struct uring *o)
+{
+	const size_t br_size = BUF_COUNT * sizeof (struct io_uring_buf);
+	struct io_uring_buf_reg reg = {};
+	size_t sq_size, cq_size;
+	unsigned i;
+
+	memset (o, 0, sizeof (*o));
+
+	if (!uring_setup (o))
+		return 0;
+
+	if ((o->p.features & IORING_FEAT_SINGLE_MMAP) == 0)
+		goto no_ring;
+
+	sq_size = o->p.sq_off.array + o->p.sq_entries * sizeof (unsigned);
+	cq_size = o->p.cq_off.cqes +
+		  o->p.cq_entries * sizeof (struct io_uring_cqe);
+	o->ring_size = sq_size > cq_size ? sq_size : cq_size;
+
+	if ((o->ring = map_ring (o, o->ring_size, IORING_OFF_SQ_RING)) == NULL)
+		goto no_ring;
+
+	o->sqe = map_ring (o, o->p.sq_entries * sizeof (o->sqe[0]),
+			   IORING_OFF_SQES);
+	if (o->sqe == NULL)
+		goto no_sqe;
+
+	o->br = mmap (NULL, br_size, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (o->br == MAP_FAILED)
+		goto no_br;
+
+	if ((o->buf = malloc (BUF_COUNT * BUF_SIZE)) == NULL)
+		goto no_buf;
+
+	reg.ring_addr    = (uintptr_t) o->br;
+	reg.ring_entries = BUF_COUNT;
+	reg.bgid         = 0;
+
+	if (syscall (__NR_io_uring_register, o->fd, IORING_REGISTER_PBUF_RING,
+		     &reg, 1) != 0)
+		goto no_reg;
+
+	for (i = 0; i < BUF_COUNT; ++i)
+		buf_put (o, i);
+
+	buf_publish (o);
+
+	o->msg.msg_namelen = sizeof (struct sockaddr_nl);
+	return 1;
+no_reg:
+	free (o->buf);
+no_buf:
+	munmap (o->br, br_size);
+no_br:
+	munmap (o->sqe, o->p.sq_entries * sizeof (o->sqe[0]));
+no_sqe:
+	munmap (o->ring, o->ring_size);
+no_ring:
+	close (o->fd);
+	return 0;
+}
+
+static void uring_fini (struct uring *o)
+{
+	close (o->fd);
+	free (o->buf);
+	munmap (o->br, BUF_COUNT * sizeof (struct io_uring_buf));
+	munmap (o->sqe, o->p.sq_entries * sizeof (o->sqe[0]));
+	munmap (o->ring, o->ring_size);
+}
+
+static int uring_arm (struct uring *o, int fd)
+{
+	unsigned *tail = RING (o, sq_off.tail);
+	unsigned i = *tail & *RING (o, sq_off.ring_mask);
+	struct io_uring_sqe *sqe = o->sqe + i;
+
+	memset (sqe, 0, sizeof (*sqe));
+
+	sqe->opcode    = IORING_OP_RECVMSG;
+	sqe->fd        = fd;
+	sqe->addr      = (uintptr_t) &o->msg;
+	sqe->ioprio    = IORING_RECV_MULTISHOT;
+	sqe->flags     = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = 0;
+
+	RING (o, sq_off.array)[i] = i;
+	__atomic_store_n (tail, *tail + 1, __ATOMIC_RELEASE);
+
+	o->rearm = 0;
+	return uring_enter (o->fd, 1, 0) == 1;
+}
+
+/*
+ * Buffer holds recvmsg header, source address and datagram of netlink
+ * messages
+ */
+static int feed (struct uring *o, const void *buf, size_t len,
+		 struct nl_msg **m, nl_recvmsg_msg_cb_t cb)
+{
+	const struct io_uring_recvmsg_out *out = buf;
+	const size_t head = sizeof (*out) + o->msg.msg_namelen;
+	struct sockaddr_nl *src = (void *) (out + 1);
+	const struct nlmsghdr *h = (const void *) ((char *) buf + head);
+	int size, ret;
+
+	if (len < head)
+		return 0;
+
+	size = len - head;
+
+	for (; NLMSG_OK (h, size); h = NLMSG_NEXT (h, size)) {
+		if (h->nlmsg_type < NLMSG_MIN_TYPE)
+			continue;
+
+		if ((ret = nl_feed (m, h, src, cb)) < 0)
+			return ret;
+
+		if (ret != NL_OK)
+			break;
+	}
+
+	/* messages truncated are lost as on overrun */
+	return (out->flags & MSG_TRUNC) != 0 ? -NLE_NOMEM : 0;
+}
+
+static int complete (struct uring *o, const struct io_uring_cqe *cqe,
+		     struct nl_msg **m, nl_recvmsg_msg_cb_t cb, int *got)
+{
+	unsigned short bid;
+	int ret = 0;
+
+	if ((cqe->flags & IORING_CQE_F_MORE) == 0)
+		o->rearm = 1;
+
+	if (cqe->res == -EINVAL && !*got)
+		return -NLE_OPNOTSUPP;	/* no multishot recvmsg */
+
+	/*
+	 * Socket overrun and exhausted buffer ring both end up here. Ring
+	 * is exhausted if kernel took all buffers published: datagrams are
+	 * still queued on socket then, buffers taken are returned and
+	 * receive is rearmed. Socket error left pending, if any, comes
+	 * with the next receive.
+	 */
+	if (cqe->res == -ENOBUFS)
+		return o->taken == o->given ? 0 : -NLE_NOMEM;
+
+	if (cqe->res < 0)
+		return -nl_syserr2nlerr (-cqe->res);
+
+	if ((cqe->flags & IORING_CQE_F_BUFFER) == 0)
+		return 0;
+
+	*got = 1;
+	++o->taken;
+	bid  = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+	ret  = feed (o, o->buf + bid * BUF_SIZE, cqe->res, m, cb);
+
+	buf_put (o, bid);
+	return ret;
+}
+
+int nl_uring_recv (struct nl_sock *h, nl_recvmsg_msg_cb_t cb)
+{
+	const char *env = getenv ("NL_URING");
+	const int fd = nl_socket_get_fd (h);
+	struct uring o;
+	struct nl_msg *m = NULL;
+	struct io_uring_cqe *cqe;
+	unsigned *cq_head, *cq_tail, mask, head, tail;
+	int got = 0, ret = 0;
+
+	if ((env != NULL && strcmp (env, "0") == 0) || !uring_init (&o))
+		return -NLE_OPNOTSUPP;
+
+	cq_head = RING (&o, cq_off.head);
+	cq_tail = RING (&o, cq_off.tail);
+	mask    = *RING (&o, cq_off.ring_mask);
+	cqe     = (void *) ((char *) o.ring + o.p.cq_off.cqes);
+
+	if (!uring_arm (&o, fd)) {
+		ret = -NLE_OPNOTSUPP;
+		goto out;
+	}
+
+	while (ret == 0) {
+		if (uring_enter (o.fd, 0, 1) < 0 && errno != EINTR) {
+			ret = -nl_syserr2nlerr (errno);
+			break;
+		}
+
+		head = *cq_head;
+		tail = __atomic_load_n (cq_tail, __ATOMIC_ACQUIRE);
+
+		for (; head != tail && ret == 0; ++head)
+			ret = complete (&o, cqe + (head & mask), &m, cb, &got);
+
+		__atomic_store_n (cq_head, head, __ATOMIC_RELEASE);
+		buf_publish (&o);
+
+		if (ret == 0 && o.rearm && !uring_arm (&o, fd))
+			ret = -nl_syserr2nlerr (errno);
+	}
+out:
+	nlmsg_free (m);
+	uring_fini (&o);
+	return ret;
+}
+
+#else  /* no multishot receive in kernel headers */
+
+int nl_uring_recv (struct nl_sock *h, nl_recvmsg_msg_cb_t cb)
+{
+	return -NLE_OPNOTSUPP;
+}
+
+#endif
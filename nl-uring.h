@@ -0,0 +1,28 @@
+/*
+ * NetLink io_uring Receiver
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef NL_URING_H
+#define NL_URING_H  1
+
+#include "nl-core.h"
+
+/*
+ * Receives messages from connected netlink socket with multishot recvmsg
+ * into ring of provided buffers and feeds them to callback until error:
+ * one wakeup delivers all datagrams queued so far, no syscall per
+ * datagram is made. Socket overrun is reported as -NLE_NOMEM, as classic
+ * receive does; buffer ring exhausted is not, receive is rearmed then.
+ *
+ * Returns -NLE_OPNOTSUPP if kernel lacks io_uring, provided buffer rings
+ * or multishot recvmsg, or if NL_URING environment variable is set to 0;
+ * nothing is read from socket then and caller should use classic receive
+ * loop.
+ */
+int nl_uring_recv (struct nl_sock *h, nl_recvmsg_msg_cb_t cb);
+
+#endif  /* NL_URING_H */
@@ -0,0 +1,342 @@
+/*
+ * Staggered Renew Scheduler
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "renew-sched.h"
+#include "usdt.h"
+
+/*
+ * Hashed timer wheel: slot covers TICK milliseconds, entry further than
+ * one turn away waits for its rounds to pass
+ */
+#define TICK		10
+#define SLOTS		512
+#define BUCKETS		64
+#define NAME_MAX_LEN	16	/* IFNAMSIZ */
+
+struct renew {
+	struct renew *next, *hnext;
+	unsigned rounds;
+	char name[NAME_MAX_LEN];	/* empty if cancelled */
+};
+
+struct renew_sched {
+	struct renew_sched_opts opts;
+	renew_sched_fn *fn;
+	void *cookie;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int stop;
+
+	struct renew *slot[SLOTS], *bucket[BUCKETS];
+	unsigned cursor, pending;
+	uint64_t last;		/* time of the last tick done */
+	uint64_t seed;
+
+	uint64_t *sent;		/* ring of times of the last renews */
+	unsigned head;
+};
+
+static uint64_t now_ms (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ull + ts.tv_nsec / 1000000;
+}
+
+static unsigned name_hash (const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	for (; *name != '\0'; ++name)
+		h = (h ^ (unsigned char) *name) * 16777619u;
+
+	return h;
+}
+
+static struct renew **lookup (struct renew_sched *o, const char *name)
+{
+	struct renew **p = o->bucket + name_hash (name) % BUCKETS;
+
+	for (; *p != NULL; p = &(*p)->hnext)
+		if (strcmp ((*p)->name, name) == 0)
+			break;
+
+	return p;
+}
+
+/*
+ * In-flight slot is free if the oldest renew of the last limit ones was
+ * run at least hold milliseconds ago
+ */
+static int slot_free (struct renew_sched *o, uint64_t t)
+{
+	return o->opts.limit == 0 || o->sent[o->head] + o->opts.hold <= t;
+}
+
+static void slot_take (struct renew_sched *o, uint64_t t)
+{
+	if (o->opts.limit == 0)
+		return;
+
+	o->sent[o->head] = t;
+	o->head = (o->head + 1) % o->opts.limit;
+}
+
+/*
+ * Per-link jitter: link hash mixed with scheduler sequence, thus the same
+ * link does not always come last
+ */
+static unsigned delay (struct renew_sched *o, const char *name)
+{
+	uint64_t x = (o->seed += 0x9e3779b97f4a7c15) ^ name_hash (name);
+
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+	x ^= x >> 31;
+
+	return x % o->opts.window;
+}
+
+static void schedule (struct renew_sched *o, struct renew *e, unsigned ms)
+{
+	const unsigned ticks = ms / TICK + 1;
+	struct renew **s = o->slot + (o->cursor + ticks) % SLOTS;
+
+	e->rounds = (ticks - 1) / SLOTS;
+	e->next   = *s;
+	*s        = e;
+}
+
+/*
+ * Takes entries due from current slot, entries waiting for in-flight slot
+ * move to the next one
+ */
+static struct renew *tick (struct renew_sched *o, uint64_t t)
+{
+	struct renew *e, *keep = NULL, *due = NULL;
+	struct renew **s = o->slot + o->cursor, **p;
+
+	while ((e = *s) != NULL) {
+		*s = e->next;
+
+		if (e->name[0] == '\0') {
+			free (e);
+			continue;
+		}
+
+		if (e->rounds > 0) {
+			--e->rounds;
+			e->next = keep, keep = e;
+			continue;
+		}
+
+		if (!slot_free (o, t)) {
+			schedule (o, e, 0);
+			continue;
+		}
+
+		slot_take (o, t);
+
+		for (p = lookup (o, e->name); *p != e; p = &(*p)->hnext) {}
+
+		*p = e->hnext;
+		--o->pending;
+
+		e->next = due, due = e;
+	}
+
+	*s = keep;
+	return due;
+}
+
+static void run (struct renew_sched *o, struct renew *due)
+{
+	struct renew *e;
+
+	for (; (e = due) != NULL; free (e)) {
+		due = e->next;
+		o->fn (e->name, o->cookie);
+	}
+}
+
+static void wait_until (struct renew_sched *o, uint64_t t)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = t / 1000;
+	ts.tv_nsec = t % 1000 * 1000000;
+
+	pthread_cond_timedwait (&o->wake, &o->lock, &ts);
+}
+
+static void *sched_main (void *cookie)
+{
+	struct renew_sched *o = cookie;
+	struct renew *due;
+	uint64_t t;
+
+	pthread_mutex_lock (&o->lock);
+
+	while (!o->stop) {
+		if (o->pending == 0) {
+			pthread_cond_wait (&o->wake, &o->lock);
+			continue;
+		}
+
+		if ((t = now_ms ()) < o->last + TICK) {
+			wait_until (o, o->last + TICK);
+			continue;
+		}
+
+		o->cursor = (o->cursor + 1) % SLOTS;
+		o->last  += TICK;
+
+		if ((due = tick (o, t)) == NULL)
+			continue;
+
+		pthread_mutex_unlock (&o->lock);
+		run (o, due);
+		pthread_mutex_lock (&o->lock);
+	}
+
+	pthread_mutex_unlock (&o->lock);
+	return NULL;
+}
+
+struct renew_sched *
+renew_sched_alloc (const struct renew_sched_opts *opts, renew_sched_fn *fn,
+		   void *cookie)
+{
+	struct renew_sched *o;
+	pthread_condattr_t ca;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	o->opts   = *opts;
+	o->fn     = fn;
+	o->cookie = cookie;
+	o->seed   = now_ms ();
+
+	if (o->opts.limit > 0 &&
+	    (o->sent = calloc (o->opts.limit, sizeof (o->sent[0]))) == NULL)
+		goto no_sent;
+
+	pthread_condattr_init (&ca);
+	pthread_condattr_setclock (&ca, CLOCK_MONOTONIC);
+	pthread_mutex_init (&o->lock, NULL);
+	pthread_cond_init (&o->wake, &ca);
+	pthread_condattr_destroy (&ca);
+
+	if ((errno = pthread_create (&o->thread, NULL, sched_main, o)) != 0)
+		goto no_thread;
+
+	return o;
+no_thread:
+	pthread_cond_destroy (&o->wake);
+	pthread_mutex_destroy (&o->lock);
+	free (o->sent);
+no_sent:
+	free (o);
+	return NULL;
+}
+
+/*
+ * Pending renews are dropped
+ */
+void renew_sched_free (struct renew_sched *o)
+{
+	struct renew *e;
+	unsigned i;
+
+	if (o == NULL)
+		return;
+
+	pthread_mutex_lock (&o->lock);
+	o->stop = 1;
+	pthread_cond_signal (&o->wake);
+	pthread_mutex_unlock (&o->lock);
+
+	pthread_join (o->thread, NULL);
+
+	for (i = 0; i < SLOTS; ++i)
+		while ((e = o->slot[i]) != NULL) {
+			o->slot[i] = e->next;
+			free (e);
+		}
+
+	pthread_cond_destroy (&o->wake);
+	pthread_mutex_destroy (&o->lock);
+	free (o->sent);
+	free (o);
+}
+
+int renew_sched_put (struct renew_sched *o, const char *link)
+{
+	struct renew **p, *e;
+	uint64_t t = now_ms ();
+	unsigned ms;
+
+	pthread_mutex_lock (&o->lock);
+
+	if (*(p = lookup (o, link)) != NULL)
+		goto merged;
+
+	if (o->opts.window == 0 || (o->pending == 0 && slot_free (o, t))) {
+		slot_take (o, t);
+		pthread_mutex_unlock (&o->lock);
+
+		o->fn (link, o->cookie);
+		return 1;
+	}
+
+	if ((e = calloc (1, sizeof (*e))) == NULL) {
+		pthread_mutex_unlock (&o->lock);
+		return -1;
+	}
+
+	strncpy (e->name, link, sizeof (e->name) - 1);
+
+	if (o->pending++ == 0) {
+		o->last = t;
+		pthread_cond_signal (&o->wake);
+	}
+
+	schedule (o, e, ms = delay (o, link));
+	*p = e;
+
+	USDT_PROBE2 (udhcpc, defer, link, ms);
+merged:
+	pthread_mutex_unlock (&o->lock);
+	return 0;
+}
+
+void renew_sched_cancel (struct renew_sched *o, const char *link)
+{
+	struct renew **p, *e;
+
+	pthread_mutex_lock (&o->lock);
+
+	if ((e = *(p = lookup (o, link))) != NULL) {
+		*p = e->hnext;
+		e->name[0] = '\0';
+		--o->pending;
+	}
+
+	pthread_mutex_unlock (&o->lock);
+}
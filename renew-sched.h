@@ -0,0 +1,43 @@
+/*
+ * Staggered Renew Scheduler
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RENEW_SCHED_H
+#define RENEW_SCHED_H  1
+
+/*
+ * Renew of a link is run at once if nothing is pending and fewer than
+ * limit renews were run during the last hold milliseconds, thus single
+ * link events are not delayed. Otherwise it is deferred to a random
+ * moment within window milliseconds, and when the moment comes it waits
+ * for a free in-flight slot. Requests for a link already pending are
+ * merged. Zero window turns deferral off, zero limit removes in-flight
+ * limit.
+ */
+struct renew_sched_opts {
+	unsigned window, limit, hold;
+};
+
+typedef void renew_sched_fn (const char *link, void *cookie);
+
+/*
+ * Deferred renews are run by scheduler thread, callback must be safe to
+ * call from it
+ */
+struct renew_sched *
+renew_sched_alloc (const struct renew_sched_opts *o, renew_sched_fn *fn,
+		   void *cookie);
+void renew_sched_free (struct renew_sched *o);
+
+/*
+ * Returns 1 if renew was run at once, 0 if it was deferred or merged, -1
+ * on error
+ */
+int  renew_sched_put    (struct renew_sched *o, const char *link);
+void renew_sched_cancel (struct renew_sched *o, const char *link);
+
+#endif  /* RENEW_SCHED_H */
@@ -0,0 +1,164 @@
+/*
+ * Routing Event Journal Reader
+ *
+ * Follows journal published by route-monitor and shows events.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
+
+#include "rt-journal.h"
+#include "rt-label.h"
+
+static void show_addr (const char *prefix, int family, const void *addr)
+{
+	static const unsigned char zero[16];
+	char buf[INET6_ADDRSTRLEN];
+
+	if (memcmp (addr, zero, family == AF_INET6 ? 16 : 4) != 0)
+		printf ("%s%s", prefix,
+			inet_ntop (family, addr, buf, sizeof (buf)));
+}
+
+static void show_link (const struct rt_event *e)
+{
+	unsigned i;
+
+	printf ("link %s dev %" PRIu32 " name %s mtu %" PRIu32,
+		e->type == RTM_NEWLINK ? "add" : "del", e->ifindex, e->name,
+		e->mtu);
+
+	for (i = 0; i < e->addr_len; ++i)
+		printf ("%s%02x", i == 0 ? " address " : ":", e->addr[i]);
+
+	printf (" flags %04" PRIx32 "\n", e->flags);
+}
+
+static void show_address (const struct rt_event *e)
+{
+	printf ("address %s", e->type == RTM_NEWADDR ? "add" : "del");
+	show_addr (" address ", e->family, e->addr);
+	printf ("/%u", e->addr_len);
+	show_addr (" local ", e->family, e->local);
+	show_addr (" broadcast ", e->family, e->broadcast);
+
+	if (e->name[0] != '\0')
+		printf (" label %s", e->name);
+
+	printf (" dev %" PRIu32 "\n", e->ifindex);
+}
+
+static void show_route (const struct rt_event *e)
+{
+	const char *table = rt_table (e->table);
+	const char *proto = rt_proto (e->proto);
+
+	printf ("route %s", e->type == RTM_NEWROUTE ? "add" : "del");
+	show_addr (" dst ", e->family, e->addr);
+	printf ("/%u", e->addr_len);
+	show_addr (" via ", e->family, e->via);
+
+	if (e->ifindex != 0)
+		printf (" dev %" PRIu32, e->ifindex);
+
+	show_addr (" src ", e->family, e->src);
+	printf (" metric %" PRIu32, e->metric);
+
+	if (table != NULL)
+		printf (" table %s", table);
+	else
+		printf (" table %" PRIu32, e->table);
+
+	if (proto != NULL)
+		printf (" proto %s\n", proto);
+	else
+		printf (" proto %u\n", e->proto);
+}
+
+static void show_event (const struct rt_event *e)
+{
+	switch (e->type) {
+	case RTM_NEWLINK:
+	case RTM_DELLINK:
+		show_link (e);
+		break;
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+		show_address (e);
+		break;
+	case RTM_NEWROUTE:
+	case RTM_DELROUTE:
+		show_route (e);
+		break;
+	}
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n\troute-journal [-n] journal\n"
+			 "\nShows events held by journal and follows it, "
+			 "with -n new events only\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	const struct timespec idle = { 0, 1000000 };
+	struct rt_journal *o;
+	struct rt_event e;
+	uint64_t lost;
+	int c, skip = 0, ret;
+
+	while ((c = getopt (argc, argv, "n")) != -1)
+		switch (c) {
+		case 'n':  skip = 1; break;
+		default:
+			return usage ();
+		}
+
+	if (argc - optind != 1)
+		return usage ();
+
+	if ((o = rt_journal_open (argv[optind])) == NULL) {
+		perror ("route-journal");
+		return 1;
+	}
+
+	if (skip)
+		rt_journal_seek_end (o);
+
+	for (;;) {
+		if ((ret = rt_journal_read (o, &e, &lost)) == 0) {
+			fflush (stdout);
+			nanosleep (&idle, NULL);
+			continue;
+		}
+
+		if (ret < 0) {
+			if (errno == ESTALE)
+				printf ("journal restarted\n");
+			else
+				perror ("route-journal");
+
+			continue;
+		}
+
+		if (lost > 0)
+			printf ("lost %" PRIu64 " events\n", lost);
+
+		show_event (&e);
+	}
+
+	return 0;
+}
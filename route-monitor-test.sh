@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Checks route-monitor output for canned messages from nl-gen: attributes
+# route-monitor does not show by name are shown by type, IPv6 routes from
+# kernel carry several of them
+#
+# Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+#
+# SPDX-License-Identifier: BSD-2-Clause
+#
+
+set -e
+
+DIR=${DIR:-/tmp/route-monitor-test}
+BIN=$(dirname "$0")
+
+mkdir -p "$DIR"
+
+check () {
+	name=$1 expect=$2
+	shift 2
+
+	"$BIN/nl-gen" links 0 > "$DIR/$name"
+	"$BIN/nl-gen" "$@" >> "$DIR/$name"
+
+	got=$(NL_CANNED="$DIR/$name" "$BIN/route-monitor-bench" 2>/dev/null)
+
+	if [ "$got" != "$expect" ]; then
+		printf "%s: got\n\t%s\nexpected\n\t%s\n" "$name" "$got" \
+			"$expect" >&2
+		exit 1
+	fi
+
+	echo "$name: ok"
+}
+
+check route6 "route add dst 2001:db8::/64 via fe80::1 dev 1 metric 100 \
+proto static" routes6 1
+
+check route6-full "route add dst 2001:db8::/64 via fe80::1 dev 1 metric 100 \
+type 2 type 3 type 8 type 9 type 20 type 23 proto static" routes6-full 1
@@ -1,21 +1,89 @@
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <net/if_arp.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include <linux/netlink.h>
 #include <linux/wireless.h>
-#include <netlink/netlink.h>
-#include <netlink/msg.h>
 
+#include "line-ring.h"
+#include "nl-core.h"
 #include "nl-monitor.h"
+#include "rt-attr.h"
+#include "rt-journal.h"
 #include "rt-label.h"
+#include "rt-link.h"
+
+static struct rt_journal *journal;
+static struct rt_links *links;
+static int quiet;
+
+/*
+ * Event text is built in line buffer and passed to writer thread through
+ * ring, thus netlink reading does not stall on slow output
+ */
+enum kind {
+	KIND_LINK, KIND_ADDR = 2, KIND_ROUTE = 4,
+};
+
+static const char *const kinds[] = {
+	"link add", "link del", "address add", "address del",
+	"route add", "route del",
+};
+
+static struct line_ring *ring;
+static char *line;
+static size_t line_len, line_size;
+
+static void out (const char *fmt, ...)
+{
+	va_list ap;
+	size_t size;
+	int len;
+	char *p;
+
+	for (;;) {
+		va_start (ap, fmt);
+		len = vsnprintf (line + line_len, line_size - line_len, fmt,
+				 ap);
+		va_end (ap);
+
+		if (len < 0 || line_len + len < line_size)
+			break;
+
+		size = line_size > 0 ? line_size * 2 : 256;
+
+		if (size <= line_len + len)
+			size = line_len + len + 1;
+
+		if ((p = realloc (line, size)) == NULL)
+			return;
+
+		line      = p;
+		line_size = size;
+	}
+
+	if (len > 0)
+		line_len += len;
+}
+
+static void emit (enum kind kind, int del)
+{
+	out ("\n");
+	line_ring_put (ring, kind + del, line, line_len);
+	line_len = 0;
+}
 
 static void show_arp_type (unsigned type)
 {
-	printf (" link/");
+	out (" link/");
 
-#define SHOW(type, name)  case ARPHRD_##type: printf (name); break;
+#define SHOW(type, name)  case ARPHRD_##type: out (name); break;
 
 	switch (type) {
 	SHOW (ETHER,		"ether")
@@ -30,7 +98,7 @@ static void show_arp_type (unsigned type)
 	SHOW (NONE,		"none")
 
 	default:
-		printf ("%04x", type);
+		out ("%04x", type);
 	}
 
 #undef SHOW
@@ -40,10 +108,10 @@ static unsigned show_link_flag (unsigned flags,
 				unsigned flag, const char *name)
 {
 	if ((flags & flag) != 0) {
-		printf ("%s", name);
+		out ("%s", name);
 
 		if ((flags &= ~flag) != 0)
-			printf (",");
+			out (",");
 	}
 
 	return flags;
@@ -51,7 +119,7 @@ static unsigned show_link_flag (unsigned flags,
 
 static void show_link_flags (unsigned flags)
 {
-	printf (" <");
+	out (" <");
 
 #define SHOW(name)  flags = show_link_flag (flags, IFF_##name, #name)
 
@@ -73,9 +141,9 @@ static void show_link_flags (unsigned flags)
 #undef SHOW
 
 	if (flags != 0)
-		printf ("%04x", flags);
+		out ("%04x", flags);
 
-	printf (">");
+	out (">");
 }
 
 static void show_proto (unsigned char index)
@@ -86,9 +154,9 @@ static void show_proto (unsigned char index)
 		return;
 
 	if (label != NULL)
-		printf (" proto %s", label);
+		out (" proto %s", label);
 	else
-		printf (" proto %u", index);
+		out (" proto %u", index);
 }
 
 static void show_scope (unsigned char index)
@@ -99,9 +167,9 @@ static void show_scope (unsigned char index)
 		return;
 
 	if (label != NULL)
-		printf (" scope %s", label);
+		out (" scope %s", label);
 	else
-		printf (" scope %u", index);
+		out (" scope %u", index);
 }
 
 static void show_table (unsigned index)
@@ -112,14 +180,14 @@ static void show_table (unsigned index)
 		return;
 
 	if (label != NULL)
-		printf (" table %s", label);
+		out (" table %s", label);
 	else
-		printf (" table %u", index);
+		out (" table %u", index);
 }
 
 static void show_route_type (unsigned type)
 {
-#define SHOW(type, name)  case RTN_##type: printf (" %s", name); break;
+#define SHOW(type, name)  case RTN_##type: out (" %s", name); break;
 
 	switch (type) {
 	case RTN_UNICAST:
@@ -135,7 +203,7 @@ static void show_route_type (unsigned type)
 	SHOW (NAT,		"nat")
 
 	default:
-		printf (" route-type %02x", type);
+		out (" route-type %02x", type);
 	}
 
 #undef SHOW
@@ -145,240 +213,306 @@ static void show_dump (const char *prefix, const void *data, size_t size)
 {
 	const unsigned char *p;
 
-	printf ("%s", prefix);
+	out ("%s", prefix);
 
 	for (p = data; size > 0; ++p) {
-		printf ("%02x", *p);
+		out ("%02x", *p);
 
 		if (--size != 0)
-			printf (":");
+			out (":");
 	}
 }
 
-static void link_show_rta (struct ifinfomsg *o, struct rtattr *rta)
+/*
+ * Attributes shown by name or ignored, the rest are shown by type. Lists
+ * are ours, not policies: those grow with attributes other tools read.
+ */
+static const unsigned char link_known[IFLA_MAX + 1] = {
+	[IFLA_ADDRESS] = 1, [IFLA_BROADCAST] = 1, [IFLA_IFNAME] = 1,
+	[IFLA_MTU] = 1, [IFLA_LINK] = 1, [IFLA_QDISC] = 1, [IFLA_STATS] = 1,
+	[IFLA_TXQLEN] = 1, [IFLA_MAP] = 1, [IFLA_WIRELESS] = 1,
+	[IFLA_OPERSTATE] = 1, [IFLA_LINKMODE] = 1, [IFLA_LINKINFO] = 1,
+	[IFLA_STATS64] = 1, [IFLA_AF_SPEC] = 1, [IFLA_GROUP] = 1,
+	[IFLA_PROMISCUITY] = 1, [IFLA_NUM_TX_QUEUES] = 1,
+	[IFLA_NUM_RX_QUEUES] = 1, [IFLA_CARRIER] = 1,
+	[IFLA_CARRIER_CHANGES] = 1, [IFLA_PROTO_DOWN] = 1,
+	[IFLA_GSO_MAX_SEGS] = 1, [IFLA_GSO_MAX_SIZE] = 1,
+};
+
+static const unsigned char addr_known[IFA_MAX + 1] = {
+	[IFA_ADDRESS] = 1, [IFA_LOCAL] = 1, [IFA_LABEL] = 1,
+	[IFA_BROADCAST] = 1, [IFA_ANYCAST] = 1, [IFA_CACHEINFO] = 1,
+	[IFA_MULTICAST] = 1,
+};
+
+static const unsigned char route_known[RTA_MAX + 1] = {
+	[RTA_DST] = 1, [RTA_GATEWAY] = 1, [RTA_OIF] = 1, [RTA_PREFSRC] = 1,
+	[RTA_PRIORITY] = 1, [RTA_CACHEINFO] = 1, [RTA_TABLE] = 1,
+	[RTA_MARK] = 1,
+};
+
+static void show_unknown (struct rtattr **tb, const unsigned char *known,
+			  unsigned max, int dump)
 {
-	struct iw_event *iw;
+	unsigned i;
 
-	switch (rta->rta_type) {
-	case IFLA_ADDRESS:
-		show_dump (" address ", RTA_DATA (rta), RTA_PAYLOAD (rta));
-		break;
-	case IFLA_BROADCAST:
-		show_dump (" broadcast ", RTA_DATA (rta), RTA_PAYLOAD (rta));
-		break;
-	case IFLA_IFNAME:
-		printf (" name %s", (char *) RTA_DATA (rta));
-		break;
-	case IFLA_MTU:
-		printf (" mtu %u", *(unsigned *) RTA_DATA (rta));
-		break;
-	case IFLA_LINK:
-		printf (" link-type %i", *(int *) RTA_DATA (rta));
-		break;
-	case IFLA_TXQLEN:
-		printf (" qlen %u", *(unsigned *) RTA_DATA (rta));
-		break;
-	case IFLA_WIRELESS:
-		iw = (struct iw_event *) RTA_DATA (rta);
-		printf (" wireless %04x", iw->cmd);
-		break;
-	case IFLA_QDISC:
-	case IFLA_STATS:
-	case IFLA_MAP:
-	case IFLA_OPERSTATE:
-	case IFLA_LINKMODE:
-	case IFLA_LINKINFO:
-	case IFLA_STATS64:
-	case IFLA_AF_SPEC:
-	case IFLA_GROUP:
-	case IFLA_PROMISCUITY:
-	case IFLA_NUM_TX_QUEUES:
-	case IFLA_NUM_RX_QUEUES:
-	case IFLA_CARRIER:
-	case IFLA_CARRIER_CHANGES:
-	case IFLA_PROTO_DOWN:
-	case IFLA_GSO_MAX_SEGS:
-	case IFLA_GSO_MAX_SIZE:
-		/* ignore it */
-		break;
-	default:
-		printf (" type %d", rta->rta_type);
-		show_dump (" ", RTA_DATA (rta), RTA_PAYLOAD (rta));
-		break;
-	}
+	for (i = 1; i <= max; ++i)
+		if (tb[i] != NULL && !known[i]) {
+			out (" type %u", i);
+
+			if (dump)
+				show_dump (" ", RTA_DATA (tb[i]),
+					   RTA_PAYLOAD (tb[i]));
+		}
 }
 
-static int process_link (struct nlmsghdr *h, void *ctx)
+static void show_dev (int index)
 {
-	struct ifinfomsg *o = NLMSG_DATA (h);
-	struct rtattr *rta;
-	int len;
+	const char *name = rt_links_name (links, index);
 
-	printf ("link %s", h->nlmsg_type == RTM_NEWLINK ? "add" : "del");
-	printf (" dev %d", o->ifi_index);
-	show_arp_type (o->ifi_type);
+	if (name != NULL)
+		out (" dev %s", name);
+	else
+		out (" dev %d", index);
+}
 
-	for (
-		rta = IFLA_RTA (o), len = IFLA_PAYLOAD (h);
-		RTA_OK (rta, len);
-		rta = RTA_NEXT (rta, len)
-	)
-		link_show_rta (o, rta);
+static void show_addr (const char *prefix, int family, struct rtattr *rta)
+{
+	char buf[INET6_ADDRSTRLEN];
 
-	show_link_flags (o->ifi_flags);
-	printf ("\n");
+	if (rta != NULL)
+		out ("%s%s", prefix,
+			inet_ntop (family, RTA_DATA (rta), buf, sizeof (buf)));
+}
 
-	return 0;
+/*
+ * Journal records hold decoded events, attributes are already checked by
+ * index to be long enough
+ */
+static void copy_addr (void *to, int family, struct rtattr *a)
+{
+	if (a != NULL)
+		memcpy (to, RTA_DATA (a), family == AF_INET6 ? 16 : 4);
 }
 
-static void addr_show_rta (struct ifaddrmsg *ifa, struct rtattr *rta,
-			   struct rtattr *addr)
+static void copy_name (char *to, size_t size, struct rtattr *a)
 {
-	char buf[INET6_ADDRSTRLEN];
-	const char *type = "", *p;
+	if (a != NULL)
+		snprintf (to, size, "%s", (const char *) RTA_DATA (a));
+}
 
-	switch (rta->rta_type) {
-	case IFA_LOCAL:		type = "local";		break;
-	case IFA_BROADCAST:	type = "broadcast";	break;
-	case IFA_ANYCAST:	type = "anycast";	break;
-	case IFA_MULTICAST:	type = "multicast";	break;
+static void publish_link (int type, struct ifinfomsg *o, struct rtattr **tb)
+{
+	struct rt_event *e = rt_journal_begin (journal);
+	struct rtattr *a = tb[IFLA_ADDRESS];
+
+	e->type      = type;
+	e->ifindex   = o->ifi_index;
+	e->link_type = o->ifi_type;
+	e->flags     = o->ifi_flags;
+	e->mtu       = rt_u32 (tb[IFLA_MTU], 0);
+
+	if (a != NULL && RTA_PAYLOAD (a) <= sizeof (e->addr)) {
+		e->addr_len = RTA_PAYLOAD (a);
+		memcpy (e->addr, RTA_DATA (a), e->addr_len);
 	}
 
-	switch (rta->rta_type) {
-	case IFA_LABEL:
-		printf (" label %s", (const char *) RTA_DATA (rta));
-		break;
-	case IFA_ADDRESS:
-		p = inet_ntop (ifa->ifa_family, RTA_DATA (rta),
-			       buf, sizeof (buf));
+	copy_name (e->name, sizeof (e->name), tb[IFLA_IFNAME]);
+	rt_journal_commit (journal);
+}
 
-		printf (" address %s/%d", p, ifa->ifa_prefixlen);
-		break;
-	case IFA_LOCAL:
-		if (addr != NULL && addr->rta_len == rta->rta_len &&
-		    memcmp (RTA_DATA (addr), RTA_DATA (rta),
-			    RTA_PAYLOAD (rta)) == 0)
-			break;
-	case IFA_BROADCAST:
-	case IFA_ANYCAST:
-	case IFA_MULTICAST:
-		p = inet_ntop (ifa->ifa_family, RTA_DATA (rta),
-			       buf, sizeof (buf));
+static void publish_addr (int type, struct ifaddrmsg *o, struct rtattr **tb)
+{
+	struct rt_event *e = rt_journal_begin (journal);
+
+	e->type     = type;
+	e->family   = o->ifa_family;
+	e->ifindex  = o->ifa_index;
+	e->addr_len = o->ifa_prefixlen;
+	e->scope    = o->ifa_scope;
+	e->flags    = o->ifa_flags;
+
+	copy_addr (e->addr,      o->ifa_family, tb[IFA_ADDRESS]);
+	copy_addr (e->local,     o->ifa_family, tb[IFA_LOCAL]);
+	copy_addr (e->broadcast, o->ifa_family, tb[IFA_BROADCAST]);
+	copy_name (e->name, sizeof (e->name), tb[IFA_LABEL]);
+	rt_journal_commit (journal);
+}
 
-		printf (" %s %s", type, p);
-		break;
-	case IFA_CACHEINFO:
-		/* ignore it */
-		break;
-	default:
-		printf (" type %d", rta->rta_type);
-		break;
-	}
+static void publish_route (int type, struct rtmsg *o, struct rtattr **tb)
+{
+	struct rt_event *e = rt_journal_begin (journal);
+
+	e->type       = type;
+	e->family     = o->rtm_family;
+	e->ifindex    = rt_u32 (tb[RTA_OIF], 0);
+	e->addr_len   = o->rtm_dst_len;
+	e->scope      = o->rtm_scope;
+	e->proto      = o->rtm_protocol;
+	e->route_type = o->rtm_type;
+	e->table      = rt_u32 (tb[RTA_TABLE], o->rtm_table);
+	e->metric     = rt_u32 (tb[RTA_PRIORITY], 0);
+	e->flags      = o->rtm_flags;
+
+	copy_addr (e->addr, o->rtm_family, tb[RTA_DST]);
+	copy_addr (e->via,  o->rtm_family, tb[RTA_GATEWAY]);
+	copy_addr (e->src,  o->rtm_family, tb[RTA_PREFSRC]);
+	rt_journal_commit (journal);
 }
 
-static int process_addr (struct nlmsghdr *h, void *ctx)
+static int process_link (struct nlmsghdr *h, void *ctx)
 {
-	struct ifaddrmsg *ifa = NLMSG_DATA (h);
-	struct rtattr *rta, *addr = NULL;
-	int len;
+	struct ifinfomsg *o = NLMSG_DATA (h);
+	struct rtattr *tb[IFLA_MAX + 1];
+	struct iw_event *iw;
 
-	if (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)
+	if (!rt_index_link (tb, h))
 		return 0;
 
-	printf ("address %s", h->nlmsg_type == RTM_NEWADDR ? "add" : "del");
+	(void) rt_links_apply (links, h, tb);
 
-	for (
-		rta = IFA_RTA (ifa), len = IFA_PAYLOAD (h);
-		RTA_OK (rta, len);
-		rta = RTA_NEXT (rta, len)
-	) {
-		if (rta->rta_type == IFA_ADDRESS)
-			addr = rta;
+	if (journal != NULL)
+		publish_link (h->nlmsg_type, o, tb);
 
-		addr_show_rta (ifa, rta, addr);
-	}
+	if (quiet)
+		return 0;
 
-	printf (" dev %d", ifa->ifa_index);
-	show_scope (ifa->ifa_scope);
-	printf ("\n");
+	out ("link %s", h->nlmsg_type == RTM_NEWLINK ? "add" : "del");
+	out (" dev %d", o->ifi_index);
+	show_arp_type (o->ifi_type);
+
+	if (tb[IFLA_IFNAME] != NULL)
+		out (" name %s", (char *) RTA_DATA (tb[IFLA_IFNAME]));
+
+	if (tb[IFLA_MTU] != NULL)
+		out (" mtu %u", rt_u32 (tb[IFLA_MTU], 0));
+
+	if (tb[IFLA_TXQLEN] != NULL)
+		out (" qlen %u", rt_u32 (tb[IFLA_TXQLEN], 0));
+
+	if (tb[IFLA_LINK] != NULL)
+		out (" link-type %i", (int) rt_u32 (tb[IFLA_LINK], 0));
+
+	if (tb[IFLA_ADDRESS] != NULL)
+		show_dump (" address ", RTA_DATA (tb[IFLA_ADDRESS]),
+			   RTA_PAYLOAD (tb[IFLA_ADDRESS]));
+
+	if (tb[IFLA_BROADCAST] != NULL)
+		show_dump (" broadcast ", RTA_DATA (tb[IFLA_BROADCAST]),
+			   RTA_PAYLOAD (tb[IFLA_BROADCAST]));
+
+	if ((iw = rt_data (tb[IFLA_WIRELESS])) != NULL)
+		out (" wireless %04x", iw->cmd);
+
+	show_unknown (tb, link_known, IFLA_MAX, 1);
+	show_link_flags (o->ifi_flags);
+	emit (KIND_LINK, h->nlmsg_type == RTM_DELLINK);
 
 	return 0;
 }
 
-static void route_show_rta (struct rtmsg *rtm, struct rtattr *rta)
+static int same_attr (struct rtattr *a, struct rtattr *b)
 {
-	char buf[INET6_ADDRSTRLEN];
-	const char *p;
+	return a != NULL && b != NULL && a->rta_len == b->rta_len &&
+	       memcmp (RTA_DATA (a), RTA_DATA (b), RTA_PAYLOAD (a)) == 0;
+}
 
-	switch (rta->rta_type) {
-	case RTA_DST:
-		p = inet_ntop (rtm->rtm_family, RTA_DATA (rta),
-			       buf, sizeof (buf));
+static int process_addr (struct nlmsghdr *h, void *ctx)
+{
+	struct ifaddrmsg *ifa = NLMSG_DATA (h);
+	struct rtattr *tb[IFA_MAX + 1];
+	const int family = ifa->ifa_family;
 
-		printf (" dst %s/%d", p, rtm->rtm_dst_len);
-		break;
-	case RTA_GATEWAY:
-		p = inet_ntop (rtm->rtm_family, RTA_DATA (rta),
-			       buf, sizeof (buf));
+	if (family != AF_INET && family != AF_INET6)
+		return 0;
 
-		printf (" via %s", p);
-		break;
-	case RTA_OIF:
-		printf (" dev %d", *(int *) RTA_DATA (rta));
-		break;
-	case RTA_PREFSRC:
-		p = inet_ntop (rtm->rtm_family, RTA_DATA (rta),
-			       buf, sizeof (buf));
+	if (!rt_index_addr (tb, h))
+		return 0;
 
-		printf (" src %s", p);
-		break;
-	case RTA_PRIORITY:
-		printf (" metric %u", *(unsigned *) RTA_DATA (rta));
-		break;
-	case RTA_CACHEINFO:
-		/* ignore it */
-		break;
-	case RTA_TABLE:
-		if (rtm->rtm_table == RT_TABLE_UNSPEC)
-			show_table (*(unsigned *) RTA_DATA (rta));
-		break;
-	case RTA_MARK:
-		printf (" mark 0x%x", *(unsigned *) RTA_DATA (rta));
-		break;
-	default:
-		printf (" type %d", rta->rta_type);
-		break;
+	if (journal != NULL)
+		publish_addr (h->nlmsg_type, ifa, tb);
+
+	if (quiet)
+		return 0;
+
+	out ("address %s", h->nlmsg_type == RTM_NEWADDR ? "add" : "del");
+
+	if (tb[IFA_ADDRESS] != NULL) {
+		show_addr (" address ", family, tb[IFA_ADDRESS]);
+		out ("/%d", ifa->ifa_prefixlen);
 	}
+
+	if (!same_attr (tb[IFA_LOCAL], tb[IFA_ADDRESS]))
+		show_addr (" local ", family, tb[IFA_LOCAL]);
+
+	show_addr (" broadcast ", family, tb[IFA_BROADCAST]);
+	show_addr (" anycast ",   family, tb[IFA_ANYCAST]);
+	show_addr (" multicast ", family, tb[IFA_MULTICAST]);
+
+	if (tb[IFA_LABEL] != NULL)
+		out (" label %s", (const char *) RTA_DATA (tb[IFA_LABEL]));
+
+	show_unknown (tb, addr_known, IFA_MAX, 0);
+
+	show_dev (ifa->ifa_index);
+	show_scope (ifa->ifa_scope);
+	emit (KIND_ADDR, h->nlmsg_type == RTM_DELADDR);
+
+	return 0;
 }
 
 static int process_route (struct nlmsghdr *h, void *ctx)
 {
 	struct rtmsg *rtm = NLMSG_DATA (h);
-	struct rtattr *rta;
-	int len;
+	struct rtattr *tb[RTA_MAX + 1];
+	const int family = rtm->rtm_family;
 
-	if (rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6)
+	if (family != AF_INET && family != AF_INET6)
 		return 0;
 
 	if (rtm->rtm_table == RT_TABLE_LOCAL)
 		return 0;
 
-	printf ("route %s", h->nlmsg_type == RTM_NEWROUTE ? "add" : "del");
+	if (!rt_index_route (tb, h))
+		return 0;
+
+	if (journal != NULL)
+		publish_route (h->nlmsg_type, rtm, tb);
+
+	if (quiet)
+		return 0;
+
+	out ("route %s", h->nlmsg_type == RTM_NEWROUTE ? "add" : "del");
 	show_route_type (rtm->rtm_type);
 
-	for (
-		rta = RTM_RTA (rtm), len = RTM_PAYLOAD (h);
-		RTA_OK (rta, len);
-		rta = RTA_NEXT (rta, len)
-	)
-		route_show_rta (rtm, rta);
+	if (tb[RTA_DST] != NULL) {
+		show_addr (" dst ", family, tb[RTA_DST]);
+		out ("/%d", rtm->rtm_dst_len);
+	}
+
+	show_addr (" via ", family, tb[RTA_GATEWAY]);
+
+	if (tb[RTA_OIF] != NULL)
+		show_dev (rt_u32 (tb[RTA_OIF], 0));
+
+	show_addr (" src ", family, tb[RTA_PREFSRC]);
+
+	if (tb[RTA_PRIORITY] != NULL)
+		out (" metric %u", rt_u32 (tb[RTA_PRIORITY], 0));
+
+	if (tb[RTA_MARK] != NULL)
+		out (" mark 0x%x", rt_u32 (tb[RTA_MARK], 0));
+
+	show_unknown (tb, route_known, RTA_MAX, 0);
 
 	if (rtm->rtm_table != RT_TABLE_UNSPEC)
 		show_table (rtm->rtm_table);
+	else if (tb[RTA_TABLE] != NULL)
+		show_table (rt_u32 (tb[RTA_TABLE], 0));
 
 	show_proto (rtm->rtm_protocol);
 	show_scope (rtm->rtm_scope);
-	printf ("\n");
+	emit (KIND_ROUTE, h->nlmsg_type == RTM_DELROUTE);
 
 	return 0;
 }
@@ -402,21 +536,128 @@ static int cb (struct nl_msg *m, void *ctx)
 	return 0;
 }
 
-int main (void)
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n\troute-monitor [-q] [-j journal] "
+			 "[-n records] [-o policy] [-b size]\n"
+			 "\nWith -j decoded events are published into shared "
+			 "journal file (see\nrt-journal.h) of 65536 records "
+			 "by default, -q suppresses text output\n"
+			 "\nText output is queued for writer thread in ring of "
+			 "<size> bytes, 1 MiB by\ndefault. If output stalls "
+			 "and ring fills, policy decides: block waits,\n"
+			 "drop (default) loses events and reports gap, summary "
+			 "loses events and\nreports their counts by type\n");
+	return 1;
+}
+
+static int parse_policy (const char *from, enum line_ring_policy *policy)
 {
+	static const char *name[] = { "block", "drop", "summary" };
+	unsigned i;
+
+	for (i = 0; i < sizeof (name) / sizeof (name[0]); ++i)
+		if (strcmp (from, name[i]) == 0) {
+			*policy = i;
+			return 1;
+		}
+
+	return 0;
+}
+
+/*
+ * Tables are dumped after subscription to their changes, and again after
+ * overrun: link table is rebuilt then, links deleted meanwhile go away
+ */
+static int resync (void *cookie)
+{
+	static int synced;
+	struct rt_links *fresh;
 	int ret;
 
+	if (synced) {
+		fprintf (stderr, "route-monitor: events lost, dumping again\n");
+
+		if ((fresh = rt_links_alloc ()) == NULL)
+			return -NLE_NOMEM;
+
+		rt_links_free (links);
+		links = fresh;
+	}
+
+	synced = 1;
+
 	if ((ret = nl_execute (cb, NETLINK_ROUTE, RTM_GETLINK)) < 0 ||
 	    (ret = nl_execute (cb, NETLINK_ROUTE, RTM_GETADDR)) < 0 ||
-	    (ret = nl_execute (cb, NETLINK_ROUTE, RTM_GETROUTE)) < 0 ||
-	    (ret = nl_monitor (cb, NETLINK_ROUTE, RTNLGRP_LINK,
-					   RTNLGRP_IPV4_ROUTE,
-					   RTNLGRP_IPV6_ROUTE,
-					   RTNLGRP_IPV4_IFADDR,
-					   RTNLGRP_IPV6_IFADDR, 0)) < 0) {
+	    (ret = nl_execute (cb, NETLINK_ROUTE, RTM_GETROUTE)) < 0)
+		return ret;
+
+	return 0;
+}
+
+int main (int argc, char *argv[])
+{
+	static const int groups[] = {
+		RTNLGRP_LINK, RTNLGRP_IPV4_ROUTE, RTNLGRP_IPV6_ROUTE,
+		RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR, 0
+	};
+	const char *path = NULL;
+	unsigned records = 65536;
+	enum line_ring_policy policy = LINE_RING_DROP;
+	size_t size = 1 << 20;
+	int c, ret;
+
+	while ((c = getopt (argc, argv, "qj:n:o:b:")) != -1)
+		switch (c) {
+		case 'q':  quiet   = 1;				break;
+		case 'j':  path    = optarg;			break;
+		case 'n':  records = strtoul (optarg, NULL, 0);	break;
+		case 'o':
+			if (!parse_policy (optarg, &policy))
+				return usage ();
+
+			break;
+		case 'b':  size    = strtoul (optarg, NULL, 0);	break;
+		default:
+			return usage ();
+		}
+
+	if (optind != argc || records == 0)
+		return usage ();
+
+	if ((links = rt_links_alloc ()) == NULL) {
+		perror ("route-monitor: cannot allocate link table");
+		return 1;
+	}
+
+	if (path != NULL &&
+	    (journal = rt_journal_create (path, records)) == NULL) {
+		perror ("route-monitor: cannot create journal");
+		return 1;
+	}
+
+	if (!quiet &&
+	    (ring = line_ring_alloc (1, size, policy, kinds,
+				     sizeof (kinds) / sizeof (kinds[0]))) == NULL) {
+		perror ("route-monitor: cannot start writer");
+		return 1;
+	}
+
+	if ((ret = nl_monitor_sync (cb, NETLINK_ROUTE, groups, resync,
+				    NULL)) < 0) {
 		nl_perror (ret, "netlink monitor");
+		goto error;
+	}
+
+	if (ring != NULL && !line_ring_free (ring)) {
+		perror ("route-monitor: write");
 		return 1;
 	}
 
 	return 0;
+error:
+	if (ring != NULL)
+		line_ring_free (ring);
+
+	return 1;
 }
@@ -6,8 +6,11 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include <sys/socket.h>		/* AF_INET*		*/
 
@@ -15,11 +18,16 @@
 #include <arpa/inet.h>
 
 #include <linux/icmpv6.h>	/* ICMPV6_ROUTER_PREF_*	*/
-#include <netlink/netlink.h>
-#include <netlink/msg.h>
 
+#include "nl-core.h"
 #include "nl-monitor.h"
+#include "rt-attr.h"
 #include "rt-label.h"
+#include "rt-table.h"
+
+#ifdef NL_CANNED
+#include "nl-canned.h"
+#endif
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(a)  (sizeof (a) / sizeof ((a)[0]))
@@ -59,7 +67,6 @@ static int show_str (const char *v, int cont, int json)
 }
 
 #define RTNH_NEXT_NG(rtnh, len)  ((len) -= RTNH_ALIGN((rtnh)->rtnh_len), RTNH_NEXT(rtnh))
-#define RTNH_PAYLOAD(rtnh)       ((int)((rtnh)->rtnh_len) - RTNH_LENGTH(0))
 
 struct nexthop_info {
 	unsigned char family, flags, hops, dev;
@@ -69,23 +76,15 @@ struct nexthop_info {
 static void
 nexthop_info_init (struct nexthop_info *o, int family, struct rtnexthop *nh)
 {
-	struct rtattr *rta;
-	int len;
+	struct rtattr *tb[RTA_MAX + 1];
+
+	rt_index_nexthop (tb, family, nh);
 
 	o->family = family;
 	o->flags  = nh->rtnh_flags;
 	o->hops   = nh->rtnh_hops;
 	o->dev    = nh->rtnh_ifindex;
-	o->via    = NULL;
-
-	for (
-		rta = RTNH_DATA (nh), len = RTNH_PAYLOAD (nh);
-		RTA_OK (rta, len);
-		rta = RTA_NEXT (rta, len)
-	)
-		switch (rta->rta_type) {
-		case RTA_GATEWAY:  o->via = RTA_DATA (rta); break;
-		}
+	o->via    = rt_data (tb[RTA_GATEWAY]);
 }
 
 static int show_nexthop_via (struct nexthop_info *o, int cont, int json)
@@ -165,31 +164,10 @@ struct route_info {
 	void *dst, *via, *src, *hops;
 };
 
-static void route_info_set_rta (struct route_info *o, struct rtattr *rta)
-{
-	switch (rta->rta_type) {
-	case RTA_DST:		o->dst    =           RTA_DATA (rta); break;
-	case RTA_GATEWAY:	o->via    =           RTA_DATA (rta); break;
-	case RTA_OIF:		o->dev    = *(int *)  RTA_DATA (rta); break;
-	case RTA_PREFSRC:	o->src    =           RTA_DATA (rta); break;
-	case RTA_PRIORITY:	o->metric = *(int *)  RTA_DATA (rta); break;
-	case RTA_TABLE:		o->table  = *(int *)  RTA_DATA (rta); break;
-	case RTA_MARK:		o->mark   = *(int *)  RTA_DATA (rta); break;
-	case RTA_PREF:		o->pref   = *(char *) RTA_DATA (rta); break;
-	case RTA_EXPIRES:	o->expire = *(int *)  RTA_DATA (rta); break;
-
-	case RTA_MULTIPATH:
-		o->hops     = RTA_DATA    (rta);
-		o->hops_len = RTA_PAYLOAD (rta);
-		break;
-	}
-}
-
 static
-void route_info_init (struct route_info *o, struct rtmsg *rtm, size_t len)
+void route_info_init (struct route_info *o, struct rtmsg *rtm,
+		      struct rtattr **tb)
 {
-	struct rtattr *rta;
-
 	memset (o, 0, sizeof (*o));
 
 	o->family  = rtm->rtm_family;
@@ -199,13 +177,21 @@ void route_info_init (struct route_info *o, struct rtmsg *rtm, size_t len)
 	o->type    = rtm->rtm_type;
 	o->flags   = rtm->rtm_flags;
 
-	o->metric = -1;
-	o->table = rtm->rtm_table;
-	o->pref = -1;
-	o->hops = NULL;
+	o->dev    = rt_u32 (tb[RTA_OIF],      0);
+	o->metric = rt_u32 (tb[RTA_PRIORITY], -1);
+	o->table  = rt_u32 (tb[RTA_TABLE],    rtm->rtm_table);
+	o->mark   = rt_u32 (tb[RTA_MARK],     0);
+	o->pref   = rt_u8  (tb[RTA_PREF],     -1);
+	o->expire = rt_u32 (tb[RTA_EXPIRES],  0);
+
+	o->dst = rt_data (tb[RTA_DST]);
+	o->via = rt_data (tb[RTA_GATEWAY]);
+	o->src = rt_data (tb[RTA_PREFSRC]);
 
-	for (rta = RTM_RTA (rtm); RTA_OK (rta, len); rta = RTA_NEXT (rta, len))
-		route_info_set_rta (o, rta);
+	if (tb[RTA_MULTIPATH] != NULL) {
+		o->hops     = RTA_DATA    (tb[RTA_MULTIPATH]);
+		o->hops_len = RTA_PAYLOAD (tb[RTA_MULTIPATH]);
+	}
 }
 
 static int show_route_type (struct route_info *o, int cont, int json)
@@ -431,6 +417,7 @@ static int process_route (struct nlmsghdr *h, void *ctx)
 {
 	static int cont;
 	struct rtmsg *rtm = NLMSG_DATA (h);
+	struct rtattr *tb[RTA_MAX + 1];
 	struct route_info ri;
 
 	if (rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6)
@@ -439,19 +426,229 @@ static int process_route (struct nlmsghdr *h, void *ctx)
 	if (table > 0 && rtm->rtm_table != table)
 		return 0;
 
-	route_info_init (&ri, rtm, RTM_PAYLOAD (h));
+	if (!rt_index_route (tb, h))
+		return 0;
+
+	route_info_init (&ri, rtm, tb);
 
 	cont = route_info_show (&ri, cont, json);
 	return 0;
 }
 
+/*
+ * Watch mode: table is kept in memory, only changes are shown
+ */
+static int watch, summary;
+static struct rt_table *rt;
+static unsigned long added, changed, deleted, failed;
+
+static void show_change (struct nlmsghdr *h, struct rtattr **tb, int del)
+{
+	struct route_info ri;
+
+	if (summary)
+		return;
+
+	route_info_init (&ri, NLMSG_DATA (h), tb);
+
+	if (json)
+		printf ("{\"event\":\"%s\",\"route\":", del ? "del" : "add");
+	else if (del)
+		printf ("Deleted ");
+
+	route_info_show (&ri, 0, json);
+
+	if (json)
+		printf ("}\n");
+}
+
+static int watch_route (struct nlmsghdr *h, void *ctx)
+{
+	struct rtmsg *rtm = NLMSG_DATA (h);
+	struct rtattr *tb[RTA_MAX + 1];
+
+	if (rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6)
+		return 0;
+
+	if (table > 0 && rtm->rtm_table != table)
+		return 0;
+
+	if (!rt_index_route (tb, h))
+		return 0;
+
+	switch (rt_table_apply (rt, h, tb)) {
+	case RT_ADDED:		++added;	break;
+	case RT_CHANGED:	++changed;	break;
+	case RT_DELETED:	++deleted;	break;
+	case RT_SAME:		return 0;
+	default:		++failed;	return 0;
+	}
+
+	show_change (h, tb, h->nlmsg_type == RTM_DELROUTE);
+	return 0;
+}
+
+static void watch_sweep (struct nlmsghdr *h, void *cookie)
+{
+	struct rtattr *tb[RTA_MAX + 1];
+
+	rt_index_route (tb, h);
+	show_change (h, tb, 1);
+	++deleted;
+}
+
 static int cb (struct nl_msg *m, void *ctx)
 {
 	struct nlmsghdr *h = nlmsg_hdr (m);
 
+	if (watch)
+		return h->nlmsg_type == RTM_NEWROUTE ||
+		       h->nlmsg_type == RTM_DELROUTE ? watch_route (h, ctx) : 0;
+
 	return h->nlmsg_type == RTM_NEWROUTE ? process_route (h, ctx) : 0;
 }
 
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void show_summary (void)
+{
+	const size_t count = rt_table_count (rt);
+
+	if (json)
+		printf ("{\"routes\":%zu,\"added\":%lu,\"changed\":%lu,"
+			"\"deleted\":%lu}\n", count, added, changed, deleted);
+	else
+		printf ("routes %zu, added %lu, changed %lu, deleted %lu\n",
+			count, added, changed, deleted);
+
+	added = changed = deleted = 0;
+}
+
+/*
+ * Dumps table after subscription to changes: changes made while dumping
+ * are applied after dump. Routes not seen in dump are deleted, thus the
+ * same is done to recover from overrun.
+ */
+static int resync (int family)
+{
+	int ret;
+
+	rt_table_mark (rt);
+
+	if ((ret = nl_execute_ex (cb, family, NETLINK_ROUTE, RTM_GETROUTE)) < 0)
+		return ret;
+
+	rt_table_sweep (rt, watch_sweep, NULL);
+	return 0;
+}
+
+static int watch_socket (struct nl_sock *h, const int *groups)
+{
+	static nl_recvmsg_msg_cb_t watch_cb = cb;
+	int ret;
+
+	nl_socket_disable_seq_check (h);
+
+	if ((ret = nl_socket_probe_cb (h, &watch_cb)) < 0 ||
+	    (ret = nl_connect (h, NETLINK_ROUTE)) < 0)
+		return ret;
+
+	for (; *groups != 0; ++groups)
+		if ((ret = nl_socket_add_membership (h, *groups)) < 0)
+			return ret;
+
+	return nl_socket_set_nonblocking (h);
+}
+
+static int watch_loop (struct nl_sock *h, int family)
+{
+	struct pollfd p = { nl_socket_get_fd (h), POLLIN };
+	double next = now () + 1;
+	int ret, timeout = -1;
+
+	for (;;) {
+		if (summary && (timeout = (next - now ()) * 1000) <= 0) {
+			show_summary ();
+			next += 1;
+			continue;
+		}
+
+		fflush (stdout);
+
+		if (poll (&p, 1, timeout) < 0 && errno != EINTR)
+			return -nl_syserr2nlerr (errno);
+
+		/* one datagram per call: drain socket, overrun means resync */
+		while ((ret = nl_recvmsgs_default (h)) == 0 ||
+		       ret == -NLE_NOMEM)
+			if (ret == -NLE_NOMEM) {
+				++nl_monitor_overruns;
+
+				if ((ret = resync (family)) < 0)
+					return ret;
+			}
+
+		if (ret != -NLE_AGAIN)
+			return ret;
+
+		if (failed > 0)
+			return -NLE_NOMEM;
+	}
+}
+
+static int watch_routes (int family)
+{
+	int groups[3], i = 0, ret;
+	struct nl_sock *h;
+
+	if (family != AF_INET6)
+		groups[i++] = RTNLGRP_IPV4_ROUTE;
+
+	if (family != AF_INET)
+		groups[i++] = RTNLGRP_IPV6_ROUTE;
+
+	groups[i] = 0;
+
+	if ((rt = rt_table_alloc ()) == NULL)
+		return -NLE_NOMEM;
+
+#ifdef NL_CANNED
+	/* canned stream: dump followed by changes */
+	if (nl_canned ("NL_CANNED") != NULL) {
+		if ((ret = resync (family)) >= 0 &&
+		    (ret = nl_monitor_ex (cb, NETLINK_ROUTE, groups)) >= 0)
+			show_summary ();
+
+		goto out;
+	}
+#endif
+
+	if ((h = nl_socket_alloc ()) == NULL) {
+		ret = -NLE_NOMEM;
+		goto out;
+	}
+
+	if ((ret = watch_socket (h, groups)) >= 0 &&
+	    (ret = resync (family)) >= 0) {
+		if (summary)
+			show_summary ();
+
+		ret = watch_loop (h, family);
+	}
+
+	nl_close (h);
+	nl_socket_free (h);
+out:
+	rt_table_free (rt);
+	return ret;
+}
+
 #define GET_OPT(opt, action)						\
 	do {								\
 		if (argc > 1 && strcmp (opt, argv[1]) == 0)		\
@@ -467,6 +664,17 @@ int main (int argc, char *argv[])
 	GET_OPT ("-4", family = AF_INET);
 	GET_OPT ("-6", family = AF_INET6);
 	GET_OPT ("-a", table  = 0);
+	GET_OPT ("-w", watch  = 1);
+	GET_OPT ("-s", watch  = summary = 1);
+
+	if (watch) {
+		if ((ret = watch_routes (family)) < 0) {
+			nl_perror (ret, "netlink watch");
+			return 1;
+		}
+
+		return 0;
+	}
 
 	if (json)  putchar ('[');
 
@@ -0,0 +1,292 @@
+/*
+ * Routing Message Attribute Access Benchmark
+ *
+ * Compares cost per message of getting a few attributes out of kernel-like
+ * route and link messages: walk with switch per tool, walk per attribute
+ * looked up, and single-pass policy index.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/socket.h>
+
+#include "rt-attr.h"
+
+#define ARRAY_SIZE(a)  (sizeof (a) / sizeof ((a)[0]))
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+union msg {
+	struct nlmsghdr h;
+	unsigned char data[4096];
+};
+
+static void *msg_init (union msg *m, int type, size_t size)
+{
+	memset (m, 0, sizeof (*m));
+
+	m->h.nlmsg_len  = NLMSG_LENGTH (size);
+	m->h.nlmsg_type = type;
+	return NLMSG_DATA (&m->h);
+}
+
+static void attr_put (union msg *m, int type, const void *data, size_t size)
+{
+	struct rtattr *a = (void *) (m->data + NLMSG_ALIGN (m->h.nlmsg_len));
+
+	a->rta_type = type;
+	a->rta_len  = RTA_LENGTH (size);
+
+	if (data != NULL)
+		memcpy (RTA_DATA (a), data, size);
+
+	m->h.nlmsg_len = NLMSG_ALIGN (m->h.nlmsg_len) + RTA_ALIGN (a->rta_len);
+}
+
+static void attr_u32 (union msg *m, int type, uint32_t v)
+{
+	attr_put (m, type, &v, sizeof (v));
+}
+
+/*
+ * Attribute sets and order are as kernel sends them
+ */
+static void make_route (union msg *m)
+{
+	static const unsigned char dst[4] = { 10, 1, 2, 0 };
+	static const unsigned char via[4] = { 192, 168, 0, 1 };
+	static const unsigned char src[4] = { 192, 168, 0, 2 };
+	struct rtmsg *rtm = msg_init (m, RTM_NEWROUTE, sizeof (*rtm));
+	struct rta_cacheinfo ci = {};
+
+	rtm->rtm_family  = AF_INET;
+	rtm->rtm_dst_len = 24;
+	rtm->rtm_table   = RT_TABLE_MAIN;
+	rtm->rtm_type    = RTN_UNICAST;
+
+	attr_u32 (m, RTA_TABLE, RT_TABLE_MAIN);
+	attr_put (m, RTA_DST, dst, sizeof (dst));
+	attr_u32 (m, RTA_PRIORITY, 100);
+	attr_put (m, RTA_PREFSRC, src, sizeof (src));
+	attr_put (m, RTA_GATEWAY, via, sizeof (via));
+	attr_u32 (m, RTA_OIF, 2);
+	attr_put (m, RTA_CACHEINFO, &ci, sizeof (ci));
+}
+
+static void make_link (union msg *m)
+{
+	static const unsigned char mac[6] = { 2, 0, 0, 0, 0, 1 };
+	static const unsigned char u8[8];
+	struct ifinfomsg *ifi = msg_init (m, RTM_NEWLINK, sizeof (*ifi));
+	static const int u32s[] = {
+		IFLA_TXQLEN, IFLA_MTU, IFLA_GROUP, IFLA_PROMISCUITY,
+		IFLA_NUM_TX_QUEUES, IFLA_GSO_MAX_SEGS, IFLA_GSO_MAX_SIZE,
+		IFLA_NUM_RX_QUEUES, IFLA_CARRIER_CHANGES,
+	};
+	unsigned i;
+
+	ifi->ifi_index = 2;
+
+	attr_put (m, IFLA_IFNAME, "eth0", 5);
+
+	for (i = 0; i < ARRAY_SIZE (u32s); ++i)
+		attr_u32 (m, u32s[i], 1500);
+
+	attr_put (m, IFLA_OPERSTATE, u8, 1);
+	attr_put (m, IFLA_LINKMODE, u8, 1);
+	attr_put (m, IFLA_CARRIER, u8, 1);
+	attr_put (m, IFLA_PROTO_DOWN, u8, 1);
+	attr_put (m, IFLA_QDISC, "fq_codel", 9);
+	attr_put (m, IFLA_MAP, NULL, 32);
+	attr_put (m, IFLA_ADDRESS, mac, sizeof (mac));
+	attr_put (m, IFLA_BROADCAST, mac, sizeof (mac));
+	attr_put (m, IFLA_STATS64, NULL, 200);
+	attr_put (m, IFLA_STATS, NULL, 96);
+	attr_put (m, IFLA_AF_SPEC, NULL, 800);
+}
+
+/*
+ * Walk with switch: what tools did before index
+ */
+static uintptr_t route_switch (struct nlmsghdr *h)
+{
+	struct rtmsg *rtm = NLMSG_DATA (h);
+	struct rtattr *rta;
+	int len = RTM_PAYLOAD (h);
+	uintptr_t sum = 0;
+
+	for (rta = RTM_RTA (rtm); RTA_OK (rta, len); rta = RTA_NEXT (rta, len))
+		switch (rta->rta_type) {
+		case RTA_DST:
+		case RTA_GATEWAY:
+		case RTA_PREFSRC:
+			sum += (uintptr_t) RTA_DATA (rta);
+			break;
+		case RTA_OIF:
+		case RTA_PRIORITY:
+		case RTA_TABLE:
+			sum += *(unsigned *) RTA_DATA (rta);
+			break;
+		}
+
+	return sum;
+}
+
+static uintptr_t link_switch (struct nlmsghdr *h)
+{
+	struct ifinfomsg *ifi = NLMSG_DATA (h);
+	struct rtattr *rta;
+	int len = IFLA_PAYLOAD (h);
+	uintptr_t sum = 0;
+
+	for (rta = IFLA_RTA (ifi); RTA_OK (rta, len); rta = RTA_NEXT (rta, len))
+		switch (rta->rta_type) {
+		case IFLA_IFNAME:
+		case IFLA_ADDRESS:
+			sum += (uintptr_t) RTA_DATA (rta);
+			break;
+		case IFLA_MTU:
+			sum += *(unsigned *) RTA_DATA (rta);
+			break;
+		case IFLA_OPERSTATE:
+			sum += *(unsigned char *) RTA_DATA (rta);
+			break;
+		}
+
+	return sum;
+}
+
+/*
+ * Walk per attribute looked up
+ */
+static struct rtattr *find (struct rtattr *rta, int len, int type)
+{
+	for (; RTA_OK (rta, len); rta = RTA_NEXT (rta, len))
+		if (rta->rta_type == type)
+			return rta;
+
+	return NULL;
+}
+
+static uintptr_t route_lookup (struct nlmsghdr *h)
+{
+	struct rtmsg *rtm = NLMSG_DATA (h);
+	struct rtattr *a = RTM_RTA (rtm);
+	int len = RTM_PAYLOAD (h);
+
+	return	(uintptr_t) rt_data (find (a, len, RTA_DST)) +
+		(uintptr_t) rt_data (find (a, len, RTA_GATEWAY)) +
+		(uintptr_t) rt_data (find (a, len, RTA_PREFSRC)) +
+		rt_u32 (find (a, len, RTA_OIF), 0) +
+		rt_u32 (find (a, len, RTA_PRIORITY), 0) +
+		rt_u32 (find (a, len, RTA_TABLE), 0);
+}
+
+static uintptr_t link_lookup (struct nlmsghdr *h)
+{
+	struct ifinfomsg *ifi = NLMSG_DATA (h);
+	struct rtattr *a = IFLA_RTA (ifi);
+	int len = IFLA_PAYLOAD (h);
+
+	return	(uintptr_t) rt_data (find (a, len, IFLA_IFNAME)) +
+		(uintptr_t) rt_data (find (a, len, IFLA_ADDRESS)) +
+		rt_u32 (find (a, len, IFLA_MTU), 0) +
+		rt_u8  (find (a, len, IFLA_OPERSTATE), 0);
+}
+
+static uintptr_t route_index (struct nlmsghdr *h)
+{
+	struct rtattr *tb[RTA_MAX + 1];
+
+	rt_index_route (tb, h);
+
+	return	(uintptr_t) rt_data (tb[RTA_DST]) +
+		(uintptr_t) rt_data (tb[RTA_GATEWAY]) +
+		(uintptr_t) rt_data (tb[RTA_PREFSRC]) +
+		rt_u32 (tb[RTA_OIF], 0) +
+		rt_u32 (tb[RTA_PRIORITY], 0) +
+		rt_u32 (tb[RTA_TABLE], 0);
+}
+
+static uintptr_t link_index (struct nlmsghdr *h)
+{
+	struct rtattr *tb[IFLA_MAX + 1];
+
+	rt_index_link (tb, h);
+
+	return	(uintptr_t) rt_data (tb[IFLA_IFNAME]) +
+		(uintptr_t) rt_data (tb[IFLA_ADDRESS]) +
+		rt_u32 (tb[IFLA_MTU], 0) +
+		rt_u8  (tb[IFLA_OPERSTATE], 0);
+}
+
+struct method {
+	const char *name;
+	uintptr_t (*fn) (struct nlmsghdr *h);
+};
+
+static void run (const char *msg, struct nlmsghdr *h,
+		 const struct method *m, size_t count, size_t n)
+{
+	volatile uintptr_t sink;
+	uintptr_t sum, ref = 0;
+	size_t i, k;
+	double t;
+
+	for (k = 0; k < count; ++k) {
+		t = now ();
+
+		for (i = 0, sum = 0; i < n; ++i) {
+			sum += m[k].fn (h);
+			__asm__ __volatile__ ("" ::: "memory");
+		}
+
+		t = now () - t;
+		sink = sum;
+
+		if (k == 0)
+			ref = sum;
+
+		printf ("%-6s %-7s %10.2f%s\n", msg, m[k].name, t * 1e9 / n,
+			sink != ref ? "  MISMATCH" : "");
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	static const struct method route[] = {
+		{ "switch",	route_switch },
+		{ "lookup",	route_lookup },
+		{ "index",	route_index  },
+	};
+	static const struct method link[] = {
+		{ "switch",	link_switch },
+		{ "lookup",	link_lookup },
+		{ "index",	link_index  },
+	};
+	const size_t n = argc > 1 ? strtoul (argv[1], NULL, 0) : 10000000;
+	static union msg m;
+
+	printf ("%-6s %-7s %10s\n", "msg", "method", "ns/msg");
+
+	make_route (&m);
+	run ("route", &m.h, route, ARRAY_SIZE (route), n);
+
+	make_link (&m);
+	run ("link", &m.h, link, ARRAY_SIZE (link), n);
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Routing Message Attribute Index
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <string.h>
+
+#include <sys/socket.h>
+
+#include <linux/wireless.h>
+
+#include "rt-attr.h"
+
+#define BINARY		{ RT_BINARY }
+#define NESTED		{ RT_NESTED }
+#define STRING		{ RT_STRING, 1 }
+#define U8		{ RT_U8,  1 }
+#define U32		{ RT_U32, 4 }
+#define ADDR		{ RT_ADDR }
+#define STRUCT(type)	{ RT_STRUCT, sizeof (type) }
+
+const struct rt_policy rt_link_policy[IFLA_MAX + 1] = {
+	[IFLA_ADDRESS]		= BINARY,
+	[IFLA_BROADCAST]	= BINARY,
+	[IFLA_IFNAME]		= STRING,
+	[IFLA_MTU]		= U32,
+	[IFLA_LINK]		= U32,
+	[IFLA_QDISC]		= STRING,
+	[IFLA_STATS]		= BINARY,
+	[IFLA_TXQLEN]		= U32,
+	[IFLA_MAP]		= BINARY,
+	[IFLA_WIRELESS]		= { RT_STRUCT, IW_EV_LCP_LEN },
+	[IFLA_OPERSTATE]	= U8,
+	[IFLA_LINKMODE]		= U8,
+	[IFLA_LINKINFO]		= NESTED,
+	[IFLA_STATS64]		= BINARY,
+	[IFLA_AF_SPEC]		= NESTED,
+	[IFLA_GROUP]		= U32,
+	[IFLA_PROMISCUITY]	= U32,
+	[IFLA_NUM_TX_QUEUES]	= U32,
+	[IFLA_NUM_RX_QUEUES]	= U32,
+	[IFLA_CARRIER]		= U8,
+	[IFLA_CARRIER_CHANGES]	= U32,
+	[IFLA_PROTO_DOWN]	= U8,
+	[IFLA_GSO_MAX_SEGS]	= U32,
+	[IFLA_GSO_MAX_SIZE]	= U32,
+};
+
+const struct rt_policy rt_addr_policy[IFA_MAX + 1] = {
+	[IFA_ADDRESS]		= ADDR,
+	[IFA_LOCAL]		= ADDR,
+	[IFA_LABEL]		= STRING,
+	[IFA_BROADCAST]		= ADDR,
+	[IFA_ANYCAST]		= ADDR,
+	[IFA_CACHEINFO]		= STRUCT (struct ifa_cacheinfo),
+	[IFA_MULTICAST]		= ADDR,
+};
+
+const struct rt_policy rt_route_policy[RTA_MAX + 1] = {
+	[RTA_DST]		= ADDR,
+	[RTA_SRC]		= ADDR,
+	[RTA_IIF]		= U32,
+	[RTA_OIF]		= U32,
+	[RTA_GATEWAY]		= ADDR,
+	[RTA_PRIORITY]		= U32,
+	[RTA_PREFSRC]		= ADDR,
+	[RTA_METRICS]		= NESTED,
+	[RTA_MULTIPATH]		= BINARY,
+	[RTA_CACHEINFO]		= STRUCT (struct rta_cacheinfo),
+	[RTA_TABLE]		= U32,
+	[RTA_MARK]		= U32,
+	[RTA_PREF]		= U8,
+	[RTA_EXPIRES]		= U32,
+};
+
+int rt_index (struct rtattr **tb, const struct rt_policy *p, unsigned max,
+	      size_t addr_len, struct rtattr *rta, int len)
+{
+	const struct rt_policy *q;
+	unsigned type;
+	size_t size;
+	int rejected = 0;
+
+	memset (tb, 0, (max + 1) * sizeof (tb[0]));
+
+	for (; RTA_OK (rta, len); rta = RTA_NEXT (rta, len)) {
+		if ((type = rta->rta_type & NLA_TYPE_MASK) > max)
+			continue;
+
+		q    = p + type;
+		size = RTA_PAYLOAD (rta);
+
+		if (size < (q->type == RT_ADDR ? addr_len : q->len) ||
+		    (q->type == RT_STRING &&
+		     ((char *) RTA_DATA (rta))[size - 1] != '\0')) {
+			++rejected;
+			continue;
+		}
+
+		tb[type] = rta;
+	}
+
+	return rejected;
+}
+
+static size_t addr_len (int family)
+{
+	return family == AF_INET6 ? 16 : 4;
+}
+
+int rt_index_link (struct rtattr *tb[IFLA_MAX + 1], struct nlmsghdr *h)
+{
+	struct ifinfomsg *o = NLMSG_DATA (h);
+
+	if (h->nlmsg_len < NLMSG_LENGTH (sizeof (*o))) {
+		memset (tb, 0, (IFLA_MAX + 1) * sizeof (tb[0]));
+		return 0;
+	}
+
+	rt_index (tb, rt_link_policy, IFLA_MAX, 0, IFLA_RTA (o),
+		  IFLA_PAYLOAD (h));
+	return 1;
+}
+
+int rt_index_addr (struct rtattr *tb[IFA_MAX + 1], struct nlmsghdr *h)
+{
+	struct ifaddrmsg *o = NLMSG_DATA (h);
+
+	if (h->nlmsg_len < NLMSG_LENGTH (sizeof (*o))) {
+		memset (tb, 0, (IFA_MAX + 1) * sizeof (tb[0]));
+		return 0;
+	}
+
+	rt_index (tb, rt_addr_policy, IFA_MAX, addr_len (o->ifa_family),
+		  IFA_RTA (o), IFA_PAYLOAD (h));
+	return 1;
+}
+
+int rt_index_route (struct rtattr *tb[RTA_MAX + 1], struct nlmsghdr *h)
+{
+	struct rtmsg *o = NLMSG_DATA (h);
+
+	if (h->nlmsg_len < NLMSG_LENGTH (sizeof (*o))) {
+		memset (tb, 0, (RTA_MAX + 1) * sizeof (tb[0]));
+		return 0;
+	}
+
+	rt_index (tb, rt_route_policy, RTA_MAX, addr_len (o->rtm_family),
+		  RTM_RTA (o), RTM_PAYLOAD (h));
+	return 1;
+}
+
+void rt_index_nexthop (struct rtattr *tb[RTA_MAX + 1], int family,
+		       struct rtnexthop *nh)
+{
+	rt_index (tb, rt_route_policy, RTA_MAX, addr_len (family),
+		  RTNH_DATA (nh), nh->rtnh_len - RTNH_LENGTH (0));
+}
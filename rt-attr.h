@@ -0,0 +1,81 @@
+/*
+ * Routing Message Attribute Index
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RT_ATTR_H
+#define RT_ATTR_H  1
+
+#include <stddef.h>
+
+#include <linux/if_addr.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+
+enum rt_attr_type {
+	RT_UNKNOWN,	/* not in policy, indexed as is		*/
+	RT_BINARY,
+	RT_NESTED,
+	RT_STRING,	/* terminated with NUL			*/
+	RT_U8,
+	RT_U16,
+	RT_U32,
+	RT_ADDR,	/* address of message family		*/
+	RT_STRUCT,	/* of at least len bytes		*/
+};
+
+struct rt_policy {
+	unsigned char type;
+	unsigned short len;	/* minimal, but of address		*/
+};
+
+extern const struct rt_policy rt_link_policy [IFLA_MAX + 1];
+extern const struct rt_policy rt_addr_policy [IFA_MAX  + 1];
+extern const struct rt_policy rt_route_policy[RTA_MAX  + 1];
+
+/*
+ * Walks attributes once storing pointer to each one into tb indexed by
+ * type, table has max + 1 entries, types beyond max are skipped, the last
+ * attribute of a type wins. Attributes shorter than policy demands are
+ * not indexed, thus fixed-size data of indexed ones is safe to read.
+ * Returns number of attributes rejected.
+ */
+int rt_index (struct rtattr **tb, const struct rt_policy *p, unsigned max,
+	      size_t addr_len, struct rtattr *rta, int len);
+
+/*
+ * Attribute data or value, the default one if attribute is absent
+ */
+static inline void *rt_data (const struct rtattr *a)
+{
+	return a != NULL ? RTA_DATA (a) : NULL;
+}
+
+static inline unsigned rt_u8 (const struct rtattr *a, unsigned def)
+{
+	return a != NULL ? *(unsigned char *) RTA_DATA (a) : def;
+}
+
+static inline unsigned rt_u32 (const struct rtattr *a, unsigned def)
+{
+	return a != NULL ? *(unsigned *) RTA_DATA (a) : def;
+}
+
+/*
+ * Index attributes of message, return zero if message is too short to
+ * hold its header (table is cleared then)
+ */
+int rt_index_link  (struct rtattr *tb[IFLA_MAX + 1], struct nlmsghdr *h);
+int rt_index_addr  (struct rtattr *tb[IFA_MAX  + 1], struct nlmsghdr *h);
+int rt_index_route (struct rtattr *tb[RTA_MAX  + 1], struct nlmsghdr *h);
+
+/*
+ * Indexes attributes of multipath route nexthop
+ */
+void rt_index_nexthop (struct rtattr *tb[RTA_MAX + 1], int family,
+		       struct rtnexthop *nh);
+
+#endif  /* RT_ATTR_H */
@@ -0,0 +1,534 @@
+/*
+ * Route Event Filter
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <net/if.h>
+
+#include "rt-attr.h"
+#include "rt-filter.h"
+#include "rt-label.h"
+
+#define LIST_MAX  16
+
+enum rt_cond {
+	COND_FAMILY	= 1 << 0,
+	COND_TABLE	= 1 << 1,
+	COND_PROTO	= 1 << 2,
+	COND_TYPE	= 1 << 3,
+	COND_LEN	= 1 << 4,
+	COND_PREFIX	= 1 << 5,
+	COND_OIF	= 1 << 6,
+};
+
+struct rt_prefix {
+	unsigned char family, len;
+	unsigned char addr[16];
+};
+
+/*
+ * Rule compiled: one-byte fields are checked against bit sets, short
+ * lists are scanned, conditions not given are not checked at all
+ */
+struct rt_rule {
+	int pass;
+	unsigned cond;
+	unsigned char family, len_min, len_max;
+	uint64_t proto[4], type[4];
+	unsigned table[LIST_MAX], ntable;
+	unsigned oif[LIST_MAX], noif;
+	struct rt_prefix *prefix;
+	size_t nprefix;
+};
+
+struct rt_filter {
+	struct rt_rule *rule;
+	size_t count;
+};
+
+static int bit_test (const uint64_t *set, unsigned i)
+{
+	return (set[i / 64] >> (i % 64)) & 1;
+}
+
+static void bit_set (uint64_t *set, unsigned i)
+{
+	set[i / 64] |= (uint64_t) 1 << (i % 64);
+}
+
+static int parse_num (const char *s, unsigned max, unsigned *to)
+{
+	char *end;
+	unsigned long v;
+
+	if (*s < '0' || *s > '9')
+		return 0;
+
+	v = strtoul (s, &end, 0);
+
+	if (*end != '\0' || v > max)
+		return 0;
+
+	*to = v;
+	return 1;
+}
+
+struct name_map {
+	const char *name;
+	unsigned value;
+};
+
+static int parse_name (const char *s, const struct name_map *map,
+		       unsigned *to)
+{
+	for (; map->name != NULL; ++map)
+		if (strcmp (s, map->name) == 0) {
+			*to = map->value;
+			return 1;
+		}
+
+	return 0;
+}
+
+static int parse_table (const char *s, unsigned *to)
+{
+	static const struct name_map map[] = {
+		{ "unspec",	RT_TABLE_UNSPEC	},
+		{ "default",	RT_TABLE_DEFAULT},
+		{ "main",	RT_TABLE_MAIN	},
+		{ "local",	RT_TABLE_LOCAL	},
+		{}
+	};
+	const char *label;
+	unsigned i;
+
+	if (parse_num (s, UINT32_MAX, to) || parse_name (s, map, to))
+		return 1;
+
+	for (i = 0; i < 256; ++i)
+		if ((label = rt_table (i)) != NULL && strcmp (s, label) == 0) {
+			*to = i;
+			return 1;
+		}
+
+	return 0;
+}
+
+static int parse_proto (const char *s, unsigned *to)
+{
+	static const struct name_map map[] = {
+		{ "unspec",	RTPROT_UNSPEC	},
+		{ "redirect",	RTPROT_REDIRECT	},
+		{ "kernel",	RTPROT_KERNEL	},
+		{ "boot",	RTPROT_BOOT	},
+		{ "static",	RTPROT_STATIC	},
+		{}
+	};
+	const char *label;
+	unsigned i;
+
+	if (parse_num (s, 255, to) || parse_name (s, map, to))
+		return 1;
+
+	for (i = 0; i < 256; ++i)
+		if ((label = rt_proto (i)) != NULL && strcmp (s, label) == 0) {
+			*to = i;
+			return 1;
+		}
+
+	return 0;
+}
+
+static int parse_type (const char *s, unsigned *to)
+{
+	static const struct name_map map[] = {
+		{ "unspec",	 RTN_UNSPEC	 },
+		{ "unicast",	 RTN_UNICAST	 },
+		{ "local",	 RTN_LOCAL	 },
+		{ "broadcast",	 RTN_BROADCAST	 },
+		{ "anycast",	 RTN_ANYCAST	 },
+		{ "multicast",	 RTN_MULTICAST	 },
+		{ "blackhole",	 RTN_BLACKHOLE	 },
+		{ "unreachable", RTN_UNREACHABLE },
+		{ "prohibit",	 RTN_PROHIBIT	 },
+		{ "throw",	 RTN_THROW	 },
+		{ "nat",	 RTN_NAT	 },
+		{ "xresolve",	 RTN_XRESOLVE	 },
+		{}
+	};
+
+	return parse_num (s, 255, to) || parse_name (s, map, to);
+}
+
+static int parse_family (struct rt_rule *o, char *s)
+{
+	if (strcmp (s, "inet") == 0)
+		o->family = AF_INET;
+	else if (strcmp (s, "inet6") == 0)
+		o->family = AF_INET6;
+	else
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Lengths are checked before assignment: fields are bytes, "len 300"
+ * would wrap to 44 otherwise
+ */
+static int parse_len (struct rt_rule *o, char *s)
+{
+	unsigned long min, max;
+	char *end;
+
+	if (*s < '0' || *s > '9')
+		return 0;
+
+	min = max = strtoul (s, &end, 10);
+
+	if (*end == '-') {
+		s = end + 1;
+
+		if (*s < '0' || *s > '9')
+			return 0;
+
+		max = strtoul (s, &end, 10);
+	}
+
+	if (*end != '\0' || min > max || max > 128)
+		return 0;
+
+	o->len_min = min;
+	o->len_max = max;
+	return 1;
+}
+
+static int add_table (struct rt_rule *o, char *s)
+{
+	return o->ntable < LIST_MAX && parse_table (s, o->table + o->ntable++);
+}
+
+static int add_proto (struct rt_rule *o, char *s)
+{
+	unsigned v;
+
+	if (!parse_proto (s, &v))
+		return 0;
+
+	bit_set (o->proto, v);
+	return 1;
+}
+
+static int add_type (struct rt_rule *o, char *s)
+{
+	unsigned v;
+
+	if (!parse_type (s, &v))
+		return 0;
+
+	bit_set (o->type, v);
+	return 1;
+}
+
+static int add_oif (struct rt_rule *o, char *s)
+{
+	unsigned *v = o->oif + o->noif;
+
+	if (o->noif == LIST_MAX)
+		return 0;
+
+	if (!parse_num (s, UINT32_MAX, v) && (*v = if_nametoindex (s)) == 0)
+		return 0;
+
+	++o->noif;
+	return 1;
+}
+
+static int add_prefix (struct rt_rule *o, char *s)
+{
+	struct rt_prefix *p;
+	char *len = strchr (s, '/');
+	unsigned max, n, i;
+
+	if ((p = realloc (o->prefix, (o->nprefix + 1) * sizeof (*p))) == NULL)
+		return 0;
+
+	o->prefix = p;
+	p += o->nprefix;
+	memset (p, 0, sizeof (*p));
+
+	if (len != NULL)
+		*len++ = '\0';
+
+	if (inet_pton (AF_INET, s, p->addr) == 1)
+		p->family = AF_INET, max = 32;
+	else if (inet_pton (AF_INET6, s, p->addr) == 1)
+		p->family = AF_INET6, max = 128;
+	else
+		return 0;
+
+	if (len == NULL)
+		n = max;
+	else if (!parse_num (len, max, &n))
+		return 0;
+
+	p->len = n;
+
+	for (i = n / 8; i < 16; ++i, n = 0)  /* clear host part */
+		p->addr[i] &= n % 8 != 0 ? 0xff00 >> (n % 8) : 0;
+
+	++o->nprefix;
+	return 1;
+}
+
+typedef int add_fn (struct rt_rule *o, char *s);
+
+static int parse_list (struct rt_rule *o, char *list, add_fn *add)
+{
+	char *p, *save;
+
+	for (p = strtok_r (list, ",", &save); p != NULL;
+	     p = strtok_r (NULL, ",", &save))
+		if (!add (o, p))
+			return 0;
+
+	return 1;
+}
+
+static int parse_cond (struct rt_rule *o, const char *key, char *value)
+{
+	static const struct {
+		const char *key;
+		unsigned cond;
+		add_fn *add;
+	} map[] = {
+		{ "family",	COND_FAMILY,	parse_family	},
+		{ "table",	COND_TABLE,	add_table	},
+		{ "proto",	COND_PROTO,	add_proto	},
+		{ "type",	COND_TYPE,	add_type	},
+		{ "len",	COND_LEN,	parse_len	},
+		{ "prefix",	COND_PREFIX,	add_prefix	},
+		{ "oif",	COND_OIF,	add_oif	},
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof (map) / sizeof (map[0]); ++i)
+		if (strcmp (key, map[i].key) == 0) {
+			if (value == NULL || (o->cond & map[i].cond) != 0)
+				return 0;
+
+			o->cond |= map[i].cond;
+
+			if (map[i].cond == COND_FAMILY ||
+			    map[i].cond == COND_LEN)
+				return map[i].add (o, value);
+
+			return parse_list (o, value, map[i].add);
+		}
+
+	return 0;
+}
+
+static int parse_rule (struct rt_rule *o, char *line)
+{
+	char *key, *save;
+
+	memset (o, 0, sizeof (*o));
+
+	if ((key = strtok_r (line, " \t\n", &save)) == NULL)
+		return 0;
+
+	if (strcmp (key, "pass") == 0)
+		o->pass = 1;
+	else if (strcmp (key, "skip") != 0)
+		return 0;
+
+	while ((key = strtok_r (NULL, " \t\n", &save)) != NULL)
+		if (!parse_cond (o, key, strtok_r (NULL, " \t\n", &save)))
+			return 0;
+
+	return 1;
+}
+
+static int empty (char *line)
+{
+	char *p;
+
+	if ((p = strchr (line, '#')) != NULL)
+		*p = '\0';
+
+	return line[strspn (line, " \t\n")] == '\0';
+}
+
+struct rt_filter *rt_filter_load (const char *path, unsigned *line)
+{
+	struct rt_filter *o;
+	struct rt_rule *r;
+	char buf[4096];
+	FILE *f;
+
+	*line = 0;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((f = fopen (path, "r")) == NULL)
+		goto no_file;
+
+	while (fgets (buf, sizeof (buf), f) != NULL) {
+		++*line;
+
+		if (empty (buf))
+			continue;
+
+		r = realloc (o->rule, (o->count + 1) * sizeof (*r));
+		if (r == NULL)
+			goto error;
+
+		o->rule = r;
+		r += o->count;
+
+		if (!parse_rule (r, buf)) {
+			free (r->prefix);
+			errno = EINVAL;
+			goto error;
+		}
+
+		++o->count;
+	}
+
+	if (ferror (f))
+		goto error;
+
+	fclose (f);
+	return o;
+error:
+	fclose (f);
+no_file:
+	rt_filter_free (o);
+	return NULL;
+}
+
+void rt_filter_free (struct rt_filter *o)
+{
+	size_t i;
+
+	if (o == NULL)
+		return;
+
+	for (i = 0; i < o->count; ++i)
+		free (o->rule[i].prefix);
+
+	free (o->rule);
+	free (o);
+}
+
+struct route {
+	unsigned char family, len, proto, type;
+	unsigned table;
+	const unsigned char *dst;
+	struct rtattr *oif, *multipath;
+};
+
+static int in_list (const unsigned *list, unsigned count, unsigned v)
+{
+	unsigned i;
+
+	for (i = 0; i < count; ++i)
+		if (list[i] == v)
+			return 1;
+
+	return 0;
+}
+
+static int prefix_match (const struct rt_prefix *p, const struct route *r)
+{
+	const unsigned n = p->len / 8, tail = p->len % 8;
+
+	if (p->family != r->family || r->len < p->len ||
+	    memcmp (p->addr, r->dst, n) != 0)
+		return 0;
+
+	return tail == 0 || ((p->addr[n] ^ r->dst[n]) & (0xff00 >> tail)) == 0;
+}
+
+static int match_prefix (const struct rt_rule *o, const struct route *r)
+{
+	size_t i;
+
+	for (i = 0; i < o->nprefix; ++i)
+		if (prefix_match (o->prefix + i, r))
+			return 1;
+
+	return 0;
+}
+
+static int match_oif (const struct rt_rule *o, const struct route *r)
+{
+	struct rtnexthop *nh;
+	int len;
+
+	if (r->oif != NULL && in_list (o->oif, o->noif, rt_u32 (r->oif, 0)))
+		return 1;
+
+	if (r->multipath == NULL)
+		return 0;
+
+	nh  = RTA_DATA (r->multipath);
+	len = RTA_PAYLOAD (r->multipath);
+
+	for (; RTNH_OK (nh, len);
+	     len -= RTNH_ALIGN (nh->rtnh_len), nh = RTNH_NEXT (nh))
+		if (in_list (o->oif, o->noif, nh->rtnh_ifindex))
+			return 1;
+
+	return 0;
+}
+
+static int match (const struct rt_rule *o, const struct route *r)
+{
+	const unsigned c = o->cond;
+
+	return	((c & COND_FAMILY) == 0 || o->family == r->family) &&
+		((c & COND_PROTO)  == 0 || bit_test (o->proto, r->proto)) &&
+		((c & COND_TYPE)   == 0 || bit_test (o->type,  r->type)) &&
+		((c & COND_LEN)    == 0 || (r->len >= o->len_min &&
+					    r->len <= o->len_max)) &&
+		((c & COND_TABLE)  == 0 || in_list (o->table, o->ntable,
+						    r->table)) &&
+		((c & COND_PREFIX) == 0 || match_prefix (o, r)) &&
+		((c & COND_OIF)    == 0 || match_oif (o, r));
+}
+
+int rt_filter_pass (struct rt_filter *o, struct rtmsg *rtm,
+		    struct rtattr *tb[RTA_MAX + 1])
+{
+	static const unsigned char any[16];
+	struct route r;
+	size_t i;
+
+	r.family    = rtm->rtm_family;
+	r.len       = rtm->rtm_dst_len;
+	r.proto     = rtm->rtm_protocol;
+	r.type      = rtm->rtm_type;
+	r.table     = rt_u32 (tb[RTA_TABLE], rtm->rtm_table);
+	r.dst       = tb[RTA_DST] != NULL ? RTA_DATA (tb[RTA_DST]) : any;
+	r.oif       = tb[RTA_OIF];
+	r.multipath = tb[RTA_MULTIPATH];
+
+	for (i = 0; i < o->count; ++i)
+		if (match (o->rule + i, &r))
+			return o->rule[i].pass;
+
+	return 1;
+}
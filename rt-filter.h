@@ -0,0 +1,39 @@
+/*
+ * Route Event Filter
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RT_FILTER_H
+#define RT_FILTER_H  1
+
+#include <linux/rtnetlink.h>
+
+/*
+ * Rule file holds one rule per line, empty lines and ones starting with
+ * '#' are ignored:
+ *
+ *	(pass | skip) [family (inet | inet6)] [table table,...]
+ *		      [proto proto,...] [type type,...] [len min[-max]]
+ *		      [prefix addr/len,...] [oif dev,...]
+ *
+ * Tables, protocols and devices are given by name or number, types by
+ * name (unicast, local, blackhole, unreachable, ...). Route matches rule
+ * if it matches all conditions given, any value of a list will do. Prefix
+ * condition is met by routes inside any prefix of the list, oif one by
+ * routes with any next hop via device listed. The first rule matched
+ * decides, route not matched by any is passed.
+ */
+struct rt_filter *rt_filter_load (const char *path, unsigned *line);
+void rt_filter_free (struct rt_filter *o);
+
+/*
+ * Returns non-zero if route passes filter. Route attributes are indexed
+ * with rt_index_route.
+ */
+int rt_filter_pass (struct rt_filter *o, struct rtmsg *rtm,
+		    struct rtattr *tb[RTA_MAX + 1]);
+
+#endif  /* RT_FILTER_H */
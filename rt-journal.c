@@ -0,0 +1,279 @@
+/*
+ * Routing Event Journal
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rt-journal.h"
+
+_Static_assert (sizeof (struct rt_journal_head) == 128, "journal header");
+_Static_assert (sizeof (struct rt_event) == 128, "journal record");
+
+#define IDLE_CHECK  64		/* empty reads between producer checks */
+
+struct rt_journal {
+	struct rt_journal_head *head;
+	struct rt_event *rec;
+	size_t size;
+	uint32_t mask;
+	uint64_t next;		/* record to write or to read		*/
+	char *path;
+	dev_t dev;
+	ino_t ino;
+	unsigned idle;
+};
+
+static size_t journal_size (unsigned count)
+{
+	return sizeof (struct rt_journal_head) +
+	       (size_t) count * sizeof (struct rt_event);
+}
+
+struct rt_journal *rt_journal_create (const char *path, unsigned count)
+{
+	struct rt_journal *o;
+	unsigned n;
+	char *tmp;
+	int fd;
+
+	for (n = 1; n < count && n < (1u << 24); n <<= 1) {}
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((tmp = malloc (strlen (path) + 5)) == NULL)
+		goto no_tmp;
+
+	sprintf (tmp, "%s.tmp", path);
+
+	if ((fd = open (tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+			0644)) == -1)
+		goto no_open;
+
+	o->size = journal_size (n);
+
+	if (ftruncate (fd, o->size) != 0)
+		goto no_map;
+
+	o->head = mmap (NULL, o->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+	if (o->head == MAP_FAILED)
+		goto no_map;
+
+	o->rec  = (void *) (o->head + 1);
+	o->mask = n - 1;
+
+	memcpy (o->head->magic, RT_JOURNAL_MAGIC, sizeof (o->head->magic));
+	o->head->count = n;
+	o->head->size  = sizeof (struct rt_event);
+
+	/* consumers find file complete or do not find it at all */
+	if (rename (tmp, path) != 0)
+		goto no_rename;
+
+	close (fd);
+	free (tmp);
+	return o;
+no_rename:
+	munmap (o->head, o->size);
+no_map:
+	close (fd);
+	unlink (tmp);
+no_open:
+	free (tmp);
+no_tmp:
+	free (o);
+	return NULL;
+}
+
+struct rt_event *rt_journal_begin (struct rt_journal *o)
+{
+	struct rt_event *e = o->rec + (o->next & o->mask);
+	struct timespec ts;
+
+	/* invalidate record before any of its data changes */
+	__atomic_store_n (&e->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+
+	memset ((char *) e + sizeof (e->seq), 0, sizeof (*e) - sizeof (e->seq));
+
+	clock_gettime (CLOCK_REALTIME, &ts);
+	e->time = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	return e;
+}
+
+void rt_journal_commit (struct rt_journal *o)
+{
+	struct rt_event *e = o->rec + (o->next & o->mask);
+
+	++o->next;
+
+	__atomic_store_n (&e->seq, o->next, __ATOMIC_RELEASE);
+	__atomic_store_n (&o->head->head, o->next, __ATOMIC_RELEASE);
+}
+
+static int journal_map (struct rt_journal *o)
+{
+	struct rt_journal_head *head;
+	struct stat st;
+	int fd;
+
+	if ((fd = open (o->path, O_RDONLY | O_CLOEXEC)) == -1)
+		return 0;
+
+	if (fstat (fd, &st) != 0)
+		goto error;
+
+	if (st.st_size < (off_t) sizeof (*head)) {
+		errno = EINVAL;
+		goto error;
+	}
+
+	head = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (head == MAP_FAILED)
+		goto error;
+
+	if (memcmp (head->magic, RT_JOURNAL_MAGIC, sizeof (head->magic)) != 0 ||
+	    head->size != sizeof (struct rt_event) || head->count == 0 ||
+	    (head->count & (head->count - 1)) != 0 ||
+	    st.st_size < (off_t) journal_size (head->count)) {
+		munmap (head, st.st_size);
+		errno = EINVAL;
+		goto error;
+	}
+
+	if (o->head != NULL)
+		munmap (o->head, o->size);
+
+	o->head = head;
+	o->rec  = (void *) (head + 1);
+	o->size = st.st_size;
+	o->mask = head->count - 1;
+	o->next = 0;
+	o->dev  = st.st_dev;
+	o->ino  = st.st_ino;
+
+	close (fd);
+	return 1;
+error:
+	close (fd);
+	return 0;
+}
+
+struct rt_journal *rt_journal_open (const char *path)
+{
+	struct rt_journal *o;
+	uint64_t head;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((o->path = strdup (path)) == NULL)
+		goto no_path;
+
+	if (!journal_map (o))
+		goto no_map;
+
+	head = __atomic_load_n (&o->head->head, __ATOMIC_ACQUIRE);
+	o->next = head > o->mask ? head - o->mask - 1 : 0;
+	return o;
+no_map:
+	free (o->path);
+no_path:
+	free (o);
+	return NULL;
+}
+
+void rt_journal_seek_end (struct rt_journal *o)
+{
+	o->next = __atomic_load_n (&o->head->head, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Producer never touches journal it has replaced, thus while idle check
+ * whether the file has been replaced once in a while
+ */
+static int journal_replaced (struct rt_journal *o)
+{
+	struct stat st;
+
+	if (++o->idle < IDLE_CHECK)
+		return 0;
+
+	o->idle = 0;
+
+	return stat (o->path, &st) == 0 &&
+	       (st.st_dev != o->dev || st.st_ino != o->ino);
+}
+
+int rt_journal_read (struct rt_journal *o, struct rt_event *e,
+		     uint64_t *lost)
+{
+	const uint64_t count = o->mask + 1ull;
+	const struct rt_event *r;
+	uint64_t head, seq;
+
+	*lost = 0;
+
+	for (;;) {
+		head = __atomic_load_n (&o->head->head, __ATOMIC_ACQUIRE);
+
+		if (o->next == head) {
+			if (!journal_replaced (o))
+				return 0;
+
+			if (!journal_map (o))
+				return -1;
+
+			errno = ESTALE;
+			return -1;
+		}
+
+		if (head - o->next > count) {
+			*lost  += head - count - o->next;
+			o->next = head - count;
+		}
+
+		r   = o->rec + (o->next & o->mask);
+		seq = __atomic_load_n (&r->seq, __ATOMIC_ACQUIRE);
+
+		if (seq == o->next + 1) {
+			memcpy (e, r, sizeof (*e));
+			__atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+			if (__atomic_load_n (&r->seq, __ATOMIC_RELAXED) == seq)
+				break;
+		}
+
+		/* overwritten by producer while we were looking */
+		++*lost;
+		++o->next;
+	}
+
+	++o->next;
+	o->idle = 0;
+	return 1;
+}
+
+void rt_journal_close (struct rt_journal *o)
+{
+	if (o == NULL)
+		return;
+
+	munmap (o->head, o->size);
+	free (o->path);
+	free (o);
+}
@@ -0,0 +1,108 @@
+/*
+ * Routing Event Journal
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RT_JOURNAL_H
+#define RT_JOURNAL_H  1
+
+#include <stdint.h>
+
+/*
+ * Journal is a shared file (usually in /dev/shm) holding header and ring
+ * of fixed-size records of decoded routing events. Single producer writes
+ * records in place, any number of consumers map file read-only and read
+ * at their own pace: records overwritten before consumer got them are
+ * counted as lost.
+ */
+#define RT_JOURNAL_MAGIC  "RTJRNL\0\1"
+
+struct rt_journal_head {
+	char magic[8];
+	uint32_t count;		/* of records, power of two		*/
+	uint32_t size;		/* of record				*/
+	uint64_t reserved[6];
+	uint64_t head;		/* number of records ever written	*/
+	uint64_t pad[7];
+};
+
+/*
+ * Fields not used by event type are zero:
+ *
+ * link:    ifindex, link_type, flags (IFF_*), mtu, addr (link-layer
+ *          address of addr_len bytes), name;
+ * address: family, ifindex, addr_len (prefix length), scope, flags
+ *          (IFA_F_*), addr, local, broadcast, name (label);
+ * route:   family, ifindex (output device), addr_len (destination
+ *          prefix length), scope, proto, route_type, table, metric,
+ *          flags (RTM_F_*), addr (destination), via, src.
+ */
+struct rt_event {
+	uint64_t seq;		/* record number plus one, zero if written */
+	uint64_t time;		/* in nanoseconds since the Epoch	*/
+	uint16_t type;		/* RTM_NEWLINK ... RTM_DELROUTE		*/
+	uint8_t  family;
+	uint8_t  addr_len;
+	uint8_t  scope;
+	uint8_t  proto;
+	uint8_t  route_type;
+	uint8_t  reserved;
+	uint32_t ifindex;
+	uint32_t table;
+	uint32_t metric;
+	uint32_t flags;
+	uint32_t mtu;
+	uint16_t link_type;
+	uint16_t pad;
+	uint8_t  addr[16];
+	union {
+		uint8_t via[16];
+		uint8_t local[16];
+	};
+	union {
+		uint8_t src[16];
+		uint8_t broadcast[16];
+	};
+	char name[16];
+	uint8_t  spare[16];
+};
+
+/*
+ * Producer: creates new journal of count records (rounded up to power of
+ * two) and atomically replaces file at path with it.
+ */
+struct rt_journal *rt_journal_create (const char *path, unsigned count);
+
+/*
+ * Returns cleared record to be filled in place and then published with
+ * commit. Consumers never see partially written records.
+ */
+struct rt_event *rt_journal_begin (struct rt_journal *o);
+void rt_journal_commit (struct rt_journal *o);
+
+/*
+ * Consumer: opens journal positioned at the oldest record it still holds,
+ * seek_end skips all the records written so far.
+ */
+struct rt_journal *rt_journal_open (const char *path);
+void rt_journal_seek_end (struct rt_journal *o);
+
+/*
+ * Copies next event into e and returns 1, returns 0 if there is no new
+ * event. Number of events lost to overrun right before this one is stored
+ * into lost.
+ *
+ * If producer has been restarted the journal is reopened and -1 is
+ * returned with errno set to ESTALE: state derived from old events should
+ * be dropped, next reads start from the beginning of new journal. Other
+ * errors are returned as -1 with errno set, reading may be retried.
+ */
+int rt_journal_read (struct rt_journal *o, struct rt_event *e,
+		     uint64_t *lost);
+
+void rt_journal_close (struct rt_journal *o);
+
+#endif  /* RT_JOURNAL_H */
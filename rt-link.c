@@ -0,0 +1,157 @@
+/*
+ * Link Table Mirror
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rt-attr.h"
+#include "rt-link.h"
+
+struct rt_link_entry {
+	struct rt_link_entry *next;
+	struct rt_link link;
+};
+
+struct rt_links {
+	struct rt_link_entry **bucket;
+	size_t mask, count;
+};
+
+#define INIT_SIZE  64		/* buckets, power of two */
+
+struct rt_links *rt_links_alloc (void)
+{
+	struct rt_links *o;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((o->bucket = calloc (INIT_SIZE, sizeof (o->bucket[0]))) == NULL) {
+		free (o);
+		return NULL;
+	}
+
+	o->mask = INIT_SIZE - 1;
+	return o;
+}
+
+void rt_links_free (struct rt_links *o)
+{
+	struct rt_link_entry *e, *next;
+	size_t i;
+
+	if (o == NULL)
+		return;
+
+	for (i = 0; i <= o->mask; ++i)
+		for (e = o->bucket[i]; e != NULL; e = next) {
+			next = e->next;
+			free (e);
+		}
+
+	free (o->bucket);
+	free (o);
+}
+
+/*
+ * Indexes are allocated sequentially by kernel, thus spread well as is
+ */
+static struct rt_link_entry **lookup (struct rt_links *o, int index)
+{
+	struct rt_link_entry **p;
+
+	for (p = o->bucket + (index & o->mask); *p != NULL; p = &(*p)->next)
+		if ((*p)->link.index == index)
+			break;
+
+	return p;
+}
+
+static void grow (struct rt_links *o)
+{
+	const size_t size = (o->mask + 1) * 2;
+	struct rt_link_entry **bucket, *e, *next;
+	size_t i;
+
+	if ((bucket = calloc (size, sizeof (bucket[0]))) == NULL)
+		return;  /* keep going with longer chains */
+
+	for (i = 0; i <= o->mask; ++i)
+		for (e = o->bucket[i]; e != NULL; e = next) {
+			next = e->next;
+			e->next = bucket[e->link.index & (size - 1)];
+			bucket[e->link.index & (size - 1)] = e;
+		}
+
+	free (o->bucket);
+	o->bucket = bucket;
+	o->mask   = size - 1;
+}
+
+/*
+ * Link change events carry full link state, attribute missing keeps old
+ * value anyway
+ */
+static int link_add (struct rt_links *o, struct rt_link_entry **p,
+		     struct ifinfomsg *ifi, struct rtattr **tb)
+{
+	struct rt_link_entry *e = *p;
+
+	if (e == NULL) {
+		if ((e = calloc (1, sizeof (*e))) == NULL)
+			return 0;
+
+		e->link.index = ifi->ifi_index;
+		*p = e;
+
+		if (++o->count > o->mask + 1)
+			grow (o);
+	}
+
+	e->link.type  = ifi->ifi_type;
+	e->link.flags = ifi->ifi_flags;
+	e->link.mtu   = rt_u32 (tb[IFLA_MTU], e->link.mtu);
+
+	if (tb[IFLA_IFNAME] != NULL)
+		snprintf (e->link.name, sizeof (e->link.name), "%s",
+			  (const char *) RTA_DATA (tb[IFLA_IFNAME]));
+
+	return 1;
+}
+
+int rt_links_apply (struct rt_links *o, struct nlmsghdr *h,
+		    struct rtattr *tb[IFLA_MAX + 1])
+{
+	struct ifinfomsg *ifi = NLMSG_DATA (h);
+	struct rt_link_entry **p = lookup (o, ifi->ifi_index), *e;
+
+	if (h->nlmsg_type == RTM_NEWLINK)
+		return link_add (o, p, ifi, tb);
+
+	if ((e = *p) != NULL) {
+		*p = e->next;
+		free (e);
+		--o->count;
+	}
+
+	return 1;
+}
+
+const struct rt_link *rt_links_find (struct rt_links *o, int index)
+{
+	struct rt_link_entry *e = *lookup (o, index);
+
+	return e != NULL ? &e->link : NULL;
+}
+
+const char *rt_links_name (struct rt_links *o, int index)
+{
+	const struct rt_link *l = rt_links_find (o, index);
+
+	return l != NULL && l->name[0] != '\0' ? l->name : NULL;
+}
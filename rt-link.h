@@ -0,0 +1,38 @@
+/*
+ * Link Table Mirror
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RT_LINK_H
+#define RT_LINK_H  1
+
+#include <linux/rtnetlink.h>
+
+struct rt_link {
+	int index;
+	unsigned type, flags, mtu;
+	char name[16];		/* IFNAMSIZ				*/
+};
+
+/*
+ * Hash of links keyed by interface index, seeded by link dump and kept
+ * up to date with link events: name of interface is known without asking
+ * kernel for it
+ */
+struct rt_links *rt_links_alloc (void);
+void rt_links_free (struct rt_links *o);
+
+/*
+ * Applies RTM_NEWLINK or RTM_DELLINK message with attributes indexed,
+ * returns zero on allocation failure
+ */
+int rt_links_apply (struct rt_links *o, struct nlmsghdr *h,
+		    struct rtattr *tb[IFLA_MAX + 1]);
+
+const struct rt_link *rt_links_find (struct rt_links *o, int index);
+const char *rt_links_name (struct rt_links *o, int index);
+
+#endif  /* RT_LINK_H */
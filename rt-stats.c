@@ -0,0 +1,297 @@
+/*
+ * Interface Statistics Sampler
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nl-core.h"
+#include "rt-attr.h"
+#include "rt-stats.h"
+
+const char *const rt_stats_name[RT_STATS_COUNT] = {
+	"rx_packets", "tx_packets", "rx_bytes",   "tx_bytes",
+	"rx_errors",  "tx_errors",  "rx_dropped", "tx_dropped",
+	"multicast",  "collisions",
+};
+
+struct rt_stats {
+	struct nl_sock *sock;
+	int getlink, error;
+	unsigned sample;
+
+	struct rt_stats_link *link;
+	unsigned count, size;
+
+	unsigned *slot;		/* open hash of link index: slot + 1 or 0 */
+	unsigned mask;
+};
+
+static unsigned hash (int index)
+{
+	return (unsigned) index * 2654435761u;
+}
+
+static void rehash (struct rt_stats *o)
+{
+	unsigned i, k;
+
+	memset (o->slot, 0, (o->mask + 1) * sizeof (o->slot[0]));
+
+	for (i = 0; i < o->count; ++i) {
+		for (k = hash (o->link[i].index) & o->mask; o->slot[k] != 0;
+		     k = (k + 1) & o->mask) {}
+
+		o->slot[k] = i + 1;
+	}
+}
+
+/*
+ * Keeps hash table at most half full
+ */
+static int reserve (struct rt_stats *o)
+{
+	unsigned size, *slot;
+	struct rt_stats_link *link;
+
+	if (o->count == o->size) {
+		size = o->size > 0 ? o->size * 2 : 64;
+
+		if ((link = realloc (o->link, size * sizeof (link[0]))) == NULL)
+			return 0;
+
+		o->link = link;
+		o->size = size;
+	}
+
+	if ((o->count + 1) * 2 <= o->mask + 1)
+		return 1;
+
+	size = (o->mask + 1) * 2;
+
+	if ((slot = realloc (o->slot, size * sizeof (slot[0]))) == NULL)
+		return 0;
+
+	o->slot = slot;
+	o->mask = size - 1;
+	rehash (o);
+	return 1;
+}
+
+static struct rt_stats_link *lookup (struct rt_stats *o, int index)
+{
+	struct rt_stats_link *l;
+	unsigned k;
+
+	for (k = hash (index) & o->mask; o->slot[k] != 0;
+	     k = (k + 1) & o->mask)
+		if (o->link[o->slot[k] - 1].index == index)
+			return o->link + o->slot[k] - 1;
+
+	if (!reserve (o))
+		return NULL;
+
+	/* table could be rehashed, find free slot again */
+	for (k = hash (index) & o->mask; o->slot[k] != 0;
+	     k = (k + 1) & o->mask) {}
+
+	l = o->link + o->count;
+	o->slot[k] = ++o->count;
+
+	memset (l, 0, sizeof (*l));
+	l->index = index;
+	l->flags = RT_STATS_NEW;
+	l->seen  = o->sample;
+
+	if (if_indextoname (index, l->name) == NULL)
+		snprintf (l->name, sizeof (l->name), "if%d", index);
+
+	return l;
+}
+
+/*
+ * Drops links gone, that is not seen in the last sample
+ */
+static void prune (struct rt_stats *o)
+{
+	unsigned i, n;
+
+	for (i = 0, n = 0; i < o->count; ++i)
+		if (o->link[i].seen == o->sample)
+			o->link[n++] = o->link[i];
+
+	if (n < o->count) {
+		o->count = n;
+		rehash (o);
+	}
+}
+
+static void update (struct rt_stats *o, int index, const char *name,
+		    const struct rtattr *stats)
+{
+	const size_t len = RTA_PAYLOAD (stats);
+	uint64_t c[RT_STATS_COUNT] = {};
+	struct rt_stats_link *l;
+	unsigned i;
+
+	if ((l = lookup (o, index)) == NULL) {
+		o->error = -NLE_NOMEM;
+		return;
+	}
+
+	if (name != NULL)
+		snprintf (l->name, sizeof (l->name), "%s", name);
+
+	memcpy (c, RTA_DATA (stats), len < sizeof (c) ? len : sizeof (c));
+
+	if (l->seen == o->sample && (l->flags & RT_STATS_NEW) != 0)
+		memcpy (l->last, c, sizeof (c));
+	else
+		l->flags = 0;
+
+	/* counter going back means it was reset */
+	for (i = 0; i < RT_STATS_COUNT; ++i)
+		l->delta[i] = c[i] >= l->last[i] ? c[i] - l->last[i] : c[i];
+
+	memcpy (l->last, c, sizeof (c));
+	l->seen = o->sample;
+}
+
+static void on_stats (struct rt_stats *o, struct nlmsghdr *h)
+{
+	struct if_stats_msg *ifsm = NLMSG_DATA (h);
+	struct rtattr *a;
+	int len;
+
+	if (h->nlmsg_len < NLMSG_LENGTH (sizeof (*ifsm)))
+		return;
+
+	a   = (void *) ((char *) ifsm + NLMSG_ALIGN (sizeof (*ifsm)));
+	len = h->nlmsg_len - NLMSG_LENGTH (sizeof (*ifsm));
+
+	for (; RTA_OK (a, len); a = RTA_NEXT (a, len))
+		if (a->rta_type == IFLA_STATS_LINK_64)
+			update (o, ifsm->ifindex, NULL, a);
+}
+
+static void on_link (struct rt_stats *o, struct nlmsghdr *h)
+{
+	struct rtattr *tb[IFLA_MAX + 1];
+	struct ifinfomsg *ifi = NLMSG_DATA (h);
+
+	if (rt_index_link (tb, h) && tb[IFLA_STATS64] != NULL)
+		update (o, ifi->ifi_index, rt_data (tb[IFLA_IFNAME]),
+			tb[IFLA_STATS64]);
+}
+
+static int cb (struct nl_msg *m, void *arg)
+{
+	struct nlmsghdr *h = nlmsg_hdr (m);
+
+	switch (h->nlmsg_type) {
+	case RTM_NEWSTATS:  on_stats (arg, h);  break;
+	case RTM_NEWLINK:   on_link  (arg, h);  break;
+	}
+
+	return NL_OK;
+}
+
+struct rt_stats *rt_stats_alloc (int getlink)
+{
+	struct rt_stats *o;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	o->getlink = getlink;
+	o->mask    = 127;
+
+	if ((o->slot = calloc (o->mask + 1, sizeof (o->slot[0]))) == NULL)
+		goto no_slot;
+
+	if ((o->sock = nl_socket_alloc ()) == NULL)
+		goto no_sock;
+
+	nl_socket_disable_seq_check (o->sock);
+
+	if (nl_socket_modify_cb (o->sock, NL_CB_VALID, NL_CB_CUSTOM, cb, o) < 0 ||
+	    nl_connect (o->sock, NETLINK_ROUTE) < 0)
+		goto no_connect;
+
+	return o;
+no_connect:
+	nl_socket_free (o->sock);
+no_sock:
+	free (o->slot);
+no_slot:
+	free (o);
+	return NULL;
+}
+
+void rt_stats_free (struct rt_stats *o)
+{
+	if (o == NULL)
+		return;
+
+	nl_socket_free (o->sock);
+	free (o->slot);
+	free (o->link);
+	free (o);
+}
+
+static int request_stats (struct nl_sock *h)
+{
+	struct if_stats_msg ifsm = {
+		.family		= AF_UNSPEC,
+		.filter_mask	= IFLA_STATS_FILTER_BIT (IFLA_STATS_LINK_64),
+	};
+	struct nl_msg *m;
+	int ret;
+
+	if ((m = nlmsg_alloc_simple (RTM_GETSTATS, NLM_F_DUMP)) == NULL)
+		return -NLE_NOMEM;
+
+	if ((ret = nlmsg_append (m, &ifsm, sizeof (ifsm), NLMSG_ALIGNTO)) >= 0)
+		ret = nl_send_auto (h, m);
+
+	nlmsg_free (m);
+	return ret;
+}
+
+int rt_stats_sample (struct rt_stats *o)
+{
+	int ret;
+
+	++o->sample;
+	o->error = 0;
+
+	ret = o->getlink ?
+	      nl_rtgen_request (o->sock, RTM_GETLINK, AF_UNSPEC,
+				NLM_F_REQUEST | NLM_F_DUMP) :
+	      request_stats (o->sock);
+
+	if (ret >= 0)
+		while ((ret = nl_recvmsgs_default (o->sock)) > 0) {}
+
+	/* interrupted dump may miss links, keep them till next sample */
+	if (ret == -NLE_DUMP_INTR)
+		return o->error;
+
+	if (ret < 0)
+		return ret;
+
+	prune (o);
+	return o->error;
+}
+
+const struct rt_stats_link *rt_stats_links (const struct rt_stats *o,
+					    unsigned *count)
+{
+	*count = o->count;
+	return o->link;
+}
@@ -0,0 +1,75 @@
+/*
+ * Interface Statistics Sampler
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RT_STATS_H
+#define RT_STATS_H  1
+
+#include <stdint.h>
+
+#include <net/if.h>
+
+/*
+ * Counters kept are the leading ones of rtnl_link_stats64, in its order
+ */
+enum rt_stats_counter {
+	RT_RX_PACKETS, RT_TX_PACKETS, RT_RX_BYTES,   RT_TX_BYTES,
+	RT_RX_ERRORS,  RT_TX_ERRORS,  RT_RX_DROPPED, RT_TX_DROPPED,
+	RT_MULTICAST,  RT_COLLISIONS,
+	RT_STATS_COUNT,
+};
+
+extern const char *const rt_stats_name[RT_STATS_COUNT];
+
+#define RT_STATS_NEW  1		/* link first seen, delta is zero */
+
+struct rt_stats_link {
+	int index;
+	unsigned flags;
+	char name[IF_NAMESIZE];
+	uint64_t delta[RT_STATS_COUNT];	/* since previous sample */
+	uint64_t last [RT_STATS_COUNT];
+	unsigned seen;			/* sample number */
+};
+
+/*
+ * Sampler takes counters of all links with single dump per sample over
+ * own netlink socket: RTM_GETSTATS asking for IFLA_STATS_LINK_64 only, or
+ * full RTM_GETLINK one if getlink is set (for kernels before 4.7). Links
+ * are kept in dense array in order of appearance, links gone are dropped.
+ * Names of links are taken once with if_indextoname in RTM_GETSTATS mode,
+ * renames are not seen then.
+ */
+struct rt_stats *rt_stats_alloc (int getlink);
+void rt_stats_free (struct rt_stats *o);
+
+/*
+ * Takes new sample, returns zero on success or negative libnl error code.
+ * Links array stays valid up to next sample.
+ */
+int rt_stats_sample (struct rt_stats *o);
+const struct rt_stats_link *rt_stats_links (const struct rt_stats *o,
+					    unsigned *count);
+
+/*
+ * Binary sample as written by link-stats: head followed by records, in
+ * host byte order
+ */
+struct rt_stats_head {
+	uint64_t time;		/* of sample, ns since epoch		*/
+	uint32_t interval;	/* since previous sample, us		*/
+	uint32_t count;		/* of records following			*/
+};
+
+struct rt_stats_rec {
+	int32_t  index;
+	uint32_t flags;
+	char name[IF_NAMESIZE];
+	uint64_t delta[RT_STATS_COUNT];
+};
+
+#endif  /* RT_STATS_H */
@@ -0,0 +1,282 @@
+/*
+ * Routing Table Mirror
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+
+#include "rt-attr.h"
+#include "rt-table.h"
+
+struct rt_key {
+	unsigned char family, len;
+	unsigned table, metric;
+	unsigned char dst[16];
+};
+
+struct rt_entry {
+	struct rt_entry *next;
+	uint32_t hash;
+	unsigned gen;
+	struct rt_key key;
+	struct nlmsghdr h;	/* route message follows */
+};
+
+struct rt_table {
+	struct rt_entry **bucket;
+	size_t mask, count;
+	unsigned gen;
+	struct nlmsghdr *tmp;	/* stripped copy of message applied */
+	size_t tmp_size;
+};
+
+#define INIT_SIZE  1024		/* buckets, power of two */
+
+struct rt_table *rt_table_alloc (void)
+{
+	struct rt_table *o;
+
+	if ((o = calloc (1, sizeof (*o))) == NULL)
+		return NULL;
+
+	if ((o->bucket = calloc (INIT_SIZE, sizeof (o->bucket[0]))) == NULL) {
+		free (o);
+		return NULL;
+	}
+
+	o->mask = INIT_SIZE - 1;
+	return o;
+}
+
+void rt_table_free (struct rt_table *o)
+{
+	struct rt_entry *e, *next;
+	size_t i;
+
+	if (o == NULL)
+		return;
+
+	for (i = 0; i <= o->mask; ++i)
+		for (e = o->bucket[i]; e != NULL; e = next) {
+			next = e->next;
+			free (e);
+		}
+
+	free (o->bucket);
+	free (o->tmp);
+	free (o);
+}
+
+size_t rt_table_count (struct rt_table *o)
+{
+	return o->count;
+}
+
+static uint32_t hash (const void *data, size_t size)
+{
+	const unsigned char *p;
+	uint32_t h = 2166136261u;
+
+	for (p = data; size > 0; --size, ++p)
+		h = (h ^ *p) * 16777619;
+
+	return h;
+}
+
+static void key_init (struct rt_key *o, struct rtmsg *rtm, struct rtattr **tb)
+{
+	const size_t len = rtm->rtm_family == AF_INET6 ? 16 : 4;
+
+	memset (o, 0, sizeof (*o));
+
+	o->family = rtm->rtm_family;
+	o->len    = rtm->rtm_dst_len;
+	o->table  = rt_u32 (tb[RTA_TABLE], rtm->rtm_table);
+	o->metric = rt_u32 (tb[RTA_PRIORITY], 0);
+
+	if (tb[RTA_DST] != NULL)
+		memcpy (o->dst, RTA_DATA (tb[RTA_DST]), len);
+}
+
+/*
+ * Copies message dropping attributes changed by kernel on its own
+ */
+static void msg_copy (struct nlmsghdr *to, const struct nlmsghdr *h)
+{
+	struct rtmsg *rtm = NLMSG_DATA (h);
+	struct rtattr *a = RTM_RTA (rtm);
+	unsigned char *p;
+	int len = RTM_PAYLOAD (h);
+
+	memcpy (to, h, NLMSG_LENGTH (sizeof (*rtm)));
+	p = (unsigned char *) to + NLMSG_SPACE (sizeof (*rtm));
+
+	for (; RTA_OK (a, len); a = RTA_NEXT (a, len))
+		switch (a->rta_type) {
+		case RTA_CACHEINFO:
+		case RTA_EXPIRES:
+			break;
+		default:
+			memcpy (p, a, RTA_ALIGN (a->rta_len));
+			p += RTA_ALIGN (a->rta_len);
+		}
+
+	to->nlmsg_len   = p - (unsigned char *) to;
+	to->nlmsg_type  = RTM_NEWROUTE;
+	to->nlmsg_flags = 0;
+	to->nlmsg_seq   = 0;
+	to->nlmsg_pid   = 0;
+}
+
+static struct rt_entry **lookup (struct rt_table *o, const struct rt_key *key,
+				 uint32_t h)
+{
+	struct rt_entry **p;
+
+	for (p = o->bucket + (h & o->mask); *p != NULL; p = &(*p)->next)
+		if ((*p)->hash == h &&
+		    memcmp (&(*p)->key, key, sizeof (*key)) == 0)
+			break;
+
+	return p;
+}
+
+static void grow (struct rt_table *o)
+{
+	const size_t size = (o->mask + 1) * 2;
+	struct rt_entry **bucket, *e, *next;
+	size_t i;
+
+	if ((bucket = calloc (size, sizeof (bucket[0]))) == NULL)
+		return;  /* keep going with longer chains */
+
+	for (i = 0; i <= o->mask; ++i)
+		for (e = o->bucket[i]; e != NULL; e = next) {
+			next = e->next;
+			e->next = bucket[e->hash & (size - 1)];
+			bucket[e->hash & (size - 1)] = e;
+		}
+
+	free (o->bucket);
+	o->bucket = bucket;
+	o->mask   = size - 1;
+}
+
+/*
+ * Stripped copy is not longer than original message
+ */
+static struct nlmsghdr *scratch (struct rt_table *o, size_t size)
+{
+	void *p;
+
+	if (size > o->tmp_size) {
+		if ((p = realloc (o->tmp, size)) == NULL)
+			return NULL;
+
+		o->tmp      = p;
+		o->tmp_size = size;
+	}
+
+	return o->tmp;
+}
+
+static int route_add (struct rt_table *o, struct rt_entry **p,
+		      const struct rt_key *key, uint32_t hash,
+		      const struct nlmsghdr *h)
+{
+	struct rt_entry *e = *p;
+	struct nlmsghdr *m;
+	int change = e == NULL ? RT_ADDED : RT_CHANGED;
+
+	if ((m = scratch (o, h->nlmsg_len)) == NULL)
+		return -1;
+
+	msg_copy (m, h);
+
+	if (e != NULL) {
+		e->gen = o->gen;
+
+		if (e->h.nlmsg_len == m->nlmsg_len &&
+		    memcmp (&e->h, m, m->nlmsg_len) == 0)
+			return RT_SAME;
+
+		e = realloc (e, offsetof (struct rt_entry, h) + m->nlmsg_len);
+	}
+	else
+		e = malloc (offsetof (struct rt_entry, h) + m->nlmsg_len);
+
+	if (e == NULL)
+		return -1;
+
+	if (change == RT_ADDED) {
+		e->next = NULL;
+		e->hash = hash;
+		e->key  = *key;
+		++o->count;
+	}
+
+	e->gen = o->gen;
+	memcpy (&e->h, m, m->nlmsg_len);
+
+	*p = e;
+
+	if (change == RT_ADDED && o->count > o->mask + 1)
+		grow (o);
+
+	return change;
+}
+
+int rt_table_apply (struct rt_table *o, struct nlmsghdr *h,
+		    struct rtattr *tb[RTA_MAX + 1])
+{
+	struct rt_entry **p, *e;
+	struct rt_key key;
+	uint32_t hv;
+
+	key_init (&key, NLMSG_DATA (h), tb);
+	hv = hash (&key, sizeof (key));
+	p  = lookup (o, &key, hv);
+
+	if (h->nlmsg_type == RTM_NEWROUTE)
+		return route_add (o, p, &key, hv, h);
+
+	if ((e = *p) == NULL)
+		return RT_SAME;
+
+	*p = e->next;
+	free (e);
+	--o->count;
+	return RT_DELETED;
+}
+
+void rt_table_mark (struct rt_table *o)
+{
+	++o->gen;
+}
+
+void rt_table_sweep (struct rt_table *o, rt_table_cb *cb, void *cookie)
+{
+	struct rt_entry **p, *e;
+	size_t i;
+
+	for (i = 0; i <= o->mask; ++i)
+		for (p = o->bucket + i; (e = *p) != NULL;) {
+			if (e->gen == o->gen) {
+				p = &e->next;
+				continue;
+			}
+
+			cb (&e->h, cookie);
+
+			*p = e->next;
+			free (e);
+			--o->count;
+		}
+}
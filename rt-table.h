@@ -0,0 +1,50 @@
+/*
+ * Routing Table Mirror
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RT_TABLE_H
+#define RT_TABLE_H  1
+
+#include <stddef.h>
+
+#include <linux/rtnetlink.h>
+
+/*
+ * Hash of route messages keyed by family, table, destination prefix and
+ * metric. Messages are kept without cache info and expiration time, thus
+ * a route refreshed by kernel does not show up as changed.
+ */
+struct rt_table *rt_table_alloc (void);
+void rt_table_free (struct rt_table *o);
+
+size_t rt_table_count (struct rt_table *o);
+
+enum rt_change {
+	RT_SAME,		/* or deleted route was not there	*/
+	RT_ADDED,
+	RT_CHANGED,
+	RT_DELETED,
+};
+
+/*
+ * Applies RTM_NEWROUTE or RTM_DELROUTE message with attributes indexed,
+ * returns change made or -1 on allocation failure
+ */
+int rt_table_apply (struct rt_table *o, struct nlmsghdr *h,
+		    struct rtattr *tb[RTA_MAX + 1]);
+
+/*
+ * Resynchronization: mark starts new generation, routes added or seen
+ * since then (by a dump) are kept by sweep, others are removed from table
+ * and passed to callback first as RTM_NEWROUTE messages
+ */
+typedef void rt_table_cb (struct nlmsghdr *h, void *cookie);
+
+void rt_table_mark  (struct rt_table *o);
+void rt_table_sweep (struct rt_table *o, rt_table_cb *cb, void *cookie);
+
+#endif  /* RT_TABLE_H */
@@ -0,0 +1,360 @@
+/*
+ * Soft Flush Benchmark
+ *
+ * Runs in private network namespaces: creates conntrack entries, then
+ * flushes them with deletes and with soft flush (timeout updates) while
+ * a probe bounces UDP packets over loopback. Reports round-trip time
+ * percentiles of the probe, CPU time of the flush and of the whole system
+ * until the table is drained.
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <net/if.h>
+
+#include "nfct-core.h"
+#include "nfct-flush-net.h"
+
+#define CT_COUNT  "/proc/sys/net/netfilter/nf_conntrack_count"
+#define PROBE_MAX  (1u << 20)
+
+static unsigned entries = 200000, expire = 10, rate, interval = 100;
+
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void pause_for (double t)
+{
+	struct timespec ts;
+
+	ts.tv_sec  = t;
+	ts.tv_nsec = (t - ts.tv_sec) * 1e9;
+
+	while (nanosleep (&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+static double rusage_time (int who)
+{
+	struct rusage ru;
+
+	if (getrusage (who, &ru) != 0)
+		return 0;
+
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	       ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/*
+ * Returns busy time of all CPUs in seconds, kernel workers included
+ */
+static double system_time (void)
+{
+	unsigned long long v[8] = {};
+	FILE *f;
+	int ok;
+
+	if ((f = fopen ("/proc/stat", "r")) == NULL)
+		return 0;
+
+	ok = fscanf (f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+		     v, v + 1, v + 2, v + 3, v + 4, v + 5, v + 6, v + 7) == 8;
+	fclose (f);
+
+	if (!ok)
+		return 0;
+
+	/* all but idle and iowait */
+	return (double) (v[0] + v[1] + v[2] + v[5] + v[6] + v[7]) /
+	       sysconf (_SC_CLK_TCK);
+}
+
+static long ct_count (int fd)
+{
+	char buf[32];
+	ssize_t len;
+
+	if ((len = pread (fd, buf, sizeof (buf) - 1, 0)) <= 0)
+		return -1;
+
+	buf[len] = '\0';
+	return atol (buf);
+}
+
+static int link_up (const char *name)
+{
+	struct ifreq ifr = {};
+	int fd, ok;
+
+	if ((fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) == -1)
+		return 0;
+
+	snprintf (ifr.ifr_name, sizeof (ifr.ifr_name), "%s", name);
+
+	ok = ioctl (fd, SIOCGIFFLAGS, &ifr) == 0;
+	ifr.ifr_flags |= IFF_UP;
+	ok = ok && ioctl (fd, SIOCSIFFLAGS, &ifr) == 0;
+
+	close (fd);
+	return ok;
+}
+
+/*
+ * Entry j: TCP from 10.0.0.0/8 to 1.0.0.0/8
+ */
+static int ct_create (struct nfct_handle *h, unsigned j)
+{
+	const uint32_t src = htonl (0x0a000000 + j);
+	const uint32_t dst = htonl (0x01000000 + j % 65536);
+	const uint16_t sport = htons (1024 + j % 60000), dport = htons (80);
+	struct nf_conntrack *ct;
+	int ok;
+
+	if ((ct = nfct_new ()) == NULL)
+		return 0;
+
+	nfct_set_attr_u8  (ct, ATTR_L3PROTO, AF_INET);
+	nfct_set_attr_u32 (ct, ATTR_IPV4_SRC, src);
+	nfct_set_attr_u32 (ct, ATTR_IPV4_DST, dst);
+	nfct_set_attr_u32 (ct, ATTR_REPL_IPV4_SRC, dst);
+	nfct_set_attr_u32 (ct, ATTR_REPL_IPV4_DST, src);
+
+	nfct_set_attr_u8  (ct, ATTR_L4PROTO, IPPROTO_TCP);
+	nfct_set_attr_u16 (ct, ATTR_PORT_SRC, sport);
+	nfct_set_attr_u16 (ct, ATTR_PORT_DST, dport);
+	nfct_set_attr_u16 (ct, ATTR_REPL_PORT_SRC, dport);
+	nfct_set_attr_u16 (ct, ATTR_REPL_PORT_DST, sport);
+
+	nfct_set_attr_u8  (ct, ATTR_TCP_STATE, TCP_CONNTRACK_ESTABLISHED);
+	nfct_set_attr_u32 (ct, ATTR_STATUS,
+			   IPS_CONFIRMED | IPS_SEEN_REPLY | IPS_ASSURED);
+	nfct_set_attr_u32 (ct, ATTR_TIMEOUT, 3600);
+
+	ok = nfct_query (h, NFCT_Q_CREATE, ct) == 0;
+	nfct_destroy (ct);
+	return ok;
+}
+
+static int setup (void)
+{
+	struct nfct_handle *h;
+	unsigned i;
+	double t;
+
+	if (unshare (CLONE_NEWNET) != 0) {
+		perror ("soft-flush-bench: cannot create network namespace");
+		return 0;
+	}
+
+	if (!link_up ("lo")) {
+		perror ("soft-flush-bench: lo");
+		return 0;
+	}
+
+	if ((h = nfct_open (CONNTRACK, 0)) == NULL) {
+		perror ("soft-flush-bench: conntrack");
+		return 0;
+	}
+
+	t = now ();
+
+	for (i = 0; i < entries; ++i)
+		if (!ct_create (h, i)) {
+			perror ("soft-flush-bench: conntrack create");
+			nfct_close (h);
+			return 0;
+		}
+
+	printf ("entries:  %u created in %.3fs\n", entries, now () - t);
+	nfct_close (h);
+	return 1;
+}
+
+/*
+ * Data plane probe: sends datagram to itself over loopback every interval
+ * microseconds and records time it takes to arrive
+ */
+struct probe {
+	pthread_t thread;
+	volatile int stop;
+	double *rtt;
+	size_t count;
+};
+
+static void *probe_run (void *cookie)
+{
+	struct probe *p = cookie;
+	struct sockaddr_in sa = { .sin_family = AF_INET };
+	socklen_t len = sizeof (sa);
+	char buf[64] = {};
+	double t;
+	int fd;
+
+	sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+	if ((fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)) == -1 ||
+	    bind (fd, (void *) &sa, sizeof (sa)) != 0 ||
+	    getsockname (fd, (void *) &sa, &len) != 0) {
+		perror ("soft-flush-bench: probe");
+		return NULL;
+	}
+
+	while (!p->stop && p->count < PROBE_MAX) {
+		t = now ();
+
+		if (sendto (fd, buf, sizeof (buf), 0, (void *) &sa,
+			    sizeof (sa)) != sizeof (buf) ||
+		    recv (fd, buf, sizeof (buf), 0) != sizeof (buf))
+			break;
+
+		p->rtt[p->count++] = now () - t;
+		pause_for (interval / 1e6);
+	}
+
+	close (fd);
+	return NULL;
+}
+
+static int cmp (const void *a, const void *b)
+{
+	const double x = *(const double *) a, y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double percentile (const double *v, size_t n, double q)
+{
+	return v[(size_t) (q * (n - 1) + 0.5)];
+}
+
+/*
+ * Flushes all entries created, returns zero on error
+ */
+static int run (const char *name, unsigned expire, struct probe *p)
+{
+	struct nfct_net net;
+	struct nfct_flush_opts opts = { .rate = rate, .expire = expire };
+	double t0, t1, t2, cpu, sys;
+	long left;
+	int fd, ok;
+
+	if (!setup () || !nfct_net_parse (&net, "1.0.0.0/8", 0))
+		return 0;
+
+	if ((fd = open (CT_COUNT, O_RDONLY)) == -1) {
+		perror ("soft-flush-bench: " CT_COUNT);
+		return 0;
+	}
+
+	p->stop  = 0;
+	p->count = 0;
+
+	if (pthread_create (&p->thread, NULL, probe_run, p) != 0) {
+		perror ("soft-flush-bench: probe");
+		close (fd);
+		return 0;
+	}
+
+	pause_for (0.1);
+
+	sys = system_time ();
+	cpu = rusage_time (RUSAGE_THREAD);
+	t0  = now ();
+
+	ok = nfct_flush_net_ex (&net, 1, &opts) == 0;
+
+	t1  = now ();
+	cpu = rusage_time (RUSAGE_THREAD) - cpu;
+
+	while ((left = ct_count (fd)) > 0 && now () - t0 < expire + 60)
+		pause_for (0.01);
+
+	t2  = now ();
+	sys = system_time () - sys;
+
+	p->stop = 1;
+	pthread_join (p->thread, NULL);
+	close (fd);
+
+	if (!ok) {
+		perror ("soft-flush-bench: flush");
+		return 0;
+	}
+
+	if (p->count == 0) {
+		fprintf (stderr, "soft-flush-bench: no probes done\n");
+		return 0;
+	}
+
+	qsort (p->rtt, p->count, sizeof (p->rtt[0]), cmp);
+
+	printf ("%s:\n", name);
+	printf ("  flush:  %.3fs, cpu %.3fs\n", t1 - t0, cpu);
+	printf ("  drain:  %.3fs, %ld left, system cpu %.3fs\n",
+		t2 - t0, left, sys);
+	printf ("  probe:  %zu, p50 %.1f p99 %.1f p99.9 %.1f max %.1f us\n",
+		p->count, percentile (p->rtt, p->count, 0.5) * 1e6,
+		percentile (p->rtt, p->count, 0.99) * 1e6,
+		percentile (p->rtt, p->count, 0.999) * 1e6,
+		p->rtt[p->count - 1] * 1e6);
+	return 1;
+}
+
+static int usage (void)
+{
+	fprintf (stderr, "Usage:\n\tsoft-flush-bench [-m entries] "
+			 "[-x expire] [-r rate] [-i interval-us]\n");
+	return 1;
+}
+
+int main (int argc, char *argv[])
+{
+	struct probe p = {};
+	int c;
+
+	while ((c = getopt (argc, argv, "m:x:r:i:")) != -1)
+		switch (c) {
+		case 'm':  entries  = strtoul (optarg, NULL, 0); break;
+		case 'x':  expire   = strtoul (optarg, NULL, 0); break;
+		case 'r':  rate     = strtoul (optarg, NULL, 0); break;
+		case 'i':  interval = strtoul (optarg, NULL, 0); break;
+		default:
+			return usage ();
+		}
+
+	if (entries == 0 || entries > 1 << 24 || expire == 0)
+		return usage ();
+
+	if ((p.rtt = calloc (PROBE_MAX, sizeof (p.rtt[0]))) == NULL) {
+		perror ("soft-flush-bench");
+		return 1;
+	}
+
+	if (!run ("delete", 0, &p) || !run ("expire", expire, &p))
+		return 1;
+
+	free (p.rtt);
+	return 0;
+}
@@ -6,18 +6,54 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#define _GNU_SOURCE
+
+#include <errno.h>
 #include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 
 #include <net/if.h>
 #include <syslog.h>
 #include <unistd.h>
 
-#include <netlink/netlink.h>
-#include <netlink/msg.h>
-
+#include "metrics.h"
+#include "nl-core.h"
 #include "nl-monitor.h"
+#include "renew-sched.h"
+#include "rt-attr.h"
+#include "rt-link.h"
+#include "usdt.h"
+
+#ifdef NL_CANNED
+#include "nl-canned.h"
+#endif
+
+enum {
+	M_NEWLINK, M_RENEW_SENT, M_RENEW_SUPPRESSED, M_RENEW_DEFERRED,
+	M_OVERRUNS, M_DUMP_TIME,
+};
+
+static const struct metric metrics[] = {
+	{ "udhcpc_monitor_events_total", "type=\"newlink\"",
+	  "Link events received", METRIC_COUNTER },
+	{ "udhcpc_monitor_renews_total", "result=\"sent\"",
+	  "DHCP renew requests on carrier detect", METRIC_COUNTER },
+	{ "udhcpc_monitor_renews_total", "result=\"suppressed\"",
+	  "DHCP renew requests on carrier detect", METRIC_COUNTER },
+	{ "udhcpc_monitor_renews_deferred_total", NULL,
+	  "DHCP renew requests deferred or merged with pending ones",
+	  METRIC_COUNTER },
+	{ "udhcpc_monitor_netlink_overruns_total", NULL,
+	  "Netlink receive buffer overruns, events lost", METRIC_COUNTER,
+	  &nl_monitor_overruns },
+	{ "udhcpc_monitor_dump_duration_seconds", NULL,
+	  "Link table dump duration", METRIC_HISTOGRAM },
+};
 
 static long udhcpc_get_pid (const char *link)
 {
@@ -45,48 +81,129 @@ static long udhcpc_get_pid (const char *link)
 	return ret ? pid : 0;
 }
 
+/*
+ * Pid file may be stale and its pid reused by another process: pin the
+ * process with pidfd first, check it is udhcpc, then signal via pidfd
+ */
+static int is_udhcpc (long pid)
+{
+	char path[32], buf[256];
+	size_t len;
+	FILE *f;
+
+	snprintf (path, sizeof (path), "/proc/%ld/cmdline", pid);
+
+	if ((f = fopen (path, "r")) == NULL)
+		return 0;
+
+	len = fread (buf, 1, sizeof (buf) - 1, f);
+	fclose (f);
+
+	return memmem (buf, len, "udhcpc", 6) != NULL;
+}
+
+static int pid_signal (long pid, int sig)
+{
+#if defined (SYS_pidfd_open) && defined (SYS_pidfd_send_signal)
+	int fd, ok;
+
+	if ((fd = syscall (SYS_pidfd_open, pid, 0)) == -1)
+		return errno == ENOSYS ? kill (pid, sig) == 0 : 0;
+
+	ok = is_udhcpc (pid) &&
+	     syscall (SYS_pidfd_send_signal, fd, sig, NULL, 0) == 0;
+
+	close (fd);
+	return ok;
+#else
+	return kill (pid, sig) == 0;
+#endif
+}
+
 static int udhcpc_renew (const char *link)
 {
 	long pid;
+	int ok;
 
 	if ((pid = udhcpc_get_pid (link)) <= 0)
 		return 0;
 
-	return kill (pid, SIGUSR1) == 0;
+	ok = pid_signal (pid, SIGUSR1);
+
+	USDT_PROBE3 (udhcpc, renew, link, pid, ok);
+	return ok;
 }
 
 #define CARRIER_MASK	(IFF_UP | IFF_RUNNING)
 #define CARRIER_ON	(IFF_UP | IFF_RUNNING)
 #define CARRIER_OFF	(IFF_UP)
 
-static int action (const char *name, unsigned flags)
+static struct renew_sched *sched;
+static struct rt_links *links;	/* last carrier state of links	*/
+static int dumping;
+
+static void renew (const char *name, void *cookie)
 {
-	if (name == NULL || (flags & CARRIER_MASK) != CARRIER_ON)
-		return 0;
+	int ok = udhcpc_renew (name);
+
+	metric_add (ok ? M_RENEW_SENT : M_RENEW_SUPPRESSED, 1);
+
+	if (ok)
+		syslog (LOG_NOTICE,
+			"%s: carrier detected, requested DHCP renew", name);
+}
+
+static int carrier_on (unsigned flags)
+{
+	return (flags & CARRIER_MASK) == CARRIER_ON;
+}
+
+/*
+ * Mass carrier-up (switch reboot) would hit DHCP relay with renews of all
+ * links at once, scheduler spreads them over time
+ */
+static void action (const char *name, unsigned flags, int was_on)
+{
+	if (name == NULL)
+		return;
 
-	return udhcpc_renew (name);
+	if (!carrier_on (flags)) {
+		renew_sched_cancel (sched, name);
+		return;
+	}
+
+	if (was_on)
+		return;
+
+	switch (renew_sched_put (sched, name)) {
+	case 0:   metric_add (M_RENEW_DEFERRED, 1);	break;
+	case -1:  metric_add (M_RENEW_SUPPRESSED, 1);	break;
+	}
 }
 
+/*
+ * Renew is requested on carrier-up only, not on every link event with
+ * carrier on: link seen first in dump is taken as up already, one seen
+ * first in event as just come up
+ */
 static int process_link (struct nlmsghdr *h, void *ctx)
 {
 	struct ifinfomsg *o = NLMSG_DATA (h);
-	struct rtattr *rta;
-	int len;
-	const char *name = NULL;
-
-	for (
-		rta = IFLA_RTA (o), len = IFLA_PAYLOAD (h);
-		RTA_OK (rta, len);
-		rta = RTA_NEXT (rta, len)
-	)
-		if (rta->rta_type ==  IFLA_IFNAME) {
-			name = RTA_DATA (rta);
-			break;
-		}
+	struct rtattr *tb[IFLA_MAX + 1];
+	const struct rt_link *l;
+	int was_on;
 
-	if (action (name, o->ifi_flags))
-		syslog (LOG_NOTICE,
-			"%s: carrier detected, requested DHCP renew", name);
+	if (!rt_index_link (tb, h))
+		return 0;
+
+	l = rt_links_find (links, o->ifi_index);
+	was_on = l != NULL ? carrier_on (l->flags) : dumping;
+
+	if (!rt_links_apply (links, h, tb))
+		syslog (LOG_ERR, "link table: %m");
+
+	action (rt_data (tb[IFLA_IFNAME]),
+		h->nlmsg_type == RTM_NEWLINK ? o->ifi_flags : 0, was_on);
 	return 0;
 }
 
@@ -94,7 +211,15 @@ static int cb (struct nl_msg *m, void *ctx)
 {
 	struct nlmsghdr *h = nlmsg_hdr (m);
 
-	return h->nlmsg_type == RTM_NEWLINK ? process_link (h, ctx) : 0;
+	switch (h->nlmsg_type) {
+	case RTM_NEWLINK:
+		metric_add (M_NEWLINK, 1);
+		return process_link (h, ctx);
+	case RTM_DELLINK:
+		return process_link (h, ctx);
+	}
+
+	return 0;
 }
 
 static int make_pidfile (const char *path)
@@ -108,28 +233,121 @@ static int make_pidfile (const char *path)
 	       (fclose (to) == 0);
 }
 
-#define PIDFILE  "/var/run/udhcpc-monitor.pid"
+static double now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-int main (void)
+/*
+ * Links are dumped after subscription to their changes, and again after
+ * overrun: carrier-up lost then shows up in dump as change of carrier
+ * state kept
+ */
+static int resync (void *cookie)
 {
+	double start = now ();
 	int ret;
 
-	if (daemon (0, 0) != 0) {
-		perror ("udhcpc-monitor: cannot daemonize");
-		return 1;
-	}
+	dumping = 1;
+	ret = nl_execute (cb, NETLINK_ROUTE, RTM_GETLINK);
+	dumping = 0;
+
+	if (ret < 0)
+		return ret;
+
+	metric_observe (M_DUMP_TIME, now () - start);
+	return 0;
+}
+
+#define PIDFILE  "/var/run/udhcpc-monitor.pid"
+
+int main (int argc, char *argv[])
+{
+	const char *pidfile = PIDFILE;
+	const char *sock = NULL, *textfile = NULL;
+	static const int groups[] = { RTNLGRP_LINK, 0 };
+	struct renew_sched_opts so = { 10000, 16, 5000 };
+	int c, ret;
+
+	while ((c = getopt (argc, argv, "S:P:w:n:t:")) != -1)
+		switch (c) {
+		case 'S':  sock     = optarg;  break;
+		case 'P':  textfile = optarg;  break;
+		case 'w':  so.window = strtod (optarg, NULL) * 1000;	break;
+		case 'n':  so.limit  = strtoul (optarg, NULL, 0);	break;
+		case 't':  so.hold   = strtod (optarg, NULL) * 1000;	break;
+		default:
+			fprintf (stderr, "Usage:\n\tudhcpc-monitor "
+					 "[-S metrics-socket] "
+					 "[-P metrics-textfile]\n"
+					 "\t\t[-w window] [-n in-flight] "
+					 "[-t in-flight-time]\n"
+					 "\n"
+					 "\t-w  spread mass renews over <window> "
+					 "seconds, 10 by default\n"
+					 "\t-n  run at most <in-flight> renews, "
+					 "16 by default\n"
+					 "\t-t  renew is in flight for "
+					 "<in-flight-time> seconds, 5 by default\n");
+			return 1;
+		}
+
+#ifdef NL_CANNED
+	/* canned stream is a benchmark run, stay in foreground then */
+	if (nl_canned ("NL_CANNED") != NULL)
+		pidfile = NULL;
+#endif
+
+	if (pidfile != NULL) {
+		if (daemon (0, 0) != 0) {
+			perror ("udhcpc-monitor: cannot daemonize");
+			return 1;
+		}
 
-	make_pidfile (PIDFILE);
+		make_pidfile (pidfile);
+	}
 
 	openlog ("udhcpc-monitor", 0, LOG_DAEMON);
 
-	if ((ret = nl_execute (cb, NETLINK_ROUTE, RTM_GETLINK)) < 0 ||
-	    (ret = nl_monitor (cb, NETLINK_ROUTE, RTNLGRP_LINK, 0)) < 0) {
-		syslog (LOG_ERR, "netlink error: %s", nl_geterror (ret));
-		unlink (PIDFILE);
-		return 1;
+	if ((sched = renew_sched_alloc (&so, renew, NULL)) == NULL) {
+		syslog (LOG_ERR, "scheduler: %m");
+		goto error;
+	}
+
+	if ((links = rt_links_alloc ()) == NULL) {
+		syslog (LOG_ERR, "link table: %m");
+		goto error;
+	}
+
+	if ((sock != NULL || textfile != NULL) &&
+	    (!metrics_init (metrics, sizeof (metrics) / sizeof (metrics[0])) ||
+	     !metrics_start (sock, textfile, 15))) {
+		syslog (LOG_ERR, "metrics: %m");
+		goto error;
 	}
 
-	unlink (PIDFILE);
+	if ((ret = nl_monitor_sync (cb, NETLINK_ROUTE, groups, resync,
+				    NULL)) < 0)
+		goto nl_error;
+
+	rt_links_free (links);
+	renew_sched_free (sched);
+
+	if (pidfile != NULL)
+		unlink (pidfile);
+
 	return 0;
+nl_error:
+	syslog (LOG_ERR, "netlink error: %s", nl_geterror (ret));
+error:
+	rt_links_free (links);
+	renew_sched_free (sched);
+
+	if (pidfile != NULL)
+		unlink (pidfile);
+
+	return 1;
 }
@@ -0,0 +1,115 @@
+/*
+ * User-Space Statically Defined Tracing Probes
+ *
+ * Copyright (c) 2016-2026 Alexei A. Smekalkine <ikle@ikle.ru>
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef USDT_H
+#define USDT_H  1
+
+/*
+ * Probe is a single nop in code and a SystemTap-compatible note describing
+ * its location and arguments, as bpftrace, perf and systemtap expect. All
+ * arguments are passed as 64-bit integers. Defining NO_USDT removes probes.
+ *
+ * Probes are emitted with <sys/sdt.h> if available, with own notes on
+ * x86-64 and AArch64 otherwise.
+ */
+#if defined (NO_USDT)
+
+#elif defined (__has_include)
+#if __has_include (<sys/sdt.h>)
+#include <sys/sdt.h>
+
+#define USDT_PROBE0(p, n)		DTRACE_PROBE  (p, n)
+#define USDT_PROBE1(p, n, x1)						\
+	DTRACE_PROBE1 (p, n, (long) (x1))
+#define USDT_PROBE2(p, n, x1, x2)					\
+	DTRACE_PROBE2 (p, n, (long) (x1), (long) (x2))
+#define USDT_PROBE3(p, n, x1, x2, x3)					\
+	DTRACE_PROBE3 (p, n, (long) (x1), (long) (x2), (long) (x3))
+#define USDT_PROBE4(p, n, x1, x2, x3, x4)				\
+	DTRACE_PROBE4 (p, n, (long) (x1), (long) (x2), (long) (x3),	\
+		       (long) (x4))
+#define USDT_PROBE5(p, n, x1, x2, x3, x4, x5)				\
+	DTRACE_PROBE5 (p, n, (long) (x1), (long) (x2), (long) (x3),	\
+		       (long) (x4), (long) (x5))
+#elif defined (__x86_64__) || defined (__aarch64__)
+#define USDT_OWN  1
+#endif
+#endif
+
+#ifdef USDT_OWN
+
+#define USDT_NOTE(p, n, args)						\
+	"990:	nop\n"							\
+	"	.pushsection .note.stapsdt, \"?\", \"note\"\n"		\
+	"	.balign 4\n"						\
+	"	.4byte 992f-991f, 994f-993f, 3\n"			\
+	"991:	.asciz \"stapsdt\"\n"					\
+	"992:	.balign 4\n"						\
+	"993:	.8byte 990b\n"						\
+	"	.8byte _.stapsdt.base\n"				\
+	"	.8byte 0\n"						\
+	"	.asciz \"" #p "\"\n"					\
+	"	.asciz \"" #n "\"\n"					\
+	"	.asciz \"" args "\"\n"					\
+	"994:	.balign 4\n"						\
+	"	.popsection\n"						\
+	"	.ifndef _.stapsdt.base\n"				\
+	"	.pushsection .stapsdt.base, \"aG\", \"progbits\", "	\
+			".stapsdt.base, comdat\n"			\
+	"	.weak _.stapsdt.base\n"					\
+	"	.hidden _.stapsdt.base\n"				\
+	"_.stapsdt.base:\n"						\
+	"	.space 1\n"						\
+	"	.size _.stapsdt.base, 1\n"				\
+	"	.popsection\n"						\
+	"	.endif\n"
+
+#define USDT_ARG(x)  "nor" ((long) (x))
+
+#define USDT_PROBE0(p, n)						\
+	__asm__ __volatile__ (USDT_NOTE (p, n, ""))
+
+#define USDT_PROBE1(p, n, x1)						\
+	__asm__ __volatile__ (USDT_NOTE (p, n, "8@%[a1]")		\
+			      :: [a1] USDT_ARG (x1))
+
+#define USDT_PROBE2(p, n, x1, x2)					\
+	__asm__ __volatile__ (USDT_NOTE (p, n, "8@%[a1] 8@%[a2]")	\
+			      :: [a1] USDT_ARG (x1), [a2] USDT_ARG (x2))
+
+#define USDT_PROBE3(p, n, x1, x2, x3)					\
+	__asm__ __volatile__ (USDT_NOTE (p, n, "8@%[a1] 8@%[a2] "	\
+					       "8@%[a3]")		\
+			      :: [a1] USDT_ARG (x1), [a2] USDT_ARG (x2),	\
+				 [a3] USDT_ARG (x3))
+
+#define USDT_PROBE4(p, n, x1, x2, x3, x4)				\
+	__asm__ __volatile__ (USDT_NOTE (p, n, "8@%[a1] 8@%[a2] "	\
+					       "8@%[a3] 8@%[a4]")	\
+			      :: [a1] USDT_ARG (x1), [a2] USDT_ARG (x2),	\
+				 [a3] USDT_ARG (x3), [a4] USDT_ARG (x4))
+
+#define USDT_PROBE5(p, n, x1, x2, x3, x4, x5)				\
+	__asm__ __volatile__ (USDT_NOTE (p, n, "8@%[a1] 8@%[a2] "	\
+					       "8@%[a3] 8@%[a4] "	\
+					       "8@%[a5]")		\
+			      :: [a1] USDT_ARG (x1), [a2] USDT_ARG (x2),	\
+				 [a3] USDT_ARG (x3), [a4] USDT_ARG (x4),	\
+				 [a5] USDT_ARG (x5))
+#endif
+
+#ifndef USDT_PROBE0
+#define USDT_PROBE0(p, n)				((void) 0)
+#define USDT_PROBE1(p, n, x1)				((void) 0)
+#define USDT_PROBE2(p, n, x1, x2)			((void) 0)
+#define USDT_PROBE3(p, n, x1, x2, x3)			((void) 0)
+#define USDT_PROBE4(p, n, x1, x2, x3, x4)		((void) 0)
+#define USDT_PROBE5(p, n, x1, x2, x3, x4, x5)		((void) 0)
+#endif
+
+#endif  /* USDT_H */